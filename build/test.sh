@@ -4,6 +4,447 @@
 # date          11.02.2023
 # copyright     GNU GPLv3 - Copyright (c) 2023 Oliver Blaser
 
-rm -rf ../test/system/out-dir
+# Usage:
+# ./test.sh --help
 
-./cmake/phodime -v ../test/system/Joe/ ../test/system/Mary/ ../test/system/a-file ../test/system/Emily ../test/system/Emily2/Emily ../test/system/out-dir
+
+
+source dep_globals.sh
+
+# CTest passes the binary and a directory in its build tree
+exe=${PHODIME_EXE:-./cmake/$prjBinName}
+echoTitle="test $prjBinName"
+tmpDir=${TEST_TMP:-./test-tmp}
+baselineFile=./test-perf-baseline.txt
+
+# rates every machine reaches (same format as the baseline file), used if there is no baseline
+floorFile=./test-perf-floor.txt
+
+# number of files of the timed tests, and the fraction of the baseline rate a timed test has to reach
+perfFiles=${PERF_FILES:-20000}
+perfTolerance=${PERF_TOLERANCE:-0.5}
+
+# number and size of the files of the copy order benchmark
+orderFiles=${ORDER_FILES:-4000}
+orderSize=${ORDER_SIZE:-256K}
+
+
+
+errCnt=0
+function procErrorCode()
+{
+    if [ $1 -ne 0 ]; then ((++errCnt)); fi;
+}
+
+function printHelp()
+{
+    echo "Usage:"
+    echo "  $0 [arg1 [arg2 [arg3]]]"
+    echo ""
+    echo "run script in $repoDirName/build/, after ./build.sh cmake make"
+    echo ""
+    echo "args (default: system functional perf):"
+    echo "  -h help     print help"
+    echo "  system      merge ../test/system, the output has to be checked manually"
+    echo "  functional  merge generated INDIRs and compare the OUTDIR contents"
+    echo "  perf        timed tests, fail if a files/s rate is below PERF_TOLERANCE (default 0.5) of the baseline"
+    echo "  calibrate   measure the files/s rates of the timed tests and write them to $baselineFile"
+    echo "  order       benchmark of --physical-order, run it with the build directory on the disk to measure (not"
+    echo "              run by default, drops the page cache if run as root)"
+    echo ""
+    echo "The timed tests use PERF_FILES (default 20000) files. Without a baseline file the rates are checked against"
+    echo "the minimum rates in $floorFile, the tolerance is not applied to them."
+    echo "The copy order benchmark uses ORDER_FILES (default 4000) files of ORDER_SIZE (default 256K) bytes."
+    echo "PHODIME_EXE and TEST_TMP override the binary and the temporary directory."
+}
+
+# pass the test name and the result (0 is passed)
+function testResult()
+{
+    if [ $2 -eq 0 ]
+    then
+        echo -e "  \033[92mpassed\033[39m  $1"
+    else
+        echo -e "  \033[91mFAILED\033[39m  $1"
+        ((++errCnt))
+    fi
+}
+
+# pass the file path and the content
+function mkFile()
+{
+    mkdir -p "$(dirname "$1")"
+    printf "$2" > "$1"
+}
+
+# prints "PATH CONTENT" of every file in the directory, sorted
+function listDir()
+{
+    (cd "$1" && find . -type f | LC_ALL=C sort | while read -r f; do echo "$f $(cat "$f")"; done)
+}
+
+# pass the test name, the OUTDIR and the expected output of listDir
+function checkDir()
+{
+    local actual
+    actual=$(listDir "$2")
+
+    if [ "$actual" == "$3" ]
+    then
+        testResult "$1" 0
+    else
+        testResult "$1" 1
+        diff <(echo "$3") <(echo "$actual")
+    fi
+}
+
+
+
+function cmd_system()
+{
+    rm -rf ../test/system/out-dir
+
+    $exe -v ../test/system/Joe/ ../test/system/Mary/ ../test/system/a-file ../test/system/Emily ../test/system/Emily2/Emily ../test/system/out-dir
+}
+
+function cmd_functional()
+{
+    local in=$tmpDir/in
+    local out=$tmpDir/out
+
+    # the scheme cache is not written to the cache directory of the user
+    local -x XDG_CACHE_HOME
+    XDG_CACHE_HOME=$(realpath -m $tmpDir)/cache
+
+    rm -rf $tmpDir
+    procErrorCode $?
+
+    # the contents identify the source files
+    mkFile $in/Anna/IMG_20230105_101500.jpg a
+    mkFile $in/Anna/IMG_20230105_101501.jpg b
+    mkFile $in/Anna/IMG_20230106_080000.mp4 c
+    mkFile $in/Ben/20230105_101500.jpg d
+    mkFile "$in/Ben/20230105_101500(1).jpg" e
+    mkFile $in/Ben/20230107_235959.heic f
+    mkFile $in/Ben/20230109_070000.jpg i
+    mkFile $in/Carl/WP_20230105_10_15_00_Pro.jpg g
+    mkFile $in/Carl/WP_20230108_12_00_00_Pro.jpg h
+    mkFile $in/Dora/IMG_20230105_101500.jpg a
+    mkFile $in/Dora/IMG_20230105_101500_edit.jpg l
+    mkFile $in/Dora/IMG_20230110_090000.jpg j
+    mkFile $in/Dora/IMG_20230110_090001.jpg k
+    mkFile $in/Dora/notes.txt x
+    mkFile $in/Eve/notes.txt y
+    mkFile $in/Eve/todo.txt z
+
+    $exe -q $in/Anna $in/Ben $in/Carl $in/Dora $in/Eve $out </dev/null > /dev/null
+    testResult "exit code of a merge with errors" $(( $? == 0 ))
+
+    checkDir "all schemes" $out \
+"./20230105-101500-Anna.jpg a
+./20230105-101500-Ben.jpg d
+./20230105-101500-Ben_1.jpg e
+./20230105-101500-Carl-WP.jpg g
+./20230105-101500-Dora.jpg a
+./20230105-101500-Dora_edit.jpg l
+./20230105-101501-Anna.jpg b
+./20230106-080000-Anna.mp4 c
+./20230107-235959-Ben.heic f
+./20230108-120000-Carl-WP.jpg h
+./20230109-070000-Ben.jpg i
+./20230110-090000-Dora.jpg j
+./20230110-090001-Dora.jpg k"
+
+    rm -rf $out
+    $exe -q --layout=year/month $in/Anna $in/Carl $out </dev/null > /dev/null
+    testResult "exit code of a merge without errors" $?
+
+    checkDir "layout year/month" $out \
+"./2023/01/20230105-101500-Anna.jpg a
+./2023/01/20230105-101500-Carl-WP.jpg g
+./2023/01/20230105-101501-Anna.jpg b
+./2023/01/20230106-080000-Anna.mp4 c
+./2023/01/20230108-120000-Carl-WP.jpg h"
+
+    [ -f $XDG_CACHE_HOME/phodime/schemes ]
+    testResult "schemes are cached in XDG_CACHE_HOME" $?
+
+    rm -rf $out $XDG_CACHE_HOME
+    $exe -q --no-scheme-cache $in/Anna $out </dev/null > /dev/null
+    testResult "exit code of a merge without scheme cache" $?
+    [ ! -e $XDG_CACHE_HOME ]
+    testResult "no scheme cache is written with --no-scheme-cache" $?
+
+    rm -rf $out
+    mkFile $out/20230105-101500-Anna.jpg old
+    $exe -q $in/Anna $out </dev/null > /dev/null
+    testResult "exit code of a non empty OUTDIR" $(( $? == 0 ))
+    checkDir "non empty OUTDIR is not changed" $out "./20230105-101500-Anna.jpg old"
+
+    $exe -q -f $in/Anna $out </dev/null > /dev/null
+    testResult "exit code of a forced merge" $?
+
+    checkDir "forced merge overwrites" $out \
+"./20230105-101500-Anna.jpg a
+./20230105-101501-Anna.jpg b
+./20230106-080000-Anna.mp4 c"
+
+    rm -rf $out
+    $exe -q --verify=yes $in/Anna $out </dev/null > /dev/null
+    testResult "exit code of a value passed to a flag option" $(( $? == 0 ))
+    [ ! -e $out ]
+    testResult "no OUTDIR is created if a flag option has a value" $?
+
+    rm -rf $out
+    seq 0 256 | awk '{ printf "s%d X%d_{YYYY}{MM}{DD}_{hh}{mm}{ss}\n", $1, $1 }' > $tmpDir/schemes.txt
+    $exe -q --schemes=$tmpDir/schemes.txt $in/Anna $out </dev/null > /dev/null
+    testResult "exit code of a scheme file with too many schemes" $(( $? == 0 ))
+    [ ! -e $out ]
+    testResult "no OUTDIR is created if the scheme file is invalid" $?
+
+    # the captures of many {*} are found without backtracking
+    rm -rf $out
+    echo "stall {YYYY}{MM}{DD}_{hh}{mm}{ss}{*}{*}{*}{*}{*}{*}{*}{*}x{*} _{9}" > $tmpDir/schemes.txt
+    mkFile $in/Gina/20230113_090000ax$(printf 'b%.0s' $(seq 1 60)).jpg o
+    timeout 10 $exe -q --schemes=$tmpDir/schemes.txt $in/Gina $out </dev/null > /dev/null
+    testResult "exit code of a scheme with many captures" $?
+    checkDir "scheme with many captures" $out "./20230113-090000-Gina_$(printf 'b%.0s' $(seq 1 60)).jpg o"
+
+    rm -rf $out
+    $exe -q --mem-limit=1 $in/Anna $in/Ben $in/Carl $out </dev/null > /dev/null
+    testResult "exit code of a merge with a memory limit" $?
+
+    checkDir "memory limit" $out \
+"./20230105-101500-Anna.jpg a
+./20230105-101500-Ben.jpg d
+./20230105-101500-Ben_1.jpg e
+./20230105-101500-Carl-WP.jpg g
+./20230105-101501-Anna.jpg b
+./20230106-080000-Anna.mp4 c
+./20230107-235959-Ben.heic f
+./20230108-120000-Carl-WP.jpg h
+./20230109-070000-Ben.jpg i"
+
+    # the copy order doesn't change the result
+    rm -rf $out
+    $exe -q --physical-order $in/Anna $in/Ben $in/Carl $in/Dora $in/Eve $out </dev/null > /dev/null
+    testResult "exit code of a merge in physical order" $(( $? == 0 ))
+
+    checkDir "physical order" $out \
+"./20230105-101500-Anna.jpg a
+./20230105-101500-Ben.jpg d
+./20230105-101500-Ben_1.jpg e
+./20230105-101500-Carl-WP.jpg g
+./20230105-101500-Dora.jpg a
+./20230105-101500-Dora_edit.jpg l
+./20230105-101501-Anna.jpg b
+./20230106-080000-Anna.mp4 c
+./20230107-235959-Ben.heic f
+./20230108-120000-Carl-WP.jpg h
+./20230109-070000-Ben.jpg i
+./20230110-090000-Dora.jpg j
+./20230110-090001-Dora.jpg k"
+
+    # "query" is only the sub command as first argument
+    rm -rf $out
+    mkFile $in/query/IMG_20230112_090000.jpg q
+    local exePath
+    exePath=$(realpath $exe)
+    (cd $in && $exePath -q ./query ../out </dev/null > /dev/null)
+    testResult "exit code of an INDIR named query" $?
+    checkDir "INDIR named query" $out "./20230112-090000-query.jpg q"
+
+    # /dev/null can't be flushed (fsync fails with EINVAL), the failure is an error of the merge
+    ln -s /dev/null $tmpDir/null.tar
+    local output
+    output=$($exe --no-color -f --durability=end --output-archive=$tmpDir/null.tar $in/Anna </dev/null)
+    testResult "exit code of a failed flush" $(( $? == 0 ))
+    echo "$output" | grep -q "failed to flush" && ! echo "$output" | grep -q "fatal error"
+    testResult "failed flush is reported" $?
+
+    # files which are already merged are neither copied nor reported again while watching
+    rm -rf $out
+    mkFile $in/Fred/IMG_20230111_080000.jpg m
+    $exe -q --watch $in/Fred $out </dev/null > /dev/null &
+    local pid=$!
+    sleep 1
+    mkFile $in/Fred/IMG_20230111_080000.jpg m
+    mkFile $in/Fred/IMG_20230111_080001.jpg n
+    sleep 1
+    mkFile $in/Fred/IMG_20230111_080001.jpg n
+    sleep 1
+    kill -INT $pid
+    wait $pid
+    testResult "exit code of watching files written again" $?
+
+    checkDir "watch" $out \
+"./20230111-080000-Fred.jpg m
+./20230111-080001-Fred.jpg n"
+
+    rm -rf $tmpDir
+}
+
+# Merges perfFiles generated files and prints the files/s of the scan (enumeration and scheme detection), plan (tokenizing
+# and destination names) and copy phases, the best of three runs.
+function measure()
+{
+    local in=$tmpDir/in
+    local out=$tmpDir/out
+    local report=$tmpDir/report.json
+
+    rm -rf $tmpDir
+    mkdir -p $in/Anna $in/Ben
+
+    local half=$(( perfFiles / 2 ))
+    (cd $in/Anna && seq 0 $(( half - 1 )) | awk '{ printf "IMG_202301%02d_%02d%02d%02d.jpg\n", 1 + int($1 / 86400) % 28, int($1 / 3600) % 24, int($1 / 60) % 60, $1 % 60 }' | xargs touch)
+    (cd $in/Ben && seq 0 $(( perfFiles - half - 1 )) | awk '{ printf "202302%02d_%02d%02d%02d.jpg\n", 1 + int($1 / 86400) % 28, int($1 / 3600) % 24, int($1 / 60) % 60, $1 % 60 }' | xargs touch)
+
+    local best="0 0 0"
+    local rc=0
+
+    for i in 1 2 3
+    do
+        # without a home directory there is no scheme cache, so that the detection is timed too
+        rm -rf $out
+        XDG_CACHE_HOME= HOME= $exe -q --report=$report $in/Anna $in/Ben $out </dev/null > /dev/null || rc=1
+
+        # the first durations object is the one of the whole run
+        best=$(awk -v n=$perfFiles -v best="$best" '
+            /"(scan|plan|copy)":/ && !($1 in d) { gsub(/[",]/, ""); d[$1] = $2 }
+            END {
+                split(best, b, " ")
+                r[1] = n / d["scan:"]; r[2] = n / d["plan:"]; r[3] = n / d["copy:"]
+                for (i = 1; i <= 3; ++i) if (b[i] > r[i]) r[i] = b[i]
+                printf "%.0f %.0f %.0f\n", r[1], r[2], r[3]
+            }' $report)
+    done
+
+    rm -rf $tmpDir
+
+    echo $best
+    return $rc
+}
+
+function cmd_calibrate()
+{
+    local rates
+    rates=$(measure)
+    procErrorCode $?
+
+    if [ $errCnt -eq 0 ]
+    then
+        echo "$perfFiles $rates" > $baselineFile
+        echo "files/s of $perfFiles files (scan plan copy): $rates"
+    fi
+}
+
+function cmd_perf()
+{
+    local file=$baselineFile
+    local tolerance=$perfTolerance
+
+    if [ ! -f $file ]
+    then
+        echo "  no $baselineFile (./test.sh calibrate), checking against $floorFile"
+        file=$floorFile
+        tolerance=1
+    fi
+
+    local baseline
+    baseline=($(cat $file))
+
+    if [ "${baseline[0]}" != "$perfFiles" ]
+    then
+        echo "  skipped timed tests, $file is calibrated for ${baseline[0]} files"
+        return
+    fi
+
+    local rates
+    rates=($(measure))
+    procErrorCode $?
+
+    local phases=(scan plan copy)
+
+    for i in 0 1 2
+    do
+        awk -v r=${rates[$i]} -v b=${baseline[$(( i + 1 ))]} -v t=$tolerance 'BEGIN { exit !(r >= b * t) }'
+        testResult "${phases[$i]} ${rates[$i]} files/s (baseline ${baseline[$(( i + 1 ))]})" $?
+    done
+}
+
+# Generates an INDIR whose files are written in random order, so that their order on the disk doesn't match the
+# chronological copy order, and prints the wall time of a merge in the default order and with --physical-order.
+function cmd_order()
+{
+    local in=$tmpDir/in
+    local out=$tmpDir/out
+
+    rm -rf $tmpDir
+    mkdir -p $in/Anna
+
+    seq 0 $(( orderFiles - 1 )) | awk '{ printf "IMG_202301%02d_%02d%02d%02d.jpg\n", 1 + int($1 / 86400) % 28, int($1 / 3600) % 24, int($1 / 60) % 60, $1 % 60 }' | shuf | while read -r f
+    do
+        head -c $orderSize /dev/urandom > $in/Anna/$f
+    done
+    sync
+
+    local order
+    for order in default physical default physical
+    do
+        rm -rf $out
+        sync
+        if [ $(id -u) -eq 0 ]; then echo 3 > /proc/sys/vm/drop_caches; fi
+
+        local opt=""
+        if [ $order == "physical" ]; then opt="--physical-order"; fi
+
+        local start=$(date +%s.%N)
+        XDG_CACHE_HOME= HOME= $exe -q $opt $in/Anna $out </dev/null > /dev/null
+        procErrorCode $?
+        local end=$(date +%s.%N)
+
+        awk -v o=$order -v s=$start -v e=$end -v n=$orderFiles 'BEGIN { printf "  %-9s %6.2fs  %6.0f files/s\n", o, e - s, n / (e - s) }'
+    done
+
+    if [ $(id -u) -ne 0 ]; then echo "  the page cache has not been dropped, run as root to read from the disk"; fi
+
+    rm -rf $tmpDir
+}
+
+function procArg()
+{
+    ptintTitle "$echoTitle - $1" 4
+
+    if [ "$1" == "system" ]; then cmd_system
+    elif [ "$1" == "functional" ]; then cmd_functional
+    elif [ "$1" == "perf" ]; then cmd_perf
+    elif [ "$1" == "calibrate" ]; then cmd_calibrate
+    elif [ "$1" == "order" ]; then cmd_order
+    else
+        printHelp
+    fi
+}
+
+
+
+if [ "$1" == "" ]
+then
+    procArg system
+    procArg functional
+    procArg perf
+else
+    for arg in "$@"; do procArg $arg; done
+fi
+
+
+
+exitCode=0
+if [ $errCnt -ne 0 ]
+then
+    exitCode=1
+    ptintTitle "$echoTitle - failed" 1
+else
+    ptintTitle "$echoTitle - OK" 2
+fi
+
+exit $exitCode
@@ -4,6 +4,11 @@ date            20.11.2022
 copyright       GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
 */
 
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -18,6 +23,23 @@ copyright       GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
 
 namespace
 {
+    void splitInDirList(const std::string& data, char separator, std::vector<std::string>& inDirs)
+    {
+        size_t pos = 0;
+
+        while (pos < data.size())
+        {
+            size_t end = data.find(separator, pos);
+            if (end == std::string::npos) end = data.size();
+
+            size_t len = end - pos;
+            if ((separator == '\n') && (len > 0) && (data[pos + len - 1] == '\r')) --len;
+
+            if (len > 0) inDirs.push_back(data.substr(pos, len));
+
+            pos = end + 1;
+        }
+    }
 }
 
 
@@ -35,7 +57,7 @@ bool app::FileList::isValid() const
 
 
 app::OptionList::OptionList()
-    : m_unrecognizedIdx(OMW_SIZE_MAX), m_isValid(true)
+    : m_unrecognizedIdx(OMW_SIZE_MAX), m_isValid(true), m_valuePending(false)
 { }
 
 void app::OptionList::add(const omw::string& opt)
@@ -49,6 +71,21 @@ void app::OptionList::add(const omw::string& opt)
                 addOpt(omw::string("-") + opt[i]);
             }
         }
+        else if ((opt[1] == '-') && opt.contains('='))
+        {
+            const size_t pos = opt.find('=');
+
+            addOpt(opt.substr(0, pos));
+
+            if (m_valuePending) setValue(opt.substr(pos + 1));
+            else
+            {
+                // "--flag=VALUE" of an option which doesn't take a value is kept as a whole and is unrecognized
+                this->back() = opt;
+                m_isValid = false;
+                m_unrecognizedIdx = this->size() - 1;
+            }
+        }
         else addOpt(opt);
     }
     else addOpt(opt);
@@ -66,6 +103,21 @@ bool app::OptionList::contains(const omw::string& arg) const
     return r;
 }
 
+omw::string app::OptionList::value(const omw::string& opt) const
+{
+    const auto it = m_values.find(opt);
+    return (it != m_values.end() ? it->second : "");
+}
+
+void app::OptionList::setValue(const omw::string& value)
+{
+    if (m_valuePending)
+    {
+        m_values[this->back()] = value;
+        m_valuePending = false;
+    }
+}
+
 omw::string app::OptionList::unrecognized() const
 {
     return (m_unrecognizedIdx != OMW_SIZE_MAX ? this->at(m_unrecognizedIdx) : "");
@@ -79,18 +131,64 @@ void app::OptionList::addOpt(const omw::string& opt)
         m_unrecognizedIdx = this->size();
     }
 
+    m_valuePending = checkValueOpt(opt);
+
     this->push_back(opt);
 }
 
 bool app::OptionList::checkOpt(const omw::string& opt) const
 {
     return (
+        (opt == argstr::deviceJobs) ||
+        (opt == argstr::durability) ||
         (opt == argstr::force) ||
+        (opt == argstr::from) ||
         (opt == argstr::help) || (opt == argstr::help_alt) ||
+        (opt == argstr::index) ||
+        (opt == argstr::indexCsv) ||
+        (opt == argstr::inDirsFrom) ||
+        (opt == argstr::layout) ||
+        (opt == argstr::maxBandwidth) ||
+        (opt == argstr::maxIops) ||
+        (opt == argstr::memLimit) ||
+        (opt == argstr::nearDedup) ||
         (opt == argstr::noColor) ||
+        (opt == argstr::noSchemeCache) ||
+        (opt == argstr::outputArchive) ||
+        (opt == argstr::physicalOrder) ||
+        (opt == argstr::preserve) ||
         (opt == argstr::quiet) ||
+        (opt == argstr::report) ||
+        (opt == argstr::schemes) ||
+        (opt == argstr::to) ||
         (opt == argstr::verbose) ||
-        (opt == argstr::version)
+        (opt == argstr::verify) ||
+        (opt == argstr::verifyNoCache) ||
+        (opt == argstr::version) ||
+        (opt == argstr::watch) ||
+        (opt == argstr::who) ||
+        (opt == argstr::writeJobs)
+        );
+}
+
+bool app::OptionList::checkValueOpt(const omw::string& opt) const
+{
+    return (
+        (opt == argstr::deviceJobs) ||
+        (opt == argstr::durability) ||
+        (opt == argstr::from) ||
+        (opt == argstr::inDirsFrom) ||
+        (opt == argstr::layout) ||
+        (opt == argstr::maxBandwidth) ||
+        (opt == argstr::maxIops) ||
+        (opt == argstr::memLimit) ||
+        (opt == argstr::outputArchive) ||
+        (opt == argstr::preserve) ||
+        (opt == argstr::report) ||
+        (opt == argstr::schemes) ||
+        (opt == argstr::to) ||
+        (opt == argstr::who) ||
+        (opt == argstr::writeJobs)
         );
 }
 
@@ -108,7 +206,10 @@ void app::Args::parse(int argc, char** argv)
 
 void app::Args::add(const omw::string& arg)
 {
-    if (arg[0] == '-') m_options.add(arg);
+    if ((count() == 0) && (arg == argstr::cmdQuery)) m_query = true;
+
+    if (m_options.valuePending()) m_options.setValue(arg);
+    else if (arg[0] == '-') m_options.add(arg);
 #ifdef OMW_PLAT_WIN
     else if (arg == "/?") m_options.add(argstr::help);
 #endif
@@ -119,7 +220,8 @@ std::vector<std::string> app::Args::inDirs() const
 {
     std::vector<std::string> r;
     
-    const size_t n = m_files.size() - 1;
+    // with an output archive all files are INDIRs
+    const size_t n = (containsOutputArchive() ? m_files.size() + 1 : m_files.size()) - 1;
 
     if (n > 0) // needed because size is unsigned
     {
@@ -134,6 +236,7 @@ std::vector<std::string> app::Args::inDirs() const
 
 std::string app::Args::outDir() const
 {
+    if (containsOutputArchive()) return outputArchive();
     return m_files.back();
 }
 
@@ -151,6 +254,9 @@ bool app::Args::isValid() const
 {
     return (
         (m_files.isValid() && m_options.isValid()) ||
+        (!m_files.empty() && m_options.isValid() && containsOutputArchive()) ||
+        (!m_files.empty() && m_options.isValid() && containsInDirsFrom()) ||
+        (m_options.isValid() && containsInDirsFrom() && containsOutputArchive()) ||
         (m_options.isValid() && (containsHelp() || containsVersion()))
         );
 }
@@ -160,3 +266,24 @@ const omw::string& app::Args::operator[](size_t idx) const
     if (idx < m_options.size()) return m_options[idx];
     else return m_files[idx - m_options.size()];
 }
+
+
+
+bool app::readInDirList(const std::string& file, std::vector<std::string>& inDirs)
+{
+    std::string data;
+
+    if (file == "-") data.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    else
+    {
+        std::ifstream ifs(std::filesystem::u8path(file), std::ios::in | std::ios::binary);
+        if (!ifs.good()) return false;
+
+        data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        if (ifs.bad()) return false;
+    }
+
+    splitInDirList(data, ((data.find('\0') != std::string::npos) ? '\0' : '\n'), inDirs);
+
+    return true;
+}
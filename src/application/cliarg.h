@@ -7,6 +7,7 @@ copyright       GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
 #ifndef IG_APP_CLIARG_H
 #define IG_APP_CLIARG_H
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -20,14 +21,44 @@ namespace argstr
     // - app::OptionList::checkOpt()
     // - Args::containsXY() const
     // - help text
+    //
+    // options taking a value are also added to
+    // - app::OptionList::checkValueOpt()
+    // and can be passed as "--opt=VALUE" or "--opt VALUE"
 
+    const char* const deviceJobs = "--device-jobs";
+    const char* const durability = "--durability";
     const char* const force = "-f";
+    const char* const from = "--from";
     const char* const help = "-h";
     const char* const help_alt = "--help";
+    const char* const index = "--index";
+    const char* const indexCsv = "--index-csv";
+    const char* const inDirsFrom = "--indirs-from";
+    const char* const layout = "--layout";
+    const char* const maxBandwidth = "--max-bandwidth";
+    const char* const maxIops = "--max-iops";
+    const char* const memLimit = "--mem-limit";
+    const char* const nearDedup = "--near-dedup";
     const char* const noColor = "--no-color";
+    const char* const noSchemeCache = "--no-scheme-cache";
+    const char* const outputArchive = "--output-archive";
+    const char* const physicalOrder = "--physical-order";
+    const char* const preserve = "--preserve";
     const char* const quiet = "-q";
+    const char* const report = "--report";
+    const char* const schemes = "--schemes";
+    const char* const to = "--to";
     const char* const verbose = "-v";
+    const char* const verify = "--verify";
+    const char* const verifyNoCache = "--verify-nocache";
     const char* const version = "--version";
+    const char* const watch = "--watch";
+    const char* const who = "--who";
+    const char* const writeJobs = "--write-jobs";
+
+    // sub commands, passed as first non option argument
+    const char* const cmdQuery = "query";
 }
 
 namespace app
@@ -55,39 +86,92 @@ namespace app
 
         virtual bool contains(const omw::string& arg) const;
 
+        // returns the value of an option taking a value, or an empty string if there is none
+        omw::string value(const omw::string& opt) const;
+        void setValue(const omw::string& value);
+        bool valuePending() const { return m_valuePending; }
+
         omw::string unrecognized() const;
 
-        bool isValid() const { return m_isValid; }
+        bool isValid() const { return (m_isValid && !m_valuePending); }
 
     private:
         size_t m_unrecognizedIdx;
         bool m_isValid;
+        bool m_valuePending;
+        std::map<omw::string, omw::string> m_values;
 
         void addOpt(const omw::string& opt);
         bool checkOpt(const omw::string& opt) const;
+        bool checkValueOpt(const omw::string& opt) const;
     };
 
     class Args
     {
     public:
-        Args() {}
-        Args(int argc, char** argv) { parse(argc, argv); }
+        Args() : m_query(false) {}
+        Args(int argc, char** argv) : m_query(false) { parse(argc, argv); }
         virtual ~Args() {}
 
         void parse(int argc, char** argv);
         void add(const omw::string& arg);
 
+        // With --output-archive all files are INDIRs and outDir() is the archive file. The INDIRs of --indirs-from are
+        // not included, see app::readInDirList().
         std::vector<std::string> inDirs() const;
         std::string outDir() const;
 
+        // "phodime query [options] OUTDIR", only if "query" is the first argument (an INDIR named query can be passed
+        // as "./query" or after an option)
+        bool isQuery() const { return m_query; }
+
         OptionList& options() { return m_options; }
         const OptionList& options() const { return m_options; }
+        bool containsDeviceJobs() const { return m_options.contains(argstr::deviceJobs); }
+        bool containsDurability() const { return m_options.contains(argstr::durability); }
         bool containsForce() const { return m_options.contains(argstr::force); }
+        bool containsFrom() const { return m_options.contains(argstr::from); }
         bool containsHelp() const { return (m_options.contains(argstr::help) || m_options.contains(argstr::help_alt)); }
+        bool containsIndex() const { return (m_options.contains(argstr::index) || containsIndexCsv()); }
+        bool containsIndexCsv() const { return m_options.contains(argstr::indexCsv); }
+        bool containsInDirsFrom() const { return m_options.contains(argstr::inDirsFrom); }
+        bool containsLayout() const { return m_options.contains(argstr::layout); }
+        bool containsMaxBandwidth() const { return m_options.contains(argstr::maxBandwidth); }
+        bool containsMaxIops() const { return m_options.contains(argstr::maxIops); }
+        bool containsMemLimit() const { return m_options.contains(argstr::memLimit); }
+        bool containsNearDedup() const { return m_options.contains(argstr::nearDedup); }
         bool containsNoColor() const { return m_options.contains(argstr::noColor); }
+        bool containsNoSchemeCache() const { return m_options.contains(argstr::noSchemeCache); }
+        bool containsOutputArchive() const { return m_options.contains(argstr::outputArchive); }
+        bool containsPhysicalOrder() const { return m_options.contains(argstr::physicalOrder); }
+        bool containsPreserve() const { return m_options.contains(argstr::preserve); }
         bool containsQuiet() const { return m_options.contains(argstr::quiet); }
+        bool containsReport() const { return m_options.contains(argstr::report); }
+        bool containsSchemes() const { return m_options.contains(argstr::schemes); }
+        bool containsTo() const { return m_options.contains(argstr::to); }
         bool containsVerbose() const { return m_options.contains(argstr::verbose); }
+        bool containsVerify() const { return (m_options.contains(argstr::verify) || containsVerifyNoCache()); }
+        bool containsVerifyNoCache() const { return m_options.contains(argstr::verifyNoCache); }
         bool containsVersion() const { return m_options.contains(argstr::version); }
+        bool containsWatch() const { return m_options.contains(argstr::watch); }
+        bool containsWho() const { return m_options.contains(argstr::who); }
+        bool containsWriteJobs() const { return m_options.contains(argstr::writeJobs); }
+
+        omw::string deviceJobs() const { return m_options.value(argstr::deviceJobs); }
+        omw::string durability() const { return m_options.value(argstr::durability); }
+        omw::string from() const { return m_options.value(argstr::from); }
+        omw::string inDirsFrom() const { return m_options.value(argstr::inDirsFrom); }
+        omw::string layout() const { return m_options.value(argstr::layout); }
+        omw::string maxBandwidth() const { return m_options.value(argstr::maxBandwidth); }
+        omw::string maxIops() const { return m_options.value(argstr::maxIops); }
+        omw::string memLimit() const { return m_options.value(argstr::memLimit); }
+        omw::string outputArchive() const { return m_options.value(argstr::outputArchive); }
+        omw::string preserve() const { return m_options.value(argstr::preserve); }
+        omw::string report() const { return m_options.value(argstr::report); }
+        omw::string schemes() const { return m_options.value(argstr::schemes); }
+        omw::string to() const { return m_options.value(argstr::to); }
+        omw::string who() const { return m_options.value(argstr::who); }
+        omw::string writeJobs() const { return m_options.value(argstr::writeJobs); }
 
         size_t count() const;
         size_t size() const;
@@ -99,7 +183,13 @@ namespace app
     private:
         FileList m_files;
         OptionList m_options;
+        bool m_query;
     };
+
+    // Appends the paths of an INDIR list file ("-" is stdin) to inDirs. The paths are separated by NUL if the file
+    // contains any, otherwise by line breaks (LF or CRLF). Empty paths are ignored. Returns false if the file can't be
+    // read.
+    bool readInDirList(const std::string& file, std::vector<std::string>& inDirs);
 }
 
 #endif // IG_APP_CLIARG_H
@@ -0,0 +1,1854 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "merger.h"
+#include "middleware/archive.h"
+#include "middleware/copy.h"
+#include "middleware/direnum.h"
+#include "middleware/dirwatch.h"
+#include "middleware/hashindex.h"
+#include "middleware/imagehash.h"
+#include "middleware/ratelimit.h"
+#include "middleware/spscring.h"
+#include "middleware/syncer.h"
+#include "middleware/util.h"
+#include "middleware/workerpool.h"
+#include "middleware/xxhash.h"
+#include "plan.h"
+#include "project.h"
+#include "scheme.h"
+
+#include <omw/string.h>
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    bool equivalent(const std::vector<app::InDir>& inDirs, const fs::path& outDir)
+    {
+        bool r = false;
+
+        for (size_t i = 0; (i < inDirs.size()) && !r; ++i)
+        {
+            if (fs::exists(inDirs[i].path)) r = fs::equivalent(inDirs[i].path, outDir);
+        }
+
+        return r;
+    }
+
+    std::string getDirName(const fs::path& dir)
+    {
+        std::string r;
+
+        if (dir.has_filename()) r = dir.filename().u8string();
+        else r = dir.parent_path().filename().u8string();
+
+        return r;
+    }
+
+    // for the copy and verify jobs, which are mostly waiting for I/O
+    size_t nWorkers()
+    {
+        return std::min<size_t>(std::max<size_t>(std::thread::hardware_concurrency(), 2), 4);
+    }
+
+    // Number of consecutive plan entries which are sorted by their position on the source device if
+    // app::Options::physicalOrder is set. Bounds the lookups before the first copy, and keeps the progress roughly
+    // chronological.
+    constexpr size_t physicalOrderWindow = 4096;
+
+    // plan entries passed together to app::copy(), so that the small files are read and written in bursts
+    constexpr size_t copyBatchSize = 64;
+
+    // capacity of the ring buffers between the stages of app::Merger::planAndExecute(), files which are planned but not
+    // copied yet and copied but not reported yet
+    constexpr size_t pipelineCapacity = 256;
+
+    // files flushed together with app::DURABILITY::batched, and the longest time a copied file waits for its flush
+    constexpr size_t syncBatchSize = 64;
+    constexpr double syncInterval = 0.5;
+
+    // JPEGs without EXIF thumbnail up to this size are hashed by their main image
+    constexpr uint64_t mainImageHashSize = 2 * 1024 * 1024;
+
+    bool isJpeg(const std::string_view& fileName)
+    {
+        const std::string ext = omw::string(fs::u8path(fileName).extension().u8string()).toLower_ascii();
+        return ((ext == ".jpg") || (ext == ".jpeg"));
+    }
+
+    // reads up to size bytes of the start of the file, or of the member if the INDIR is an archive
+    std::vector<uint8_t> readHead(const app::InDir& inDir, const std::string_view& fileName, size_t size)
+    {
+        std::vector<uint8_t> r;
+
+        if (inDir.archive)
+        {
+            const auto* const member = inDir.archive->find(fileName);
+
+            if (member)
+            {
+                std::error_code ec;
+                r.reserve((size_t)std::min<uint64_t>(member->size, size));
+
+                inDir.archive->read(*member, [&r, size](const uint8_t* data, size_t n)
+                    {
+                        r.insert(r.end(), data, data + std::min(n, size - r.size()));
+                        return (r.size() < size);
+                    }, ec);
+            }
+        }
+        else
+        {
+            std::ifstream ifs((fs::path(inDir.path) / fs::u8path(fileName)), std::ios::in | std::ios::binary);
+
+            r.resize(size);
+            ifs.read((char*)(r.data()), (std::streamsize)size);
+            r.resize(ifs.gcount() > 0 ? (size_t)ifs.gcount() : 0);
+        }
+
+        return r;
+    }
+
+    // Perceptual hash of the EXIF thumbnail of a JPEG, or of the main image if there is no thumbnail and the file is
+    // small. Returns 0 if the file has no (distinctive) hash, util::jpegHash() never produces 0.
+    uint64_t imageHash(const app::InDir& inDir, const std::string_view& fileName)
+    {
+        uint64_t r = 0;
+
+        if (isJpeg(fileName))
+        {
+            auto data = readHead(inDir, fileName, util::exifHeadSize);
+            const uint8_t* thumbnail;
+            size_t thumbnailSize;
+
+            if (util::exifThumbnail(data.data(), data.size(), thumbnail, thumbnailSize))
+            {
+                if (!util::jpegHash(thumbnail, thumbnailSize, r)) r = 0;
+            }
+            else
+            {
+                if (data.size() == util::exifHeadSize) data = readHead(inDir, fileName, mainImageHashSize + 1);
+                if ((data.size() > mainImageHashSize) || !util::jpegHash(data.data(), data.size(), r)) r = 0;
+            }
+        }
+
+        return r;
+    }
+}
+
+
+
+bool app::parseLayout(const std::string& str, app::layout_t& layout)
+{
+    bool r = true;
+
+    if (str == "flat") layout = LAYOUT::flat;
+    else if (str == "year") layout = LAYOUT::year;
+    else if (str == "year/month") layout = LAYOUT::year_month;
+    else if (str == "year/month/day") layout = LAYOUT::year_month_day;
+    else r = false;
+
+    return r;
+}
+
+
+
+bool app::parseDurability(const std::string& str, app::durability_t& durability)
+{
+    bool r = true;
+
+    if (str == "none") durability = DURABILITY::none;
+    else if (str == "file") durability = DURABILITY::perFile;
+    else if (str == "batch") durability = DURABILITY::batched;
+    else if (str == "end") durability = DURABILITY::atEnd;
+    else r = false;
+
+    return r;
+}
+
+bool app::parseOutputArchive(const std::string& file, app::output_t& output)
+{
+    bool r = true;
+    const std::string ext = omw::string(fs::u8path(file).extension().u8string()).toLower_ascii();
+
+    if (ext == ".tar") output = OUTPUT::tar;
+    else if (ext == ".zip") output = OUTPUT::zip;
+    else r = false;
+
+    return r;
+}
+
+bool app::parsePreserve(const std::string& str, bool& times)
+{
+    bool r = true;
+
+    times = false;
+
+    for (const auto& attr : omw_::split(str, ','))
+    {
+        if (attr == "times") times = true;
+        else if (attr == "mode") {} // nop, the permissions are always copied
+        else r = false;
+    }
+
+    return r;
+}
+
+bool app::parseJobs(const std::string& str, size_t& value)
+{
+    if (str.empty() || (str.length() > 6) || (str.find_first_not_of("0123456789") != std::string::npos)) return false;
+
+    value = (size_t)std::stoul(str);
+
+    return (value > 0);
+}
+
+bool app::parseRate(const std::string& str, uint64_t& value)
+{
+    return parseSize(str, value);
+}
+
+bool app::parseSize(const std::string& str, uint64_t& value)
+{
+    std::string digits = str;
+    uint64_t factor = 1;
+
+    if (!digits.empty())
+    {
+        const char suffix = digits.back();
+
+        if ((suffix == 'K') || (suffix == 'k')) factor = 1024;
+        else if ((suffix == 'M') || (suffix == 'm')) factor = 1024 * 1024;
+        else if ((suffix == 'G') || (suffix == 'g')) factor = 1024 * 1024 * 1024;
+
+        if (factor != 1) digits.pop_back();
+    }
+
+    if (digits.empty() || (digits.length() > 9) || (digits.find_first_not_of("0123456789") != std::string::npos)) return false;
+
+    value = std::stoull(digits) * factor;
+
+    return (value > 0);
+}
+
+std::string app::layoutDir(const app::layout_t& layout, const std::string& date)
+{
+    std::string r;
+
+    if (layout != LAYOUT::flat) r = date.substr(0, 4);
+    if ((layout == LAYOUT::year_month) || (layout == LAYOUT::year_month_day)) r += '/' + date.substr(4, 2);
+    if (layout == LAYOUT::year_month_day) r += '/' + date.substr(6, 2);
+
+    return r;
+}
+
+
+
+fs::path app::OutDirCache::path(const std::string& date) const
+{
+    const std::string dir = layoutDir(m_layout, date);
+
+    if (dir.empty()) return m_outDir;
+
+    return (m_outDir / dir).make_preferred();
+}
+
+fs::path app::OutDirCache::get(const std::string& date, std::error_code& ec)
+{
+    ec.clear();
+
+    const size_t len = keyLen();
+
+    if (len == 0) return m_outDir;
+
+    const std::string key = date.substr(0, len);
+
+    const auto it = m_dirs.find(key);
+    if (it != m_dirs.end()) return it->second;
+
+    const fs::path dir = path(date);
+
+    fs::create_directories(dir, ec);
+    if (ec) return fs::path();
+
+    m_dirs.emplace(key, dir);
+
+    return dir;
+}
+
+const std::string& app::OutDirCache::u8prefix(const std::string& date)
+{
+    const auto it = m_prefixes.find(date.substr(0, keyLen()));
+    if (it != m_prefixes.end()) return it->second;
+
+    std::string prefix = path(date).u8string();
+    if (!prefix.empty()) prefix += (char)(fs::path::preferred_separator);
+
+    return m_prefixes.emplace(date.substr(0, keyLen()), prefix).first->second;
+}
+
+std::vector<fs::path> app::OutDirCache::created() const
+{
+    size_t depth;
+
+    if (m_layout == LAYOUT::year) depth = 1;
+    else if (m_layout == LAYOUT::year_month) depth = 2;
+    else if (m_layout == LAYOUT::year_month_day) depth = 3;
+    else depth = 0;
+
+    std::set<fs::path> dirs;
+
+    for (const auto& it : m_dirs)
+    {
+        fs::path dir = it.second;
+
+        for (size_t i = 0; i < depth; ++i)
+        {
+            dirs.insert(dir);
+            dir = dir.parent_path();
+        }
+    }
+
+    return std::vector<fs::path>(dirs.begin(), dirs.end());
+}
+
+size_t app::OutDirCache::keyLen() const
+{
+    size_t r;
+
+    if (m_layout == LAYOUT::year) r = 4;
+    else if (m_layout == LAYOUT::year_month) r = 6;
+    else if (m_layout == LAYOUT::year_month_day) r = 8;
+    else r = 0;
+
+    return r;
+}
+
+
+
+app::Merger::Merger(const std::vector<std::string>& inDirs, const std::string& outDir, const app::Options& options)
+    : m_inDirs(inDirs.size()), m_outDir(outDir), m_options(options), m_outDirCache((options.output == OUTPUT::directory ? fs::path(outDir) : fs::path()), options.layout), m_nExecuted(0), m_nDoneBefore(0), m_nDropped(0), m_manifestFailed(false)
+{
+    for (size_t i = 0; i < inDirs.size(); ++i)
+    {
+        auto& inDir = m_inDirs[i];
+
+        inDir.path = inDirs[i];
+        inDir.device = 0;
+        inDir.status = InDir::pending;
+        inDir.scheme = SCHEME::unknown;
+        inDir.rate = 0;
+        inDir.schemeCached = false;
+    }
+
+    if ((options.memLimit != 0) && (options.watch || options.nearDedup)) throw (int)(__LINE__);
+
+    if (options.nearDedup) m_nearIndex = std::make_unique<util::HashIndex>(app::nearDedupRadius);
+
+    if ((options.maxBandwidth != util::RateLimiter::unlimited) || (options.maxIops != util::RateLimiter::unlimited))
+    {
+        m_limiter = std::make_unique<util::RateLimiter>(options.maxBandwidth, options.maxIops);
+    }
+
+    if ((options.durability == DURABILITY::batched) && (options.output == OUTPUT::directory))
+    {
+        m_syncer = std::make_unique<util::Syncer>(syncBatchSize, syncInterval);
+    }
+}
+
+app::Merger::~Merger()
+{}
+
+bool app::Merger::scan()
+{
+    if (!checkOutDir()) return false;
+
+    const util::Stopwatch sw;
+
+    if (m_options.watch) m_watcher = std::make_unique<util::DirWatcher>();
+
+    if (m_options.memLimit != 0)
+    {
+        const fs::path dir = ((m_options.output == OUTPUT::directory) ? fs::u8path(m_outDir) : fs::u8path(m_outDir).parent_path());
+        m_spill = std::make_unique<PlanSpill>((dir.empty() ? fs::path(".") : dir), m_options.memLimit);
+    }
+
+    if (!m_options.schemeCacheFile.empty())
+    {
+        m_schemeCache = std::make_unique<SchemeCache>(m_options.schemeCacheFile);
+        m_schemeCache->load();
+    }
+
+    std::unordered_set<std::string> usedNames;
+
+    for (size_t i = 0; i < m_inDirs.size(); ++i)
+    {
+        const util::Stopwatch swInDir;
+        scanInDir(i, usedNames);
+        m_inDirs[i].durations.addScan(swInDir.elapsed());
+
+        if (m_spill) plan(i);
+    }
+
+    // the cache is an optimisation only, failing to write it is not reported
+    if (m_schemeCache) m_schemeCache->save();
+
+    m_durations.addScan(sw.elapsed());
+
+    return true;
+}
+
+void app::Merger::plan()
+{
+    for (size_t i = 0; i < m_inDirs.size(); ++i) plan(i);
+}
+
+void app::Merger::plan(size_t inDirIdx)
+{
+    const util::Stopwatch sw;
+
+    if (planInDir(inDirIdx, nullptr))
+    {
+        const double duration = sw.elapsed();
+        m_inDirs[inDirIdx].durations.addPlan(duration);
+        m_durations.addPlan(duration);
+    }
+}
+
+// Planning and reporting run on this thread, copying (and verifying) on a worker. The stages are connected by two
+// rings, if the copy stage falls behind the planning waits and reports meanwhile. The directories are created before
+// the entries are handed over, OutDirCache is not thread safe.
+void app::Merger::planAndExecute(size_t inDirIdx)
+{
+    if (planAllFirst() || m_options.physicalOrder)
+    {
+        plan(inDirIdx);
+        execute();
+        return;
+    }
+
+    using Done = std::pair<PlanEntry, CopyResult>;
+
+    util::SpscRing<PlanEntry> planned(pipelineCapacity);
+    util::SpscRing<Done> done(pipelineCapacity);
+    std::atomic<bool> planning(true);
+    std::atomic<bool> aborted(false);
+    double copyDuration = 0; // written by the worker, read after it has finished
+
+    const size_t nDoneBefore = m_nExecuted;
+    size_t nPushed = 0;
+    size_t nReported = 0;
+
+    const auto reportDone = [&]()
+    {
+        Done d;
+        bool r = false;
+
+        while (done.tryPop(d))
+        {
+            reportResult(d.first, d.second);
+            ++nReported;
+            progress(nDoneBefore + nReported, m_plan.size());
+            r = true;
+        }
+
+        return r;
+    };
+
+    double planDuration = 0;
+    double stageDuration = 0; // pushing and reporting while planning
+    bool plannedInDir = false;
+
+    {
+        util::WorkerPool pool(1);
+
+        pool.submit([this, &planned, &done, &planning, &aborted, &copyDuration]()
+            {
+                const bool verify = m_options.verify;
+                const bool noCache = m_options.verifyNoCache;
+                util::Backoff backoff;
+                std::vector<PlanEntry> batch;
+                std::vector<CopyResult> results;
+                PlanEntry e;
+
+                while (!aborted.load(std::memory_order_relaxed))
+                {
+                    // planning is read first, so that the last entries are in the ring if it's false
+                    const bool last = !planning.load(std::memory_order_acquire);
+
+                    batch.clear();
+                    while ((batch.size() < copyBatchSize) && planned.tryPop(e)) batch.push_back(std::move(e));
+
+                    if (batch.empty())
+                    {
+                        if (last) break;
+
+                        backoff.wait();
+                        continue;
+                    }
+
+                    backoff.reset();
+
+                    const util::Stopwatch swCopy;
+
+                    app::copy(batch, m_options, m_limiter.get(), m_syncer.get(), results);
+
+                    for (size_t i = 0; i < batch.size(); ++i)
+                    {
+                        if (verify && results[i].copied) results[i] = app::verify(batch[i], results[i], noCache, m_limiter.get());
+                    }
+
+                    copyDuration += swCopy.elapsed();
+
+                    for (size_t i = 0; i < batch.size(); ++i)
+                    {
+                        Done d(std::move(batch[i]), results[i]);
+                        while (!done.tryPush(std::move(d)) && !aborted.load(std::memory_order_relaxed)) backoff.wait();
+                    }
+
+                    backoff.reset();
+                }
+            });
+
+        try
+        {
+            util::Backoff backoff;
+            const util::Stopwatch swPlan;
+
+            plannedInDir = planInDir(inDirIdx, [&](size_t planIdx)
+                {
+                    if (planIdx == Plan::npos) return;
+
+                    const util::Stopwatch swStage;
+
+                    // the plan entries are handed over in order, execute() must not pick them up
+                    PlanEntry e = this->entry(planIdx);
+                    m_nExecuted = planIdx + 1;
+
+                    std::error_code ec;
+                    m_outDirCache.get(e.date, ec);
+
+                    if (ec)
+                    {
+                        // counted as handed over and reported, it doesn't pass the rings
+                        reportResult(e, CopyResult{ false, ec, 0 });
+                        ++nPushed;
+                        ++nReported;
+                        progress(nDoneBefore + nReported, m_plan.size());
+
+                        stageDuration += swStage.elapsed();
+                        return;
+                    }
+
+                    while (!planned.tryPush(std::move(e)))
+                    {
+                        if (reportDone()) backoff.reset();
+                        else backoff.wait();
+                    }
+
+                    ++nPushed;
+                    reportDone();
+
+                    stageDuration += swStage.elapsed();
+                });
+
+            planDuration = std::max(swPlan.elapsed() - stageDuration, 0.0);
+            planning.store(false, std::memory_order_release);
+
+            while (nReported < nPushed)
+            {
+                if (reportDone()) backoff.reset();
+                else backoff.wait();
+            }
+        }
+        catch (...)
+        {
+            aborted = true;
+            planning = false;
+            throw;
+        }
+    }
+
+    if (m_manifest) m_manifest->flush();
+
+    // the stages overlap, these are the times they have been busy
+    if (plannedInDir)
+    {
+        m_inDirs[inDirIdx].durations.addPlan(planDuration);
+        m_durations.addPlan(planDuration);
+    }
+
+    m_durations.addCopy(copyDuration);
+}
+
+// Determines the destination of every file of one INDIR, onPlanned is called after each file with the plan index or
+// app::Plan::npos. Returns false if the INDIR has not been planned (not valid or no files).
+bool app::Merger::planInDir(size_t inDirIdx, const std::function<void(size_t planIdx)>& onPlanned)
+{
+    auto& inDir = m_inDirs.at(inDirIdx);
+
+    // the file list is released after planning, see also scan()
+    if ((inDir.status != InDir::ok) || inDir.files.empty()) return false;
+
+    // the files are read in parallel, the hashes are compared in the order of planning
+    std::vector<uint64_t> hashes;
+
+    if (m_nearIndex)
+    {
+        hashes.resize(inDir.files.size(), 0);
+
+        util::WorkerPool pool(::nWorkers());
+        const size_t chunkSize = 64;
+
+        for (size_t begin = 0; begin < inDir.files.size(); begin += chunkSize)
+        {
+            pool.submit([&inDir, &hashes, begin, end = std::min(begin + chunkSize, inDir.files.size())]()
+                {
+                    for (size_t i = begin; i < end; ++i) hashes[i] = ::imageHash(inDir, inDir.fileName(inDir.files[i]));
+                });
+        }
+
+        pool.wait();
+    }
+
+    for (size_t i = 0; i < inDir.files.size(); ++i)
+    {
+        const auto& inFile = inDir.files[i];
+
+        inDir.fileCnt.addTotal();
+        const size_t planIdx = planFile(inDirIdx, inDir.fileName(inFile), inFile.size, (hashes.empty() ? 0 : hashes[i]), false);
+
+        if (onPlanned) onPlanned(planIdx);
+    }
+
+    // the file names are in the plan now
+    inDir.files.clear();
+    inDir.files.shrink_to_fit();
+    inDir.names.clear();
+
+    return true;
+}
+
+void app::Merger::execute()
+{
+    const util::Stopwatch sw;
+
+    if (m_spill) executeSpilled();
+    else executePlan();
+
+    if (m_archive)
+    {
+        std::error_code ec;
+        if (!m_archive->close(ec)) report(Message(MSGTYPE::error, MSGCODE::archiveFailed, Message::npos, m_outDir, fs::path(), ec.message()));
+    }
+
+    if (m_manifest) m_manifest->flush();
+
+    m_durations.addCopy(sw.elapsed());
+}
+
+void app::Merger::finish()
+{
+    if (m_options.durability == DURABILITY::none) return;
+
+    const util::Stopwatch sw;
+    const fs::path outDir = fs::u8path(m_outDir);
+    std::error_code ec;
+
+    const auto sync = [&ec](const fs::path& path)
+    {
+        std::error_code tmp;
+        if (!util::syncPath(path, tmp) && !ec) ec = tmp;
+    };
+
+    if (m_options.output != OUTPUT::directory)
+    {
+        sync(outDir);
+        sync(outDir.has_parent_path() ? outDir.parent_path() : fs::path("."));
+    }
+    else if (m_options.durability == DURABILITY::atEnd) util::syncFileSystem(outDir, ec);
+    else
+    {
+        if (m_syncer) m_syncer->flush(ec);
+        if (m_manifest) sync(outDir / manifestFileName);
+
+        for (const auto& dir : m_outDirCache.created()) sync(dir);
+        sync(outDir);
+    }
+
+    if (ec) report(Message(MSGTYPE::error, MSGCODE::syncFailed, Message::npos, outDir, fs::path(), ec.message()));
+
+    m_durations.addCopy(sw.elapsed());
+}
+
+bool app::Merger::concurrentExecution() const
+{
+    std::set<uint64_t> devices;
+
+    for (const auto& inDir : m_inDirs)
+    {
+        if (inDir.status == InDir::ok) devices.insert(inDir.device);
+    }
+
+    return ((devices.size() > 1) || (m_options.deviceJobs > 1));
+}
+
+bool app::Merger::planAllFirst() const
+{
+    return ((m_options.output != OUTPUT::directory) || concurrentExecution() || m_spill);
+}
+
+void app::Merger::executePlan()
+{
+    if (m_options.output != OUTPUT::directory) executeArchive();
+    else if (concurrentExecution()) executeLanes();
+    else executeSequential();
+}
+
+// The plan is filled with one batch of the merged runs at a time, in the order of the output file names. Entries with
+// the same output file name are adjacent, the later ones are handled like destinations which exist while planning.
+void app::Merger::executeSpilled()
+{
+    const size_t batchLimit = (size_t)(m_options.memLimit / 2); // the other half is used by the merge
+    PlanSpill::Record record;
+    std::string prevOutFileName;
+    bool pending = m_spill->next(record);
+
+    while (pending)
+    {
+        // the last batch is kept, like the plan if it's not spilled
+        m_nDoneBefore += m_plan.size();
+        m_plan.clear();
+        m_nExecuted = 0;
+
+        while (pending && (m_plan.empty() || (m_plan.memoryUsage() < batchLimit)))
+        {
+            bool perform = true;
+            bool overwrite = record.overwrite;
+
+            if (record.outFileName == prevOutFileName)
+            {
+                auto& inDir = m_inDirs[record.inDirIdx];
+                const fs::path inFile = (fs::path(inDir.path) / fs::u8path(record.inFileName)).make_preferred();
+                const fs::path outFile = m_outDirCache.path(record.outFileName.substr(0, 8)) / fs::u8path(record.outFileName);
+
+                if (m_options.force)
+                {
+                    overwrite = true;
+                    report(Message(MSGTYPE::warning, MSGCODE::destOverwriting, record.inDirIdx, inFile, outFile));
+                }
+                else
+                {
+                    overwrite = ask(Message(MSGTYPE::question, MSGCODE::destExists, record.inDirIdx, inFile, outFile));
+                    perform = overwrite;
+                }
+
+                if (!perform)
+                {
+                    inDir.fileCnt.addSkipped();
+                    ++m_nDropped;
+                }
+            }
+
+            if (perform) m_plan.add(record.inDirIdx, record.timestamp, record.size, record.inFileName, record.outFileName, overwrite);
+
+            prevOutFileName.swap(record.outFileName);
+            pending = m_spill->next(record);
+        }
+
+        executePlan();
+    }
+}
+
+void app::Merger::executeSequential()
+{
+    const size_t n = m_plan.size();
+
+    // the destinations are verified by the pool while the next files are copied
+    std::unique_ptr<util::WorkerPool> pool;
+    if (m_options.verify) pool = std::make_unique<util::WorkerPool>(::nWorkers());
+
+    std::mutex mtx;
+    std::vector<std::pair<PlanEntry, CopyResult>> verified; // guarded by mtx
+
+    const auto reportVerified = [&]()
+    {
+        std::vector<std::pair<PlanEntry, CopyResult>> tmp;
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tmp.swap(verified);
+        }
+
+        for (const auto& v : tmp) reportResult(v.first, v.second);
+    };
+
+    const bool noCache = m_options.verifyNoCache;
+    const size_t window = (m_options.physicalOrder ? physicalOrderWindow : copyBatchSize);
+
+    std::vector<size_t> order;
+    size_t orderPos = 0;
+    std::vector<PlanEntry> batch;
+    std::vector<CopyResult> results;
+
+    while (m_nExecuted < n)
+    {
+        if (orderPos == order.size())
+        {
+            order.resize(std::min(window, n - m_nExecuted));
+            for (size_t i = 0; i < order.size(); ++i) order[i] = m_nExecuted + i;
+            if (m_options.physicalOrder) sortPhysically(order.begin(), order.end());
+
+            orderPos = 0;
+        }
+
+        batch.clear();
+        while ((batch.size() < copyBatchSize) && (orderPos < order.size())) batch.push_back(this->entry(order[orderPos++]));
+
+        executeEntries(batch, results);
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            const auto& entry = batch[i];
+            const auto& res = results[i];
+
+            ++m_nExecuted;
+
+            if (pool && res.copied)
+            {
+                pool->wait(2 * pool->size()); // limits the memory used by pending jobs
+
+                pool->submit([entry, res, noCache, limiter = m_limiter.get(), &mtx, &verified]()
+                    {
+                        const auto tmp = app::verify(entry, res, noCache, limiter);
+                        std::lock_guard<std::mutex> lock(mtx);
+                        verified.push_back(std::make_pair(entry, tmp));
+                    });
+            }
+            else reportResult(entry, res);
+
+            if (pool) reportVerified();
+            progress(m_nExecuted, n);
+        }
+    }
+
+    if (pool)
+    {
+        pool->wait();
+        reportVerified();
+    }
+}
+
+void app::Merger::executeLanes()
+{
+    struct Lane
+    {
+        std::vector<size_t> entries; // plan indices
+        size_t next = 0;
+    };
+
+    const size_t n = m_plan.size();
+    size_t nDone = m_nExecuted;
+
+    // the directories are created here, OutDirCache is not thread safe
+    std::map<uint64_t, Lane> lanes;
+
+    for (; m_nExecuted < n; ++m_nExecuted)
+    {
+        const auto& planEntry = m_plan[m_nExecuted];
+        std::error_code ec;
+
+        m_outDirCache.get(m_plan.date(planEntry), ec);
+
+        if (ec)
+        {
+            reportResult(this->entry(m_nExecuted), CopyResult{ false, ec, 0 });
+
+            ++nDone;
+            progress(nDone, n);
+        }
+        else lanes[m_inDirs[planEntry.inDirIdx].device].entries.push_back(m_nExecuted);
+    }
+
+    if (m_options.physicalOrder)
+    {
+        for (auto& it : lanes)
+        {
+            auto& entries = it.second.entries;
+
+            for (size_t i = 0; i < entries.size(); i += physicalOrderWindow)
+            {
+                sortPhysically(entries.begin() + i, entries.begin() + std::min(entries.size(), i + physicalOrderWindow));
+            }
+        }
+    }
+
+    size_t nWorkers = 0;
+    for (const auto& lane : lanes) nWorkers += std::min(m_options.deviceJobs, lane.second.entries.size());
+
+    if (nWorkers == 0) return;
+
+    const Options options = m_options;
+    util::Semaphore writeSlots(std::max<size_t>(options.writeJobs, 1));
+
+    std::mutex mtx;
+    std::condition_variable cvDone;
+    std::vector<std::pair<PlanEntry, CopyResult>> done; // guarded by mtx, as are the next indices of the lanes
+
+    {
+        util::WorkerPool pool(nWorkers);
+
+        for (auto& it : lanes)
+        {
+            Lane& lane = it.second;
+
+            for (size_t i = 0; i < std::min(options.deviceJobs, lane.entries.size()); ++i)
+            {
+                // entry() only reads data which is not modified while the lanes are running
+                pool.submit([this, &lane, &options, limiter = m_limiter.get(), syncer = m_syncer.get(), &writeSlots, &mtx, &cvDone, &done]()
+                    {
+                        std::vector<size_t> idx;
+                        std::vector<PlanEntry> batch;
+                        std::vector<CopyResult> results;
+
+                        while (true)
+                        {
+                            {
+                                std::lock_guard<std::mutex> lock(mtx);
+                                if (lane.next >= lane.entries.size()) break;
+
+                                // smaller batches at the end, so that all jobs of the lane have work
+                                const size_t nBatch = std::max<size_t>(1, std::min(copyBatchSize, (lane.entries.size() - lane.next) / options.deviceJobs));
+
+                                idx.assign(lane.entries.begin() + lane.next, lane.entries.begin() + lane.next + nBatch);
+                                lane.next += nBatch;
+                            }
+
+                            batch.clear();
+                            for (const size_t i : idx) batch.push_back(this->entry(i));
+
+                            writeSlots.acquire();
+                            app::copy(batch, options, limiter, syncer, results);
+
+                            for (size_t i = 0; i < batch.size(); ++i)
+                            {
+                                if (options.verify && results[i].copied) results[i] = app::verify(batch[i], results[i], options.verifyNoCache, limiter);
+                            }
+
+                            writeSlots.release();
+
+                            {
+                                std::lock_guard<std::mutex> lock(mtx);
+                                for (size_t i = 0; i < batch.size(); ++i) done.push_back(std::make_pair(batch[i], results[i]));
+                            }
+
+                            cvDone.notify_one();
+                        }
+                    });
+            }
+        }
+
+        while (nDone < n)
+        {
+            std::vector<std::pair<PlanEntry, CopyResult>> tmp;
+
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cvDone.wait(lock, [&done] { return !done.empty(); });
+                tmp.swap(done);
+            }
+
+            for (const auto& d : tmp)
+            {
+                reportResult(d.first, d.second);
+
+                ++nDone;
+                progress(nDone, n);
+            }
+        }
+    }
+}
+
+void app::Merger::executeArchive()
+{
+    const size_t n = m_plan.size();
+
+    std::vector<size_t> order;
+    order.reserve(n - m_nExecuted);
+    for (size_t i = m_nExecuted; i < n; ++i) order.push_back(i);
+
+    // chronological, like the timeline index
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+        {
+            const auto& ea = m_plan[a];
+            const auto& eb = m_plan[b];
+
+            if (ea.timestamp != eb.timestamp) return (ea.timestamp < eb.timestamp);
+            return (m_plan.outFileName(ea) < m_plan.outFileName(eb));
+        });
+
+    m_nExecuted = n;
+
+    size_t nDone = n - order.size();
+
+    for (const size_t idx : order)
+    {
+        const auto entry = this->entry(idx);
+        const util::Stopwatch sw;
+
+        CopyResult res;
+        const util::ArchiveReader::Member* const member = (entry.archive ? entry.archive->find(entry.member) : nullptr);
+
+        if (entry.archive && !member)
+        {
+            res.copied = false;
+            res.ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        }
+        else if (member) res.copied = m_archive->add(*entry.archive, *member, entry.outFile.generic_u8string(), res.size, res.ec, m_limiter.get());
+        else res.copied = m_archive->add(entry.inFile, entry.outFile.generic_u8string(), res.size, res.ec, m_limiter.get());
+        res.duration = sw.elapsed();
+
+        reportResult(entry, res);
+
+        ++nDone;
+        progress(nDone, n);
+    }
+}
+
+// Sorts by the offset of the first extent of the source files, files whose offset is not known are put after them in
+// the order of their inode numbers. Members of archive INDIRs are sorted by the offset of the archive file plus their
+// offset in it.
+void app::Merger::sortPhysically(std::vector<size_t>::iterator first, std::vector<size_t>::iterator last) const
+{
+    typedef std::pair<int, uint64_t> key_t; // 0: physical offset, 1: inode number, 2: unknown
+
+    std::vector<std::pair<key_t, size_t>> keys;
+    keys.reserve(last - first);
+
+    std::unordered_map<size_t, key_t> archiveKeys; // by INDIR index
+
+    for (auto it = first; it != last; ++it)
+    {
+        const auto& e = m_plan[*it];
+        const auto& inDir = m_inDirs[e.inDirIdx];
+        key_t key(2, 0);
+
+        if (inDir.archive)
+        {
+            auto archiveKey = archiveKeys.find(e.inDirIdx);
+
+            if (archiveKey == archiveKeys.end())
+            {
+                uint64_t offset;
+                util::FileIdentity id;
+                key_t k(2, 0);
+
+                if (util::physicalOffset(fs::u8path(inDir.path), offset)) k = key_t(0, offset);
+                else if (util::fileIdentity(fs::u8path(inDir.path), id)) k = key_t(1, id.inode);
+
+                archiveKey = archiveKeys.emplace(e.inDirIdx, k).first;
+            }
+
+            const util::ArchiveReader::Member* const member = inDir.archive->find(m_plan.inFileName(e));
+
+            key = archiveKey->second;
+            if (member) key.second += member->offset;
+        }
+        else
+        {
+            const fs::path inFile = fs::path(inDir.path) / fs::u8path(m_plan.inFileName(e));
+            uint64_t offset;
+            util::FileIdentity id;
+
+            if (util::physicalOffset(inFile, offset)) key = key_t(0, offset);
+            else if (util::fileIdentity(inFile, id)) key = key_t(1, id.inode);
+        }
+
+        keys.push_back(std::make_pair(key, *it));
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<key_t, size_t>& a, const std::pair<key_t, size_t>& b) { return (a.first < b.first); });
+
+    for (const auto& k : keys) *first++ = k.second;
+}
+
+void app::Merger::watch(const std::function<bool()>& stop)
+{
+    using namespace std::chrono_literals;
+    using Source = std::pair<size_t, std::string>; // watch index and file name
+
+    if (!m_watcher) throw (int)(__LINE__);
+
+    struct Done
+    {
+        Source source;
+        PlanEntry entry;
+        CopyResult res;
+    };
+
+    util::WorkerPool pool(::nWorkers());
+    const Options options = m_options;
+
+    std::mutex mtx;
+    std::vector<Done> done; // guarded by mtx
+
+    // Files being copied, set if the file has had another event meanwhile. Such an event is handled again after the
+    // copy, so that a file written again while it's copied is not lost, and it's not copied twice at the same time.
+    std::map<Source, bool> inFlight;
+    std::unordered_set<fs::path::string_type> outInFlight;
+    std::vector<util::DirWatcher::Event> again;
+    std::vector<std::pair<Source, size_t>> waiting; // planned entries whose destination is being written by another copy
+
+    size_t nOverflows = 0;
+
+    const auto submit = [&](const Source& source, size_t planIdx)
+    {
+        const auto entry = this->entry(planIdx);
+
+        if (outInFlight.count(entry.outFile.native()) != 0)
+        {
+            waiting.push_back(std::make_pair(source, planIdx));
+            return;
+        }
+
+        std::error_code ec;
+
+        // the directory is created here, OutDirCache is not thread safe
+        m_outDirCache.get(entry.date, ec);
+
+        if (ec) reportResult(entry, CopyResult{ false, ec, 0 });
+        else
+        {
+            inFlight.emplace(source, false);
+            outInFlight.insert(entry.outFile.native());
+
+            pool.submit([source, entry, options, limiter = m_limiter.get(), syncer = m_syncer.get(), &mtx, &done]()
+                {
+                    auto res = app::copy(entry, options, limiter, syncer);
+                    if (options.verify && res.copied) res = app::verify(entry, res, options.verifyNoCache, limiter);
+                    std::lock_guard<std::mutex> lock(mtx);
+                    done.push_back(Done{ source, entry, res });
+                });
+        }
+    };
+
+    const auto reportDone = [&]()
+    {
+        std::vector<Done> tmp;
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tmp.swap(done);
+        }
+
+        for (const auto& d : tmp)
+        {
+            const auto it = inFlight.find(d.source);
+            if (it->second) again.push_back(util::DirWatcher::Event{ d.source.first, d.source.second });
+            inFlight.erase(it);
+            outInFlight.erase(d.entry.outFile.native());
+
+            reportResult(d.entry, d.res);
+        }
+
+        if (!tmp.empty() && !waiting.empty())
+        {
+            std::vector<std::pair<Source, size_t>> w;
+            w.swap(waiting);
+            for (const auto& e : w) submit(e.first, e.second);
+        }
+    };
+
+    while (!stop())
+    {
+        auto events = m_watcher->poll(inFlight.empty() ? 250ms : 10ms);
+
+        if (m_watcher->overflows() != nOverflows)
+        {
+            nOverflows = m_watcher->overflows();
+
+            for (const size_t inDirIdx : m_watchedInDirs)
+            {
+                if (m_inDirs[inDirIdx].status == InDir::ok) report(Message(MSGTYPE::warning, MSGCODE::inDirWatchOverflow, inDirIdx, m_inDirs[inDirIdx].path));
+            }
+        }
+
+        events.insert(events.end(), again.begin(), again.end());
+        again.clear();
+
+        for (const auto& ev : events)
+        {
+            const size_t inDirIdx = m_watchedInDirs.at(ev.dirIdx);
+            auto& inDir = m_inDirs[inDirIdx];
+
+            if (inDir.status != InDir::ok) continue;
+
+            const Source source(ev.dirIdx, ev.name);
+
+            const auto it = inFlight.find(source);
+            if (it != inFlight.end())
+            {
+                it->second = true;
+                continue;
+            }
+
+            const fs::path inFile = (fs::path(inDir.path) / ev.name).make_preferred();
+            std::error_code ec;
+
+            if (fs::is_regular_file(inFile, ec))
+            {
+                const uint64_t size = fs::file_size(inFile, ec);
+                bool known = false;
+
+                const uint64_t hash = (m_nearIndex ? ::imageHash(inDir, ev.name) : 0);
+                const size_t planIdx = planFile(inDirIdx, ev.name, (ec ? 0 : size), hash, true, &known);
+
+                if (!known) inDir.fileCnt.addTotal();
+
+                if (planIdx != Plan::npos)
+                {
+                    m_nExecuted = m_plan.size(); // copied right here, execute() must not pick it up
+                    submit(source, planIdx);
+                }
+            }
+        }
+
+        reportDone();
+    }
+
+    // reportDone() submits the entries waiting for their destination
+    while (!inFlight.empty())
+    {
+        pool.wait();
+        reportDone();
+    }
+
+    if (m_manifest) m_manifest->flush();
+}
+
+void app::Latencies::add(const app::PlanEntry& entry, const app::CopyResult& result)
+{
+    copy.add((uint64_t)std::llround(std::max(result.duration - result.verifyDuration, 0.0) * 1e6));
+    if (result.verifyDuration > 0) verify.add((uint64_t)std::llround(result.verifyDuration * 1e6));
+
+    if ((slowest.size() < nSlowest) || (result.duration > slowest.back().duration))
+    {
+        const auto pos = std::upper_bound(slowest.begin(), slowest.end(), result.duration, [](double d, const File& f) { return (d > f.duration); });
+        slowest.insert(pos, File{ result.duration, result.size, entry.inFile });
+        if (slowest.size() > nSlowest) slowest.pop_back();
+    }
+}
+
+app::PlanEntry app::Merger::entry(size_t idx) const
+{
+    const auto& e = m_plan[idx];
+    PlanEntry r;
+
+    r.planIdx = idx;
+    r.inDirIdx = e.inDirIdx;
+    r.inFile = (fs::path(m_inDirs[e.inDirIdx].path) / fs::u8path(m_plan.inFileName(e))).make_preferred();
+    r.date = m_plan.date(e);
+    r.outFile = m_outDirCache.path(r.date) / fs::u8path(m_plan.outFileName(e));
+    r.size = e.size;
+    r.overwrite = ((e.flags & Plan::flag_overwrite) != 0);
+    r.archive = m_inDirs[e.inDirIdx].archive.get();
+    if (r.archive) r.member = std::string(m_plan.inFileName(e));
+
+    return r;
+}
+
+util::FileCounter app::Merger::fileCount() const
+{
+    util::FileCounter r;
+    for (const auto& inDir : m_inDirs) r.add(inDir.fileCnt);
+    return r;
+}
+
+util::ResultCounter app::Merger::resultCount() const
+{
+    util::ResultCounter r = m_rcnt;
+    for (const auto& inDir : m_inDirs) r.add(inDir.rcnt);
+    return r;
+}
+
+bool app::Merger::checkOutDir()
+{
+    if (m_options.output != OUTPUT::directory) return checkArchive();
+
+    const fs::path outDirPath = m_outDir;
+
+    if (fs::exists(outDirPath))
+    {
+        if (::equivalent(m_inDirs, outDirPath))
+        {
+            report(Message(MSGTYPE::error, MSGCODE::outDirInEq, Message::npos, outDirPath));
+            return false;
+        }
+
+        if (!fs::is_empty(outDirPath))
+        {
+            if (m_options.force) report(Message(MSGTYPE::warning, MSGCODE::outDirUsingNotEmpty, Message::npos, outDirPath));
+            else if (!ask(Message(MSGTYPE::question, MSGCODE::outDirNotEmpty, Message::npos, outDirPath))) return false;
+        }
+    }
+    else
+    {
+        fs::create_directories(outDirPath);
+
+        if (!fs::exists(outDirPath))
+        {
+            report(Message(MSGTYPE::error, MSGCODE::outDirNotCreated, Message::npos, outDirPath));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool app::Merger::checkArchive()
+{
+    const fs::path file = m_outDir;
+    std::error_code ec;
+
+    if (fs::exists(file))
+    {
+        if (fs::is_directory(file) || ::equivalent(m_inDirs, file))
+        {
+            report(Message(MSGTYPE::error, MSGCODE::archiveFailed, Message::npos, file, fs::path(), std::make_error_code(std::errc::is_a_directory).message()));
+            return false;
+        }
+
+        if (m_options.force) report(Message(MSGTYPE::warning, MSGCODE::archiveOverwriting, Message::npos, file));
+        else if (!ask(Message(MSGTYPE::question, MSGCODE::archiveExists, Message::npos, file))) return false;
+    }
+    else if (file.has_parent_path())
+    {
+        fs::create_directories(file.parent_path(), ec);
+
+        if (ec)
+        {
+            report(Message(MSGTYPE::error, MSGCODE::outDirNotCreated, Message::npos, file.parent_path()));
+            return false;
+        }
+    }
+
+    m_archive = std::make_unique<util::ArchiveWriter>();
+
+    if (!m_archive->open(file, (m_options.output == OUTPUT::zip ? util::ArchiveWriter::zip : util::ArchiveWriter::tar), ec))
+    {
+        report(Message(MSGTYPE::error, MSGCODE::archiveFailed, Message::npos, file, fs::path(), ec.message()));
+        return false;
+    }
+
+    return true;
+}
+
+void app::Merger::scanInDir(size_t inDirIdx, std::unordered_set<std::string>& usedNames)
+{
+    auto& inDir = m_inDirs[inDirIdx];
+    std::vector<Message> msgs;
+
+    const fs::directory_entry dirEntry(inDir.path);
+    const bool isArchive = dirEntry.is_regular_file() && util::ArchiveReader::isArchive(inDir.path);
+    std::error_code archiveEc;
+
+    if (isArchive)
+    {
+        auto archive = std::make_shared<util::ArchiveReader>();
+
+        if (archive->open(inDir.path, archiveEc))
+        {
+            for (const auto& member : archive->members())
+            {
+                if (member.name.length() <= std::numeric_limits<uint16_t>::max()) inDir.files.push_back(InFile{ member.size, inDir.names.add(member.name), (uint16_t)(member.name.length()) });
+            }
+
+            inDir.archive = archive;
+        }
+    }
+
+    if (isArchive && archiveEc)
+    {
+        inDir.status = InDir::unreadable;
+        msgs.push_back(Message(MSGTYPE::error, MSGCODE::inDirUnreadable, inDirIdx, inDir.path, fs::path(), archiveEc.message()));
+    }
+    else if (dirEntry.is_directory() || isArchive)
+    {
+        int watchIdx = 0;
+
+        // taken before enumerating, so that a change during the enumeration invalidates the cached result
+        util::FileIdentity id;
+        const bool idValid = (m_schemeCache && util::fileIdentity(inDir.path, id));
+
+        // start watching before enumerating, so that no file is missed
+        if (m_watcher && !isArchive)
+        {
+            watchIdx = m_watcher->add(inDir.path);
+            if ((watchIdx >= 0) && ((size_t)watchIdx == m_watchedInDirs.size())) m_watchedInDirs.push_back(inDirIdx);
+        }
+
+        // the sizes are mostly left unknown here, they are taken from the copy
+        if (!isArchive)
+        {
+            util::DirEnumerator dirEnum;
+            dirEnum.regularFiles(inDir.path, [&inDir](const std::string_view& name, uint64_t size)
+                {
+                    inDir.files.push_back(InFile{ size, inDir.names.add(name), (uint16_t)(name.length()) });
+                });
+        }
+
+        SchemeCache::Result cached;
+
+        if (idValid && m_schemeCache->find(id, inDir.files.size(), cached))
+        {
+            inDir.scheme = cached.scheme;
+            inDir.rate = cached.rate;
+            inDir.schemeCached = true;
+        }
+        else
+        {
+            const auto stem = [&inDir](size_t i) { return fs::u8path(inDir.fileName(inDir.files[i])).stem().u8string(); };
+            size_t nSampled = 0;
+
+            inDir.scheme = detectScheme(inDir.files.size(), stem, m_options.userSchemes, &inDir.rate, &nSampled);
+
+            if (idValid) m_schemeCache->set(id, inDir.files.size(), SchemeCache::Result{ inDir.scheme, inDir.rate, nSampled });
+        }
+
+        if (inDir.scheme != SCHEME::unknown)
+        {
+            if (fs::exists(inDir.path))
+            {
+                if (isArchive ? !inDir.files.empty() : !fs::is_empty(inDir.path))
+                {
+                    inDir.name = (isArchive ? fs::u8path(inDir.path).stem().u8string() : getDirName(inDir.path));
+
+                    if (usedNames.insert(inDir.name).second)
+                    {
+                        inDir.status = InDir::ok;
+                        inDir.device = util::deviceId(inDir.path);
+                        m_plan.setInDirName(inDirIdx, inDir.name);
+
+                        if (watchIdx < 0) msgs.push_back(Message(MSGTYPE::error, MSGCODE::inDirWatchFailed, inDirIdx, inDir.path));
+                    }
+                    else
+                    {
+                        inDir.status = InDir::nameUsed;
+                        msgs.push_back(Message(MSGTYPE::error, MSGCODE::inDirNameUsed, inDirIdx, inDir.path));
+                    }
+                }
+                else
+                {
+                    inDir.status = InDir::empty;
+                    msgs.push_back(Message(MSGTYPE::warning, MSGCODE::inDirEmpty, inDirIdx, inDir.path));
+                }
+            }
+            else
+            {
+                inDir.status = InDir::notExisting;
+                msgs.push_back(Message(MSGTYPE::error, MSGCODE::inDirNotExisting, inDirIdx, inDir.path));
+            }
+        }
+        else
+        {
+            inDir.status = InDir::unknownScheme;
+            msgs.push_back(Message(MSGTYPE::error, MSGCODE::inDirUnknownScheme, inDirIdx, inDir.path));
+        }
+
+        if (inDir.status != InDir::ok)
+        {
+            inDir.files.clear();
+            inDir.files.shrink_to_fit();
+            inDir.names.clear();
+            inDir.archive.reset();
+        }
+    }
+    else
+    {
+        inDir.status = InDir::notADir;
+        msgs.push_back(Message(MSGTYPE::error, MSGCODE::inDirNotADir, inDirIdx, inDir.path));
+    }
+
+    if (onInDirScanned) onInDirScanned(inDirIdx, inDir);
+
+    for (const auto& msg : msgs) report(msg);
+}
+
+size_t app::Merger::planFile(size_t inDirIdx, const std::string_view& inFileName, uint64_t size, uint64_t imageHash, bool watching, bool* pKnown)
+{
+    size_t r = Plan::npos;
+    auto& inDir = m_inDirs[inDirIdx];
+
+    std::string_view inFileStem, inFileExt;
+    util::splitFileName(inFileName, inFileStem, inFileExt);
+
+    // the paths are only built for messages and the rare content comparison
+    const auto inFilePath = [&inDir, &inFileName]() { return (fs::path(inDir.path) / fs::u8path(inFileName)).make_preferred(); };
+
+    ParsedStem parsed;
+
+    if (parseStem(inDir.scheme, inFileStem, inDir.name, m_options.userSchemes, parsed))
+    {
+        std::string& outFileName = parsed.outStem;
+        outFileName.append(inFileExt);
+
+        const auto outFilePath = [this, &parsed, &outFileName]() { return m_outDirCache.path(parsed.date) / fs::u8path(outFileName); };
+
+        // spilled entries with the same destination are resolved by executeSpilled()
+        const size_t plannedIdx = (m_spill ? Plan::npos : m_plan.find(outFileName));
+        const bool outFilePlanned = (plannedIdx != Plan::npos);
+        bool outFileExists = outFilePlanned;
+
+        // the same file again while watching: written or moved in again, closed while the INDIR was scanned, or all
+        // files after the events have overflowed
+        const bool known = (watching && outFilePlanned && (m_plan[plannedIdx].inDirIdx == inDirIdx) && (m_plan.inFileName(m_plan[plannedIdx]) == inFileName));
+        if (pKnown) *pKnown = known;
+
+        if (!outFileExists && (m_options.output == OUTPUT::directory))
+        {
+            m_outFileBuffer.assign(m_outDirCache.u8prefix(parsed.date)).append(outFileName);
+            outFileExists = util::fileExists(m_outFileBuffer);
+        }
+
+        bool perform = true;
+        bool overwrite = false;
+        size_t nearIdx;
+
+        if (known)
+        {
+            perform = false;
+
+            // changed since it has been copied, or the copy has failed
+            if (!util::equalFiles(inFilePath(), outFilePath()))
+            {
+                m_plan.setFlags(plannedIdx, Plan::flag_overwrite);
+                r = plannedIdx;
+            }
+        }
+        else if (outFileExists && (!outFilePlanned || watching) && util::equalFiles(inFilePath(), outFilePath()))
+        {
+            perform = false;
+            inDir.fileCnt.addDeduplicated();
+        }
+        else if ((imageHash != 0) && m_nearIndex->find(imageHash, nearIdx))
+        {
+            perform = false;
+            inDir.fileCnt.addSkipped();
+            report(Message(MSGTYPE::warning, MSGCODE::nearDuplicate, inDirIdx, inFilePath(), entry(nearIdx).outFile));
+        }
+        else if (outFileExists && m_options.force)
+        {
+            overwrite = true;
+            report(Message(MSGTYPE::warning, MSGCODE::destOverwriting, inDirIdx, inFilePath(), outFilePath()));
+        }
+        else if (outFileExists && watching)
+        {
+            perform = false;
+            inDir.fileCnt.addSkipped();
+            report(Message(MSGTYPE::error, MSGCODE::destExists, inDirIdx, inFilePath(), outFilePath()));
+        }
+        else if (outFileExists)
+        {
+            overwrite = ask(Message(MSGTYPE::question, MSGCODE::destExists, inDirIdx, inFilePath(), outFilePath()));
+            perform = overwrite;
+            if (!perform) inDir.fileCnt.addSkipped();
+        }
+
+        if (perform)
+        {
+            if (m_spill) m_spill->add(inDirIdx, parsed.timestamp, size, inFileName, outFileName, overwrite);
+            else
+            {
+                r = m_plan.add(inDirIdx, parsed.timestamp, size, inFileName, outFileName, overwrite);
+                if (imageHash != 0) m_nearIndex->insert(imageHash, r);
+            }
+        }
+    }
+    else
+    {
+        const std::string outFileName = std::string(inFileStem) + outFileDelimiter + inDir.name + std::string(inFileExt);
+        const fs::path outFile = (((m_options.output == OUTPUT::directory) && !inDir.archive) ? (fs::path(m_outDir) / fs::u8path(outFileName)).make_preferred() : fs::path());
+
+        inDir.fileCnt.addSkipped();
+        report(Message(MSGTYPE::error, MSGCODE::schemeMismatch, inDirIdx, inFilePath(), outFile));
+    }
+
+    return r;
+}
+
+void app::Merger::executeEntries(const std::vector<app::PlanEntry>& entries, std::vector<app::CopyResult>& results)
+{
+    std::vector<PlanEntry> copies;
+    std::vector<size_t> copiesIdx; // entries index of copies
+
+    results.assign(entries.size(), CopyResult{ false, std::error_code(), 0 });
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        m_outDirCache.get(entries[i].date, results[i].ec);
+
+        if (!results[i].ec)
+        {
+            copies.push_back(entries[i]);
+            copiesIdx.push_back(i);
+        }
+    }
+
+    std::vector<CopyResult> tmp;
+    app::copy(copies, m_options, m_limiter.get(), m_syncer.get(), tmp);
+
+    for (size_t i = 0; i < copies.size(); ++i) results[copiesIdx[i]] = tmp[i];
+}
+
+void app::Merger::reportResult(const app::PlanEntry& entry, const app::CopyResult& result)
+{
+    if ((result.copied && !(result.ec.value() == 0)) ||
+        (!result.copied && (result.ec.value() == 0) && !result.verifyFailed))
+    {
+        throw (int)(__LINE__);
+    }
+
+    auto& inDir = m_inDirs[entry.inDirIdx];
+
+    inDir.durations.addCopy(result.duration);
+    m_latencies.add(entry, result);
+
+    if (result.copied)
+    {
+        // a watched file may be copied again after it has changed
+        const bool again = ((m_plan[entry.planIdx].flags & Plan::flag_copied) != 0);
+
+        m_plan.setFlags(entry.planIdx, Plan::flag_copied);
+        if (!again) inDir.fileCnt.addCopied();
+        inDir.fileCnt.addBytesCopied(result.size);
+        if (entry.size == util::DirEnumerator::unknownSize) m_plan.setSize(entry.planIdx, result.size);
+
+        if (m_options.verify && result.hashed) writeManifest(entry, result.hash);
+    }
+    else if (result.verifyFailed) report(Message(MSGTYPE::error, MSGCODE::verifyFailed, entry.inDirIdx, entry.inFile, entry.outFile, (result.ec ? result.ec.message() : std::string())));
+    else report(Message(MSGTYPE::error, MSGCODE::copyFailed, entry.inDirIdx, entry.inFile, entry.outFile, result.ec.message()));
+
+    if (onFileDone) onFileDone(entry, result);
+}
+
+void app::Merger::progress(size_t nDone, size_t nTotal)
+{
+    // if the plan is spilled, it holds only the current batch
+    if (onProgress)
+    {
+        if (m_spill) onProgress(m_nDoneBefore + nDone, m_spill->size() - m_nDropped);
+        else onProgress(nDone, nTotal);
+    }
+}
+
+void app::Merger::writeManifest(const app::PlanEntry& entry, uint64_t hash)
+{
+    if (m_manifestFailed) return;
+
+    const fs::path file = fs::u8path(m_outDir) / manifestFileName;
+
+    if (!m_manifest) m_manifest = std::make_unique<std::ofstream>(file, std::ios::out | std::ios::binary | std::ios::app);
+
+    std::string name = layoutDir(m_options.layout, entry.date);
+    if (!name.empty()) name += '/';
+    name += m_plan.outFileName(m_plan[entry.planIdx]);
+
+    *m_manifest << util::XXH64::toString(hash) << "  " << name << '\n';
+
+    if (!m_manifest->good())
+    {
+        m_manifestFailed = true;
+        report(Message(MSGTYPE::error, MSGCODE::manifestNotWritten, entry.inDirIdx, file));
+    }
+}
+
+void app::Merger::report(const app::Message& msg)
+{
+    auto& rcnt = (msg.inDirIdx == Message::npos ? m_rcnt : m_inDirs.at(msg.inDirIdx).rcnt);
+
+    if (msg.type == MSGTYPE::error) rcnt.incErrors();
+    else if (msg.type == MSGTYPE::warning) rcnt.incWarnings();
+
+    if (onMessage) onMessage(msg);
+}
+
+bool app::Merger::ask(const app::Message& msg)
+{
+    bool r = false;
+
+    if (onQuestion) r = onQuestion(msg);
+    else
+    {
+        Message tmp = msg;
+        tmp.type = MSGTYPE::error;
+        report(tmp);
+    }
+
+    return r;
+}
+
+
+
+app::CopyResult app::copy(const app::PlanEntry& entry, const app::Options& options, util::RateLimiter* limiter, util::Syncer* syncer)
+{
+    CopyResult r;
+    const util::Stopwatch sw;
+
+    if (entry.archive)
+    {
+        util::CopyOptions opt;
+        opt.overwrite = entry.overwrite;
+        opt.hash = options.verify;
+        opt.preserveTimes = options.preserveTimes;
+        opt.limiter = limiter;
+        opt.sync = (options.durability == DURABILITY::perFile);
+        opt.syncer = syncer;
+
+        const util::ArchiveReader::Member* const member = entry.archive->find(entry.member);
+
+        if (member) r.copied = entry.archive->extract(*member, entry.outFile, opt, r.hash, r.ec);
+        else
+        {
+            r.copied = false;
+            r.ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        }
+
+        r.hashed = (r.copied && opt.hash);
+    }
+    else if (options.verify || options.preserveTimes || limiter || (options.durability == DURABILITY::perFile) || syncer)
+    {
+        util::CopyOptions opt;
+        opt.overwrite = entry.overwrite;
+        opt.hash = options.verify;
+        opt.preserveTimes = options.preserveTimes;
+        opt.limiter = limiter;
+        opt.sync = (options.durability == DURABILITY::perFile);
+        opt.syncer = syncer;
+
+        r.copied = util::copyFile(entry.inFile, entry.outFile, opt, r.hash, r.ec);
+        r.hashed = (r.copied && opt.hash);
+    }
+    else
+    {
+        const fs::copy_options opt = (entry.overwrite ? fs::copy_options::overwrite_existing : fs::copy_options::none);
+        r.copied = fs::copy_file(entry.inFile, entry.outFile, opt, r.ec);
+    }
+
+    if (r.copied)
+    {
+        if (entry.size == util::DirEnumerator::unknownSize)
+        {
+            std::error_code ec;
+            const uint64_t size = fs::file_size(entry.outFile, ec);
+            r.size = (ec ? 0 : size);
+        }
+        else r.size = entry.size;
+    }
+
+    r.duration = sw.elapsed();
+
+    return r;
+}
+
+void app::copy(const std::vector<app::PlanEntry>& entries, const app::Options& options, util::RateLimiter* limiter, util::Syncer* syncer, std::vector<app::CopyResult>& results)
+{
+    std::vector<util::SmallFile> files;
+    std::vector<size_t> filesIdx; // entries index of files
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const auto& entry = entries[i];
+
+        if (!entry.archive)
+        {
+            files.push_back(util::SmallFile{ entry.inFile, entry.outFile, entry.overwrite });
+            filesIdx.push_back(i);
+        }
+    }
+
+    util::CopyOptions opt;
+    opt.hash = options.verify;
+    opt.preserveTimes = options.preserveTimes;
+    opt.limiter = limiter;
+    opt.sync = (options.durability == DURABILITY::perFile);
+    opt.syncer = syncer;
+
+    std::vector<util::SmallFileResult> small;
+    util::copySmallFiles(files, opt, small);
+
+    results.assign(entries.size(), CopyResult{ false, std::error_code(), 0 });
+    std::vector<bool> done(entries.size(), false);
+
+    for (size_t i = 0; i < small.size(); ++i)
+    {
+        const auto& sr = small[i];
+
+        if (sr.done)
+        {
+            auto& r = results[filesIdx[i]];
+
+            r.copied = sr.copied;
+            r.ec = sr.ec;
+            r.duration = sr.duration;
+            r.hashed = (sr.copied && opt.hash);
+            r.hash = sr.hash;
+            r.size = sr.size;
+
+            done[filesIdx[i]] = true;
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (!done[i]) results[i] = app::copy(entries[i], options, limiter, syncer);
+    }
+}
+
+app::CopyResult app::verify(const app::PlanEntry& entry, const app::CopyResult& copyResult, bool noCache, util::RateLimiter* limiter)
+{
+    CopyResult r = copyResult;
+
+    if (r.copied && r.hashed)
+    {
+        uint64_t hash = 0;
+        const util::Stopwatch sw;
+
+        if (!util::hashFile(entry.outFile, noCache, hash, r.ec, limiter) || (hash != r.hash))
+        {
+            r.copied = false;
+            r.verifyFailed = true;
+        }
+
+        r.verifyDuration = sw.elapsed();
+        r.duration += r.verifyDuration;
+    }
+
+    return r;
+}
@@ -0,0 +1,448 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_APP_MERGER_H
+#define IG_APP_MERGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "application/plan.h"
+#include "application/scheme.h"
+#include "application/schemecache.h"
+#include "middleware/histogram.h"
+#include "middleware/util.h"
+
+
+namespace util
+{
+    class ArchiveReader;
+    class ArchiveWriter;
+    class DirWatcher;
+    class HashIndex;
+    class RateLimiter;
+    class Syncer;
+}
+
+namespace app
+{
+    typedef enum LAYOUT
+    {
+        flat = 0,       // OUTDIR/FILE
+        year,           // OUTDIR/YYYY/FILE
+        year_month,     // OUTDIR/YYYY/MM/FILE
+        year_month_day  // OUTDIR/YYYY/MM/DD/FILE
+    } layout_t;
+
+    // returns false if the string is not a valid layout
+    bool parseLayout(const std::string& str, app::layout_t& layout);
+
+    typedef enum OUTPUT
+    {
+        directory = 0,  // the OUTDIR
+        tar,            // the OUTDIR argument is a tar file
+        zip,            // the OUTDIR argument is an uncompressed zip file
+    } output_t;
+
+    // determines the archive format by the extension (".tar" or ".zip"), returns false if it's neither
+    bool parseOutputArchive(const std::string& file, app::output_t& output);
+
+    typedef enum DURABILITY
+    {
+        none = 0,       // the files are written back by the system
+        perFile,        // each file is flushed to the device before it's closed
+        batched,        // the files are flushed in batches by a thread of its own (see util::Syncer)
+        atEnd,          // the file system of the OUTDIR is flushed once by app::Merger::finish()
+    } durability_t;
+
+    // returns false if the string is not a valid durability mode
+    bool parseDurability(const std::string& str, app::durability_t& durability);
+
+    // Parses a comma separated list of "times" and "mode". Returns false if the string contains anything else.
+    // The permissions are always copied, "mode" is accepted for compatibility with cp.
+    bool parsePreserve(const std::string& str, bool& times);
+
+    // parses a decimal number greater than 0, returns false if the string is not one
+    bool parseJobs(const std::string& str, size_t& value);
+
+    // Parses a rate "N[K|M|G]" greater than 0, the suffixes are powers of 1024 (e.g. "20M" is 20MiB/s). Returns false if
+    // the string is invalid.
+    bool parseRate(const std::string& str, uint64_t& value);
+
+    // parses a size in bytes, same format as parseRate()
+    bool parseSize(const std::string& str, uint64_t& value);
+
+    // sub directory of the OUTDIR for the date (YYYYMMDD), '/' separated, empty for LAYOUT::flat
+    std::string layoutDir(const app::layout_t& layout, const std::string& date);
+
+    struct Options
+    {
+        Options() : force(false), layout(LAYOUT::flat), watch(false), verify(false), verifyNoCache(false), preserveTimes(false), deviceJobs(1), writeJobs(4), maxBandwidth(0), maxIops(0), output(OUTPUT::directory), nearDedup(false), memLimit(0), schemeCacheFile(), physicalOrder(false), durability(DURABILITY::none), userSchemes() {}
+
+        bool force;             // overwrite existing destination files, use a non empty OUTDIR
+        app::layout_t layout;
+        bool watch;             // register the INDIRs for app::Merger::watch() while scanning
+        bool verify;            // hash while copying, re-read and compare the destination, write the manifest
+        bool verifyNoCache;     // re-read the destination from the device instead of the page cache
+        bool preserveTimes;     // set the access and modification times of the destination files to the ones of the source
+        size_t deviceJobs;      // concurrent copies per source device
+        size_t writeJobs;       // concurrent copies to the OUTDIR, over all source devices
+        uint64_t maxBandwidth;  // bytes per second of all copies and verifications together, 0 is unlimited
+        uint64_t maxIops;       // I/O operations per second (see util::CopyOptions::limiter), 0 is unlimited
+        app::output_t output;   // if it's an archive, the files are streamed in chronological order into the archive
+                                // file passed as OUTDIR, which is created by scan() and finished by execute()
+        bool nearDedup;         // don't copy JPEGs whose perceptual hash is within app::nearDedupRadius of a planned one
+        uint64_t memLimit;      // if not 0, the plan is spilled to sorted runs in the OUTDIR (see app::PlanSpill) and
+                                // executed in batches, can't be combined with watch and nearDedup
+        std::string schemeCacheFile; // detection results of unchanged INDIRs are taken from this file (see
+                                     // app::SchemeCache), empty to always sample the file names
+        bool physicalOrder;     // copy the files of each source device in windows sorted by their position on the device,
+                                // ignored if output is an archive
+        app::durability_t durability; // how the copied files are made persistent, an archive is flushed once by
+                                      // app::Merger::finish() in all modes other than none
+        app::UserSchemes userSchemes; // checked before the built in schemes, empty if there are none
+    };
+
+    // maximal Hamming distance of the perceptual hashes of near duplicates (see util::jpegHash())
+    const int nearDedupRadius = 5;
+
+    // XXH64 checksums of the verified files, in the format of `xxhsum -H1` (relative to the OUTDIR)
+    const char* const manifestFileName = ".phodime-manifest.xxh64";
+
+    typedef enum MSGCODE
+    {
+        // OUTDIR, path1 = OUTDIR
+        outDirInEq = 0,         // error, an INDIR and the OUTDIR are equivalent
+        outDirNotEmpty,         // error (question if app::Merger::onQuestion is set)
+        outDirUsingNotEmpty,    // warning, forced
+        outDirNotCreated,       // error
+        archiveExists,          // error (question if app::Merger::onQuestion is set), path1 = archive file
+        archiveOverwriting,     // warning, forced, path1 = archive file
+        archiveFailed,          // error, path1 = archive file, detail = error message
+        syncFailed,             // error, the copied files may not be persistent, path1 = OUTDIR or archive file, detail = error message
+
+        // INDIR, path1 = INDIR
+        inDirNotADir,           // error
+        inDirUnreadable,        // error, the archive can't be read, detail = error message
+        inDirNotExisting,       // error
+        inDirEmpty,             // warning
+        inDirUnknownScheme,     // error
+        inDirNameUsed,          // error
+        inDirWatchFailed,       // error
+        inDirWatchOverflow,     // warning, events have been lost, all files of the INDIR are checked again
+
+        // file, path1 = INFILE
+        schemeMismatch,         // error, path2 = suggested destination file (empty if the output is an archive)
+        destExists,             // error (question if app::Merger::onQuestion is set), path2 = destination file
+                                // (not reported if the destination has the same content, the file is counted as deduplicated)
+        destOverwriting,        // warning, forced, path2 = destination file
+        nearDuplicate,          // warning, not copied, path2 = destination file of the planned file it looks like
+        copyFailed,             // error, path2 = destination file, detail = error message
+        verifyFailed,           // error, path2 = destination file, detail = error message if it couldn't be read
+        manifestNotWritten,     // error, path1 = manifest file (reported once)
+    } msgcode_t;
+
+    typedef enum MSGTYPE
+    {
+        error = 0,
+        warning,
+        question,
+    } msgtype_t;
+
+    struct Message
+    {
+        Message() = delete;
+        Message(app::msgtype_t type_, app::msgcode_t code_, size_t inDirIdx_, const std::filesystem::path& path1_, const std::filesystem::path& path2_ = std::filesystem::path(), const std::string& detail_ = std::string())
+            : type(type_), code(code_), inDirIdx(inDirIdx_), path1(path1_), path2(path2_), detail(detail_)
+        {}
+
+        app::msgtype_t type;
+        app::msgcode_t code;
+        size_t inDirIdx;        // index of the INDIR, npos for OUTDIR messages
+        std::filesystem::path path1;
+        std::filesystem::path path2;
+        std::string detail;
+
+        static constexpr size_t npos = (size_t)(-1);
+    };
+
+    struct InFile
+    {
+        uint64_t size;          // util::DirEnumerator::unknownSize if the file wasn't stat'ed while scanning
+        uint32_t nameOffset;    // file name in app::InDir::names
+        uint16_t nameLength;
+    };
+
+    struct InDir
+    {
+        typedef enum STATUS
+        {
+            pending = 0,
+            ok,
+            notADir,
+            unreadable,
+            notExisting,
+            empty,
+            unknownScheme,
+            nameUsed,
+        } status_t;
+
+        std::string path;       // directory, or tar or zip file (see util::ArchiveReader::isArchive())
+        std::string name;       // name used in the destination file names
+        uint64_t device;        // ID of the device containing the INDIR, 0 if unknown
+        status_t status;
+        app::scheme_t scheme;
+        double rate;            // scheme detection rate
+        bool schemeCached;      // scheme and rate have been taken from app::Options::schemeCacheFile
+        std::vector<app::InFile> files; // regular files, filled by scan() and released by plan()
+        util::StringArena names;        // UTF-8 file names of files (member names if it's an archive)
+        std::shared_ptr<const util::ArchiveReader> archive; // nullptr if the INDIR is a directory
+        util::FileCounter fileCnt;
+        util::ResultCounter rcnt;           // reported errors and warnings
+        util::PhaseDurations durations;     // time spent on this INDIR, copy is the sum of the file copy times
+
+        std::string_view fileName(const app::InFile& file) const { return names.get(file.nameOffset, file.nameLength); }
+    };
+
+    struct PlanEntry
+    {
+        size_t planIdx;
+        size_t inDirIdx;
+        std::filesystem::path inFile;   // if the INDIR is an archive: the archive file followed by the member name
+        std::filesystem::path outFile;
+        std::string date;       // YYYYMMDD
+        uint64_t size;          // util::DirEnumerator::unknownSize if not known before copying
+        bool overwrite;
+        const util::ArchiveReader* archive = nullptr; // nullptr if the INDIR is a directory
+        std::string member;     // member name in archive
+    };
+
+    struct CopyResult
+    {
+        bool copied;
+        std::error_code ec;
+        double duration;        // seconds
+        bool hashed = false;    // hash is valid
+        uint64_t hash = 0;      // XXH64 of the data
+        bool verifyFailed = false; // the destination differs or couldn't be read, copied is false
+        uint64_t size = 0;      // bytes copied
+        double verifyDuration = 0; // seconds, part of duration
+    };
+
+    // per file latencies of the copies, recorded when the results are reported
+    struct Latencies
+    {
+        struct File
+        {
+            double duration;    // seconds, including the verification
+            uint64_t size;
+            std::filesystem::path path; // source file
+        };
+
+        static constexpr size_t nSlowest = 10;
+
+        util::Histogram copy;   // microseconds, without the verification
+        util::Histogram verify; // microseconds, of the verified files
+        std::vector<File> slowest; // slowest first
+
+        void add(const app::PlanEntry& entry, const app::CopyResult& result);
+    };
+
+    // Creates the sub directories of the OUTDIR layout on first use and remembers them, so that each of them is created at most once.
+    class OutDirCache
+    {
+    public:
+        OutDirCache() = delete;
+        OutDirCache(const std::filesystem::path& outDir, const app::layout_t& layout) : m_outDir(outDir), m_layout(layout) {}
+        virtual ~OutDirCache() {}
+
+        // returns the directory in which the file of the specified date (YYYYMMDD) is placed
+        std::filesystem::path path(const std::string& date) const;
+
+        // same as path(), but also creates the directory if needed, returns an empty path on error
+        std::filesystem::path get(const std::string& date, std::error_code& ec);
+
+        // path() as UTF-8 string with a trailing separator, cached so that no path has to be built per file
+        const std::string& u8prefix(const std::string& date);
+
+        // the directories created by get() and their parents in the OUTDIR
+        std::vector<std::filesystem::path> created() const;
+
+    private:
+        std::filesystem::path m_outDir;
+        app::layout_t m_layout;
+        std::unordered_map<std::string, std::filesystem::path> m_dirs;
+        std::unordered_map<std::string, std::string> m_prefixes;
+
+        size_t keyLen() const;
+    };
+
+    // Merges the files of the INDIRs into the OUTDIR in three steps: scan(), plan() and execute().
+    //
+    // Nothing is printed, everything is reported through the callbacks. The callbacks are called on the thread which
+    // called the member function.
+    //
+    // Fatal errors are thrown (std::filesystem::filesystem_error, std::system_error, std::exception and int).
+    class Merger
+    {
+    public:
+        // nothing has to be set
+        std::function<void(const app::Message& msg)> onMessage;
+
+        // Called for app::MSGTYPE::question messages, return true to proceed (overwrite or use the OUTDIR). If not
+        // set, the message is reported as error through onMessage instead.
+        std::function<bool(const app::Message& msg)> onQuestion;
+
+        // called for every INDIR after it has been scanned
+        std::function<void(size_t inDirIdx, const app::InDir& inDir)> onInDirScanned;
+
+        // called after each file which has been tried to copy
+        std::function<void(const app::PlanEntry& entry, const app::CopyResult& result)> onFileDone;
+
+        // called after each file which has been tried to copy, nDone and nTotal are the entries of the plan
+        std::function<void(size_t nDone, size_t nTotal)> onProgress;
+
+    public:
+        Merger() = delete;
+        Merger(const std::vector<std::string>& inDirs, const std::string& outDir, const app::Options& options);
+        virtual ~Merger();
+
+        Merger(const Merger& other) = delete;
+        Merger& operator=(const Merger& other) = delete;
+
+        // Checks and creates the OUTDIR, enumerates the INDIRs and detects their schemes. Returns false if it's not
+        // possible to continue (OUTDIR errors or the user answered no). Of tar and zip INDIRs only the member list is
+        // read, they are not watched. If app::Options::memLimit is set, each INDIR is planned right after it has been
+        // scanned, so that the file lists of all INDIRs are not in memory at the same time.
+        bool scan();
+
+        // determines the destination of every file of the valid INDIRs
+        void plan();
+
+        // determines the destination of every file of one INDIR, if it's valid
+        void plan(size_t inDirIdx);
+
+        // Same as plan(inDirIdx) followed by execute(), but the files are copied while the INDIR is planned: planning,
+        // copying and reporting are stages of a pipeline, connected by lock free ring buffers of a fixed capacity, so
+        // that the first file is copied right after it has been planned. If planAllFirst() or
+        // app::Options::physicalOrder is true, it's plan(inDirIdx) followed by execute(). The plan and copy durations
+        // are the times the stages have been busy, they overlap.
+        void planAndExecute(size_t inDirIdx);
+
+        // Copies the files of the plan which have not been executed yet. If concurrentExecution() is true, the files are
+        // copied by worker threads, one lane per source device with app::Options::deviceJobs threads each, and at most
+        // app::Options::writeJobs copies at a time. The results are still reported on the calling thread.
+        //
+        // If the output is an archive, the files are added sorted by date and time and the archive is finished, so
+        // execute() has to be called once, after planning all INDIRs.
+        //
+        // If app::Options::memLimit is set, the spilled plan is merged and executed in batches, in chronological order.
+        // Entries with the same destination are resolved here instead of while planning. execute() has to be called
+        // once, after planning all INDIRs.
+        void execute();
+
+        // True if the valid INDIRs are on more than one device or app::Options::deviceJobs is greater than 1. Valid
+        // after scan().
+        bool concurrentExecution() const;
+
+        // True if the files of all INDIRs should be planned before calling execute(), so that the devices are busy at
+        // the same time, the archive can be written in chronological order or the spilled plan can be merged. Valid
+        // after scan().
+        bool planAllFirst() const;
+
+        // Copies new files of the valid INDIRs until stop() returns true. Requires app::Options::watch to be set before scan().
+        void watch(const std::function<bool()>& stop);
+
+        // Makes the copied files persistent according to app::Options::durability: waits for the queued files (batched),
+        // flushes the file system of the OUTDIR (atEnd), and flushes the created directories (perFile and batched) or
+        // the archive. Call it once after execute() and watch(). The time is added to the copy duration.
+        void finish();
+
+        const std::vector<app::InDir>& inDirs() const { return m_inDirs; }
+        const app::Plan& entries() const { return m_plan; } // the last batch if app::Options::memLimit is set
+        const app::PlanSpill* spill() const { return m_spill.get(); } // nullptr if app::Options::memLimit is not set
+        app::PlanEntry entry(size_t idx) const;
+        const std::string& outDir() const { return m_outDir; }
+        const app::Options& options() const { return m_options; }
+        util::FileCounter fileCount() const;
+        util::ResultCounter resultCount() const;
+
+        // wall time of the phases
+        const util::PhaseDurations& durations() const { return m_durations; }
+        const app::Latencies& latencies() const { return m_latencies; }
+
+        // nullptr if neither app::Options::maxBandwidth nor app::Options::maxIops is set
+        const util::RateLimiter* rateLimiter() const { return m_limiter.get(); }
+
+    private:
+        std::vector<app::InDir> m_inDirs;
+        std::string m_outDir;
+        app::Options m_options;
+        app::OutDirCache m_outDirCache;
+        app::Plan m_plan;
+        size_t m_nExecuted;
+        std::vector<size_t> m_watchedInDirs; // watch index to INDIR index
+        std::unique_ptr<util::DirWatcher> m_watcher;
+        std::unique_ptr<util::RateLimiter> m_limiter;
+        std::unique_ptr<util::ArchiveWriter> m_archive;
+        std::unique_ptr<util::Syncer> m_syncer; // nullptr if app::Options::durability is not batched
+        std::unique_ptr<app::PlanSpill> m_spill;
+        size_t m_nDoneBefore;   // entries of the previous batches, if the plan is spilled
+        size_t m_nDropped;      // spilled entries which have not been executed because of their destination
+        std::unique_ptr<app::SchemeCache> m_schemeCache; // nullptr if app::Options::schemeCacheFile is empty
+        std::unique_ptr<util::HashIndex> m_nearIndex; // perceptual hashes of the planned files, if app::Options::nearDedup is set
+        std::unique_ptr<std::ofstream> m_manifest;
+        std::string m_outFileBuffer; // destination of planFile(), reused
+        bool m_manifestFailed;
+        util::ResultCounter m_rcnt; // OUTDIR messages
+        util::PhaseDurations m_durations;
+        app::Latencies m_latencies;
+
+        bool checkOutDir();
+        bool checkArchive();
+        void scanInDir(size_t inDirIdx, std::unordered_set<std::string>& usedNames);
+        bool planInDir(size_t inDirIdx, const std::function<void(size_t planIdx)>& onPlanned);
+        size_t planFile(size_t inDirIdx, const std::string_view& inFileName, uint64_t size, uint64_t imageHash, bool watching, bool* pKnown = nullptr); // returns the plan index or app::Plan::npos, imageHash is 0 if none, *pKnown is set if the watched file has been planned before (it's not counted again)
+        void executePlan();
+        void executeSpilled();
+        void executeSequential();
+        void executeLanes();
+        void executeArchive();
+        void sortPhysically(std::vector<size_t>::iterator first, std::vector<size_t>::iterator last) const; // plan indices
+        void executeEntries(const std::vector<app::PlanEntry>& entries, std::vector<app::CopyResult>& results);
+        void reportResult(const app::PlanEntry& entry, const app::CopyResult& result);
+        void progress(size_t nDone, size_t nTotal);
+        void writeManifest(const app::PlanEntry& entry, uint64_t hash);
+        void report(const app::Message& msg);
+        bool ask(const app::Message& msg);
+    };
+
+    // Does not report anything, may be called from any thread. If app::Options::verify is set, CopyResult::hash is
+    // computed from the copied data. The I/O is limited by limiter if it's not nullptr. If app::Options::durability is
+    // batched, the destination is added to syncer.
+    app::CopyResult copy(const app::PlanEntry& entry, const app::Options& options, util::RateLimiter* limiter = nullptr, util::Syncer* syncer = nullptr);
+
+    // Same as above for several entries. Files up to util::smallFileSize are read first and then written in a burst
+    // (see util::copySmallFiles()), the others are copied one by one.
+    void copy(const std::vector<app::PlanEntry>& entries, const app::Options& options, util::RateLimiter* limiter, util::Syncer* syncer, std::vector<app::CopyResult>& results);
+
+    // Re-reads the destination of a copied and hashed entry and compares it. Returns the result with copied and
+    // verifyFailed updated. May be called from any thread.
+    app::CopyResult verify(const app::PlanEntry& entry, const app::CopyResult& copyResult, bool noCache, util::RateLimiter* limiter = nullptr);
+}
+
+
+#endif // IG_APP_MERGER_H
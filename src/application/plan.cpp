@@ -0,0 +1,474 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "plan.h"
+#include "scheme.h"
+
+
+namespace
+{
+    constexpr size_t prefixLength = 16; // "YYYYMMDD-hhmmss-"
+
+    // writes the digits of value right aligned to buffer[0..width), leading zeros, higher digits are cut off
+    void formatDigits(uint64_t value, char* buffer, size_t width)
+    {
+        for (size_t i = width; i > 0; --i)
+        {
+            buffer[i - 1] = (char)('0' + (value % 10));
+            value /= 10;
+        }
+    }
+
+    // "YYYYMMDD-hhmmss-" and the terminating null, buffer has to hold prefixLength + 1 characters
+    void formatPrefix(uint64_t timestamp, char* buffer)
+    {
+        formatDigits(timestamp / 1000000ull, buffer, 8);
+        buffer[8] = app::outFileDelimiter;
+        formatDigits(timestamp % 1000000ull, buffer + 9, 6);
+        buffer[15] = app::outFileDelimiter;
+        buffer[prefixLength] = 0;
+    }
+
+    size_t hash(const std::string_view& outFileName) { return std::hash<std::string_view>{}(outFileName); }
+
+    namespace fs = std::filesystem;
+
+    constexpr size_t runBufferSize = 256 * 1024;        // stream buffer of each run file
+    constexpr size_t minBufferLimit = 1024 * 1024;
+    constexpr size_t recordHeaderSize = 28;
+    constexpr uint32_t recordFlagOverwrite = 0x01;
+
+    [[noreturn]] void throwRunError(const char* what, const fs::path& file)
+    {
+        throw fs::filesystem_error(what, file, std::make_error_code(std::errc::io_error));
+    }
+
+    // timestamp, size, INDIR index, flags, output and input file name length (native byte order), names
+    void writeRecord(std::ostream& os, uint64_t timestamp, uint64_t size, uint32_t inDirIdx, uint32_t flags, const std::string_view& outFileName, const std::string_view& inFileName)
+    {
+        const uint16_t outLength = (uint16_t)outFileName.size();
+        const uint16_t inLength = (uint16_t)inFileName.size();
+        char header[recordHeaderSize];
+
+        std::memcpy(header + 0, &timestamp, 8);
+        std::memcpy(header + 8, &size, 8);
+        std::memcpy(header + 16, &inDirIdx, 4);
+        std::memcpy(header + 20, &flags, 4);
+        std::memcpy(header + 24, &outLength, 2);
+        std::memcpy(header + 26, &inLength, 2);
+
+        os.write(header, recordHeaderSize);
+        os.write(outFileName.data(), outLength);
+        os.write(inFileName.data(), inLength);
+    }
+
+    // returns false at the end of the file, throws if the file is truncated or can't be read
+    bool readRecord(std::istream& is, const fs::path& file, app::PlanSpill::Record& record)
+    {
+        char header[recordHeaderSize];
+        uint32_t flags;
+        uint16_t outLength;
+        uint16_t inLength;
+
+        is.read(header, recordHeaderSize);
+
+        if (is.gcount() == 0)
+        {
+            if (is.bad()) throwRunError("failed to read plan run", file);
+            return false;
+        }
+
+        if (is.gcount() != (std::streamsize)recordHeaderSize) throwRunError("truncated plan run", file);
+
+        std::memcpy(&record.timestamp, header + 0, 8);
+        std::memcpy(&record.size, header + 8, 8);
+        std::memcpy(&record.inDirIdx, header + 16, 4);
+        std::memcpy(&flags, header + 20, 4);
+        std::memcpy(&outLength, header + 24, 2);
+        std::memcpy(&inLength, header + 26, 2);
+
+        record.overwrite = ((flags & recordFlagOverwrite) != 0);
+        record.outFileName.resize(outLength);
+        record.inFileName.resize(inLength);
+
+        is.read(record.outFileName.data(), outLength);
+        is.read(record.inFileName.data(), inLength);
+        if (is.fail()) throwRunError("truncated plan run", file);
+
+        return true;
+    }
+}
+
+
+
+// k-way merge of run files, equal output file names are taken from the first run
+class app::PlanSpill::Merge
+{
+public:
+    explicit Merge(const std::vector<fs::path>& files)
+    {
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            auto input = std::make_unique<Input>();
+
+            input->file = files[i];
+            input->buffer.resize(runBufferSize);
+            input->ifs.rdbuf()->pubsetbuf(input->buffer.data(), (std::streamsize)input->buffer.size());
+            input->ifs.open(input->file, std::ios::in | std::ios::binary);
+            if (!input->ifs.is_open()) throwRunError("failed to open plan run", input->file);
+
+            m_inputs.push_back(std::move(input));
+            read(i);
+        }
+    }
+
+    bool next(app::PlanSpill::Record& record)
+    {
+        if (m_heap.empty()) return false;
+
+        std::pop_heap(m_heap.begin(), m_heap.end(), greater);
+
+        const size_t inputIdx = m_heap.back().second;
+        record = std::move(m_heap.back().first);
+        m_heap.pop_back();
+
+        read(inputIdx);
+
+        return true;
+    }
+
+private:
+    struct Input
+    {
+        fs::path file;
+        std::vector<char> buffer;
+        std::ifstream ifs;
+    };
+
+    typedef std::pair<app::PlanSpill::Record, size_t> item_t; // with the input index
+
+    std::vector<std::unique_ptr<Input>> m_inputs;
+    std::vector<item_t> m_heap;
+
+    static bool greater(const item_t& a, const item_t& b)
+    {
+        const int cmp = a.first.outFileName.compare(b.first.outFileName);
+        return ((cmp > 0) || ((cmp == 0) && (a.second > b.second)));
+    }
+
+    void read(size_t inputIdx)
+    {
+        Input& input = *m_inputs[inputIdx];
+        app::PlanSpill::Record record;
+
+        if (readRecord(input.ifs, input.file, record))
+        {
+            m_heap.push_back(std::make_pair(std::move(record), inputIdx));
+            std::push_heap(m_heap.begin(), m_heap.end(), greater);
+        }
+    }
+};
+
+
+
+void app::Plan::setInDirName(size_t inDirIdx, const std::string& name)
+{
+    if (inDirIdx >= m_inDirNames.size()) m_inDirNames.resize(inDirIdx + 1);
+    m_inDirNames[inDirIdx] = name;
+}
+
+size_t app::Plan::add(size_t inDirIdx, uint64_t timestamp, uint64_t size, const std::string_view& inFileName, const std::string_view& outFileName, bool overwrite)
+{
+    if (inDirIdx >= m_inDirNames.size()) throw (int)(__LINE__);
+
+    const std::string& name = m_inDirNames[inDirIdx];
+    char prefix[prefixLength + 1];
+    formatPrefix(timestamp, prefix);
+
+    if ((outFileName.compare(0, prefixLength, prefix) != 0) || (outFileName.compare(prefixLength, name.size(), name) != 0)) throw (int)(__LINE__);
+
+    const std::string_view outFileSuffix = outFileName.substr(prefixLength + name.size());
+
+    if (m_entries.size() >= (size_t)(std::numeric_limits<uint32_t>::max() - 1)) throw std::length_error("plan is full");
+    if ((inFileName.size() > std::numeric_limits<uint16_t>::max()) || (outFileSuffix.size() > std::numeric_limits<uint16_t>::max())) throw std::length_error("file name too long");
+
+    Entry entry;
+    entry.timestamp = timestamp;
+    entry.size = size;
+    entry.nameOffset = m_names.add(inFileName);
+    m_names.add(outFileSuffix);
+    entry.inDirIdx = (uint32_t)inDirIdx;
+    entry.nameLength = (uint16_t)inFileName.size();
+    entry.suffixLength = (uint16_t)outFileSuffix.size();
+    entry.flags = (overwrite ? flag_overwrite : 0);
+
+    const size_t r = m_entries.size();
+    m_entries.push_back(entry);
+
+    // max load factor 0.5
+    if (((m_entries.size()) * 2) > m_table.size()) rehash(m_table.empty() ? 1024 : (m_table.size() * 2));
+    else
+    {
+        std::string buffer;
+        insert((uint32_t)r, buffer);
+    }
+
+    return r;
+}
+
+size_t app::Plan::find(const std::string_view& outFileName) const
+{
+    if (m_table.empty()) return npos;
+
+    const size_t mask = m_table.size() - 1;
+    size_t slot = hash(outFileName) & mask;
+
+    while (m_table[slot] != 0)
+    {
+        const auto& entry = m_entries[m_table[slot] - 1];
+        const std::string& name = m_inDirNames[entry.inDirIdx];
+
+        if (outFileName.size() == (prefixLength + name.size() + entry.suffixLength))
+        {
+            char prefix[prefixLength + 1];
+            formatPrefix(entry.timestamp, prefix);
+
+            if ((outFileName.compare(0, prefixLength, prefix, prefixLength) == 0) &&
+                (outFileName.compare(prefixLength, name.size(), name) == 0) &&
+                (outFileName.substr(prefixLength + name.size()) == m_names.get(entry.nameOffset + entry.nameLength, entry.suffixLength)))
+            {
+                return (size_t)(m_table[slot] - 1);
+            }
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return npos;
+}
+
+std::string app::Plan::outFileName(const Entry& entry) const
+{
+    std::string r;
+    outFileName(entry, r);
+    return r;
+}
+
+std::string app::Plan::date(const Entry& entry) const
+{
+    char prefix[prefixLength + 1];
+    formatPrefix(entry.timestamp, prefix);
+    return std::string(prefix, 8);
+}
+
+void app::Plan::clear()
+{
+    m_entries.clear();
+    m_entries.shrink_to_fit();
+    m_names.clear();
+    m_table.clear();
+    m_table.shrink_to_fit();
+}
+
+size_t app::Plan::memoryUsage() const
+{
+    size_t r = m_entries.capacity() * sizeof(Entry);
+    r += m_names.capacity();
+    r += m_table.capacity() * sizeof(uint32_t);
+    for (const auto& name : m_inDirNames) r += sizeof(std::string) + name.capacity();
+
+    return r;
+}
+
+void app::Plan::outFileName(const Entry& entry, std::string& buffer) const
+{
+    char prefix[prefixLength + 1];
+    formatPrefix(entry.timestamp, prefix);
+
+    buffer.assign(prefix, prefixLength);
+    buffer += m_inDirNames[entry.inDirIdx];
+    buffer += m_names.get(entry.nameOffset + entry.nameLength, entry.suffixLength);
+}
+
+void app::Plan::insert(uint32_t entryIdx, std::string& buffer)
+{
+    outFileName(m_entries[entryIdx], buffer);
+
+    const size_t mask = m_table.size() - 1;
+    size_t slot = hash(buffer) & mask;
+
+    while (m_table[slot] != 0) slot = (slot + 1) & mask;
+
+    m_table[slot] = entryIdx + 1;
+}
+
+void app::Plan::rehash(size_t nSlots)
+{
+    m_table.assign(nSlots, 0);
+
+    std::string buffer;
+    for (size_t i = 0; i < m_entries.size(); ++i) insert((uint32_t)i, buffer);
+}
+
+
+
+app::PlanSpill::PlanSpill(const fs::path& dir, uint64_t memLimit)
+    : m_dir(), m_bufferLimit(std::max<size_t>((size_t)(memLimit / 2), minBufferLimit)), m_fanIn(std::max<size_t>(m_bufferLimit / runBufferSize, 2)),
+    m_entries(), m_names(), m_runFiles(), m_merge(), m_reading(false), m_readIdx(0), m_size(0), m_nRuns(0)
+{
+    // a new directory, so that concurrent runs in the same directory don't interfere
+    for (size_t i = 0; m_dir.empty(); ++i)
+    {
+        const fs::path tmp = dir / (".phodime-plan-" + std::to_string(i) + ".tmp");
+        if (fs::create_directory(tmp)) m_dir = tmp;
+    }
+}
+
+app::PlanSpill::~PlanSpill()
+{
+    m_merge.reset();
+
+    std::error_code ec;
+    fs::remove_all(m_dir, ec);
+}
+
+void app::PlanSpill::add(size_t inDirIdx, uint64_t timestamp, uint64_t size, const std::string_view& inFileName, const std::string_view& outFileName, bool overwrite)
+{
+    if (m_reading) throw (int)(__LINE__);
+
+    if ((inFileName.size() > std::numeric_limits<uint16_t>::max()) || (outFileName.size() > std::numeric_limits<uint16_t>::max())) throw std::length_error("file name too long");
+
+    Entry entry;
+    entry.timestamp = timestamp;
+    entry.size = size;
+    entry.inDirIdx = (uint32_t)inDirIdx;
+    entry.flags = (overwrite ? recordFlagOverwrite : 0);
+    entry.nameOffset = m_names.add(outFileName);
+    m_names.add(inFileName);
+    entry.outLength = (uint16_t)outFileName.size();
+    entry.inLength = (uint16_t)inFileName.size();
+
+    m_entries.push_back(entry);
+    ++m_size;
+
+    if (((m_entries.size() * sizeof(Entry)) + m_names.size()) >= m_bufferLimit) writeRun();
+}
+
+bool app::PlanSpill::next(Record& record)
+{
+    if (!m_reading) startReading();
+
+    if (m_merge) return m_merge->next(record);
+
+    if (m_readIdx >= m_entries.size()) return false;
+
+    const Entry& entry = m_entries[m_readIdx++];
+
+    record.timestamp = entry.timestamp;
+    record.size = entry.size;
+    record.inDirIdx = entry.inDirIdx;
+    record.overwrite = ((entry.flags & recordFlagOverwrite) != 0);
+    record.inFileName = inFileName(entry);
+    record.outFileName = outFileName(entry);
+
+    return true;
+}
+
+void app::PlanSpill::sort()
+{
+    std::stable_sort(m_entries.begin(), m_entries.end(), [this](const Entry& a, const Entry& b) { return (outFileName(a) < outFileName(b)); });
+}
+
+void app::PlanSpill::writeRun()
+{
+    sort();
+
+    const fs::path file = newRunFile();
+    std::vector<char> buffer(runBufferSize);
+    std::ofstream ofs;
+
+    ofs.rdbuf()->pubsetbuf(buffer.data(), (std::streamsize)buffer.size());
+    ofs.open(file, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    for (const auto& entry : m_entries) writeRecord(ofs, entry.timestamp, entry.size, entry.inDirIdx, entry.flags, outFileName(entry), inFileName(entry));
+
+    ofs.close();
+    if (ofs.fail()) throwRunError("failed to write plan run", file);
+
+    m_runFiles.push_back(file);
+    m_entries.clear();
+    m_names.clear();
+}
+
+fs::path app::PlanSpill::newRunFile()
+{
+    return (m_dir / ("run-" + std::to_string(m_nRuns++)));
+}
+
+void app::PlanSpill::startReading()
+{
+    m_reading = true;
+
+    if (m_runFiles.empty())
+    {
+        sort();
+        return;
+    }
+
+    if (!m_entries.empty()) writeRun();
+    m_entries.shrink_to_fit();
+
+    // The oldest runs are merged first and the result takes their place, so that entries with the same output file
+    // name stay in the order they were added.
+    while (m_runFiles.size() > m_fanIn)
+    {
+        const std::vector<fs::path> files(m_runFiles.begin(), m_runFiles.begin() + m_fanIn);
+        const fs::path file = newRunFile();
+
+        {
+            Merge merge(files);
+            std::vector<char> buffer(runBufferSize);
+            std::ofstream ofs;
+            Record record;
+
+            ofs.rdbuf()->pubsetbuf(buffer.data(), (std::streamsize)buffer.size());
+            ofs.open(file, std::ios::out | std::ios::binary | std::ios::trunc);
+
+            while (merge.next(record))
+            {
+                writeRecord(ofs, record.timestamp, record.size, record.inDirIdx, (record.overwrite ? recordFlagOverwrite : 0), record.outFileName, record.inFileName);
+            }
+
+            ofs.close();
+            if (ofs.fail()) throwRunError("failed to write plan run", file);
+        }
+
+        for (const auto& f : files)
+        {
+            std::error_code ec;
+            fs::remove(f, ec);
+        }
+
+        m_runFiles.erase(m_runFiles.begin(), m_runFiles.begin() + m_fanIn);
+        m_runFiles.insert(m_runFiles.begin(), file);
+    }
+
+    m_merge = std::make_unique<Merge>(m_runFiles);
+}
@@ -0,0 +1,167 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_APP_PLAN_H
+#define IG_APP_PLAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "middleware/util.h"
+
+
+namespace app
+{
+    // Compact storage of the plan, made for merges of millions of files.
+    //
+    // An entry has a fixed size of 32 bytes. The directories are not stored per entry, the INDIR is referenced by its
+    // index and the destination directory is derived from the timestamp. The input file name and the suffix of the
+    // output file name (the part after "YYYYMMDD-hhmmss-NAME") are stored back to back in an arena. The output file
+    // names are indexed by an open addressing hash table of entry indices.
+    class Plan
+    {
+    public:
+        struct Entry
+        {
+            uint64_t timestamp;     // YYYYMMDDhhmmss
+            uint64_t size;
+            uint32_t nameOffset;    // input file name followed by the output file name suffix
+            uint32_t inDirIdx;
+            uint16_t nameLength;
+            uint16_t suffixLength;
+            uint32_t flags;
+        };
+
+        static constexpr uint32_t flag_overwrite = 0x01;
+        static constexpr uint32_t flag_copied = 0x02;   // set after the file has been copied
+
+        static constexpr size_t npos = (size_t)(-1);
+
+    public:
+        Plan() {}
+        virtual ~Plan() {}
+
+        // the INDIR names are interned here, they have to be set before adding entries of the INDIR
+        void setInDirName(size_t inDirIdx, const std::string& name);
+
+        // Appends an entry and returns its index. The output file name has to start with "YYYYMMDD-hhmmss-NAME" of the
+        // timestamp and INDIR name. Throws std::length_error if the plan is full (2^32 - 1 entries or 4GiB of names).
+        size_t add(size_t inDirIdx, uint64_t timestamp, uint64_t size, const std::string_view& inFileName, const std::string_view& outFileName, bool overwrite);
+
+        // returns the index of the entry with this output file name, or npos
+        size_t find(const std::string_view& outFileName) const;
+
+        size_t size() const { return m_entries.size(); }
+        bool empty() const { return m_entries.empty(); }
+        const Entry& operator[](size_t idx) const { return m_entries[idx]; }
+        void setFlags(size_t idx, uint32_t flags) { m_entries.at(idx).flags |= flags; }
+        void setSize(size_t idx, uint64_t size) { m_entries.at(idx).size = size; }
+
+        std::string_view inFileName(const Entry& entry) const { return m_names.get(entry.nameOffset, entry.nameLength); }
+        std::string outFileName(const Entry& entry) const;
+        std::string date(const Entry& entry) const; // YYYYMMDD
+
+        // removes all entries, the INDIR names are kept
+        void clear();
+
+        // allocated bytes of the entries, the names and the hash table
+        size_t memoryUsage() const;
+
+    private:
+        std::vector<Entry> m_entries;
+        util::StringArena m_names;
+        std::vector<std::string> m_inDirNames;
+        std::vector<uint32_t> m_table; // entry index + 1, 0 is an empty slot
+
+        void outFileName(const Entry& entry, std::string& buffer) const;
+        void insert(uint32_t entryIdx, std::string& buffer);
+        void rehash(size_t nSlots);
+    };
+
+    // External sort of planned entries for merges which don't fit in memory.
+    //
+    // The entries are buffered until the buffer reaches half of the memory limit (vectors may double their capacity),
+    // then it's sorted and written as a run to a temporary directory. Reading merges the runs, in passes if there are
+    // more runs than read buffers fit in the other half of the limit. The entries are sorted by the output file name,
+    // which starts with "YYYYMMDD-hhmmss", so they come out in chronological order and entries with the same output
+    // file name are adjacent (in the order they were added). If nothing was written, the buffer is read directly.
+    //
+    // Write and read errors of the run files are thrown as std::filesystem::filesystem_error.
+    class PlanSpill
+    {
+    public:
+        struct Record
+        {
+            uint64_t timestamp;     // YYYYMMDDhhmmss
+            uint64_t size;
+            uint32_t inDirIdx;
+            bool overwrite;
+            std::string inFileName;
+            std::string outFileName;
+        };
+
+    public:
+        PlanSpill() = delete;
+
+        // the runs are written to a new directory in dir, which is removed by the destructor
+        PlanSpill(const std::filesystem::path& dir, uint64_t memLimit);
+
+        virtual ~PlanSpill();
+
+        PlanSpill(const PlanSpill& other) = delete;
+        PlanSpill& operator=(const PlanSpill& other) = delete;
+
+        // throws std::length_error if a file name is longer than 64KiB
+        void add(size_t inDirIdx, uint64_t timestamp, uint64_t size, const std::string_view& inFileName, const std::string_view& outFileName, bool overwrite);
+
+        // Reads the next record, no more records can be added after the first call. Returns false after the last record.
+        bool next(Record& record);
+
+        size_t size() const { return m_size; }      // added entries
+        size_t runs() const { return m_nRuns; }     // written runs, including the ones of merge passes
+
+    private:
+        struct Entry
+        {
+            uint64_t timestamp;
+            uint64_t size;
+            uint32_t inDirIdx;
+            uint32_t flags;
+            uint32_t nameOffset;    // output file name followed by the input file name
+            uint16_t outLength;
+            uint16_t inLength;
+        };
+
+        class Merge;
+
+        std::filesystem::path m_dir;
+        size_t m_bufferLimit;
+        size_t m_fanIn;
+        std::vector<Entry> m_entries;
+        util::StringArena m_names;
+        std::vector<std::filesystem::path> m_runFiles;
+        std::unique_ptr<Merge> m_merge;
+        bool m_reading;
+        size_t m_readIdx;   // of m_entries if nothing was written
+        size_t m_size;
+        size_t m_nRuns;
+
+        std::string_view outFileName(const Entry& entry) const { return m_names.get(entry.nameOffset, entry.outLength); }
+        std::string_view inFileName(const Entry& entry) const { return m_names.get(entry.nameOffset + entry.outLength, entry.inLength); }
+        void sort();
+        void writeRun();
+        std::filesystem::path newRunFile();
+        void startReading();
+    };
+}
+
+
+#endif // IG_APP_PLAN_H
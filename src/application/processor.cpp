@@ -5,19 +5,27 @@ copyright       GNU GPLv3 - Copyright (c) 2023 Oliver Blaser
 */
 
 #include <algorithm>
-#include <array>
 #include <cmath>
+#include <csignal>
 #include <filesystem>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <vector>
 
+#include "merger.h"
+#include "middleware/dirwatch.h"
+#include "middleware/ratelimit.h"
 #include "middleware/util.h"
 #include "processor.h"
 #include "project.h"
+#include "report.h"
+#include "timeline.h"
 
 #include <omw/cli.h>
 #include <omw/string.h>
@@ -196,9 +204,14 @@ namespace
         do
         {
             std::cout << q << " [" << (def == 1 ? a.toUpper_ascii() : a) << "/" << (def == 2 ? b.toUpper_ascii() : b) << "] ";
-            std::getline(std::cin, data);
 
-            if (data.toLower_ascii() == a) r = 1;
+            // stdin is closed or has been consumed by --indirs-from, the second choice is taken
+            if (!std::getline(std::cin, data))
+            {
+                std::cout << std::endl;
+                r = 2;
+            }
+            else if (data.toLower_ascii() == a) r = 1;
             else if (data.toLower_ascii() == b) r = 2;
             else if (data.length() == 0) r = def;
             else r = 0;
@@ -226,375 +239,72 @@ namespace
 
 
 
-    bool equivalent(const std::vector<fs::path>& inDirs, const fs::path& outDir)
-    {
-        bool r = false;
-
-        for (size_t i = 0; (i < inDirs.size()) && !r; ++i)
-        {
-            if (fs::exists(inDirs[i])) r = fs::equivalent(inDirs[i], outDir);
-        }
-
-        return r;
-    }
-
-    omw::string getDirName(const fs::path& dir)
-    {
-        omw::string r;
-        
-        if (dir.has_filename()) r = dir.filename().u8string();
-        else r = dir.parent_path().filename().u8string();
-
-        return r;
-    }
-
-
-
 #ifdef PRJ_DEBUG
     const std::string magentaDebugStr = "\033[95mDEBUG\033[39m";
 #endif
 
 
 
-    constexpr char inFileDelimiter = '_';
+    volatile std::sig_atomic_t watchStop = 0;
+    extern "C" void watchSignalHandler(int) { watchStop = 1; }
 
-    typedef enum SCHEME
+    std::string dedupString(const util::FileCounter& cnt)
     {
-        unknown = 0,
-        huawai,     // IMG_YYYYMMDD_hhmmss
-        samsung,    // YYYYMMDD_hhmmss
-        winphone    // WP_YYYYMMDD_hh_mm_ss_Pro
-    } scheme_t;
-
-    omw::string toString(const scheme_t& scheme)
-    {
-        omw::string r = "ERROR";
-
-        switch (scheme)
-        {
-        case SCHEME::unknown:
-            r = "Unknown";
-            break;
-
-        case SCHEME::huawai:
-            r = "Huawai";
-            break;
-
-        case SCHEME::samsung:
-            r = "Samsung";
-            break;
-
-        case SCHEME::winphone:
-            r = "Winphone";
-            break;
-
-        default:
-            r = "ERROR";
-            break;
-        }
-
-        return r;
+        return (cnt.deduplicated() > 0 ? ", " + std::to_string(cnt.deduplicated()) + " deduplicated" : "");
     }
 
-    constexpr size_t nTokensHuawai = 3;
-    constexpr size_t nTokensSamsung = 2;
-    constexpr size_t nTokensWinPhone = 6;
-    constexpr size_t nTokensMax = nTokensWinPhone;
-
-    bool schemeIsHuawai(const omw::stringVector_t& tokens)
+    std::string sizeString(double bytes)
     {
-        bool r = false;
+        const char* const units[] = { "B", "KiB", "MiB", "GiB" };
+        size_t i = 0;
 
-        if (tokens.size() >= nTokensHuawai)
+        while ((bytes >= 1024.0) && (i < 3))
         {
-            if (((tokens[0] == "IMG") || (tokens[0] == "VID") || (tokens[0] == "PANO")) &&
-                (tokens[1].length() == 8) && omw::isUInteger(tokens[1]) &&
-                (tokens[2].length() == 6) && omw::isUInteger(tokens[2]))
-            {
-                r = true;
-            }
+            bytes /= 1024.0;
+            ++i;
         }
 
-        return r;
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(i == 0 ? 0 : 1) << bytes << ' ' << units[i];
+        return oss.str();
     }
 
-    bool schemeIsSamsung(const omw::stringVector_t& tokens)
-    {
-        bool r = false;
-
-        if (tokens.size() >= nTokensSamsung)
-        {
-            if ((tokens[0].length() == 8) && omw::isUInteger(tokens[0]) &&
-                (tokens[1].length() == 6) && omw::isUInteger(tokens[1]))
-            {
-                r = true;
-            }
-        }
+    std::string rateString(double bytesPerSecond) { return sizeString(bytesPerSecond) + "/s"; }
 
-        return r;
-    }
-
-    bool schemeIsWinPhone(const omw::stringVector_t& tokens)
+    std::string durationString(double seconds)
     {
-        bool r = false;
+        std::ostringstream oss;
 
-        if (tokens.size() >= nTokensWinPhone)
-        {
-            if ((tokens[0] == "WP") &&
-                (tokens[1].length() == 8) && omw::isUInteger(tokens[1]) &&
-                (tokens[2].length() == 2) && omw::isUInteger(tokens[2]) &&
-                (tokens[3].length() == 2) && omw::isUInteger(tokens[3]) &&
-                (tokens[4].length() == 2) && omw::isUInteger(tokens[4]) &&
-                (tokens[5] == "Pro"))
-            {
-                r = true;
-            }
-        }
+        if (seconds < 1e-3) oss << std::fixed << std::setprecision(0) << (seconds * 1e6) << "us";
+        else if (seconds < 1) oss << std::fixed << std::setprecision(1) << (seconds * 1e3) << "ms";
+        else oss << std::fixed << std::setprecision(2) << seconds << "s";
 
-        return r;
+        return oss.str();
     }
 
-    scheme_t detectScheme(const omw::stringVector_t& tokens)
+    // "p50 ..., p90 ..., p99 ..., max ..." of a histogram in microseconds
+    std::string latencyString(const util::Histogram& h)
     {
-        scheme_t r = SCHEME::unknown;
-
-        const bool huawai = schemeIsHuawai(tokens);
-        const bool samsung = schemeIsSamsung(tokens);
-        const bool wp = schemeIsWinPhone(tokens);
-
-        if (huawai && !samsung && !wp) r = SCHEME::huawai;
-        else if (!huawai && samsung && !wp) r = SCHEME::samsung;
-        else if (!huawai && !samsung && wp) r = SCHEME::winphone;
-        // else nop
-
-        return r;
+        return "p50 " + durationString((double)h.percentile(0.5) * 1e-6) +
+            ", p90 " + durationString((double)h.percentile(0.9) * 1e-6) +
+            ", p99 " + durationString((double)h.percentile(0.99) * 1e-6) +
+            ", max " + durationString((double)h.max() * 1e-6);
     }
 
-    // returns SCHEME::unknown if the rate is too small
-    scheme_t detectScheme(const fs::path& inDir, double* pRate = nullptr)
-    {
-        scheme_t r = SCHEME::unknown;
-
-        if (fs::exists(inDir))
-        {
-            std::vector<omw::string> stemFilenames;
-
-            for (const fs::directory_entry& entry : fs::directory_iterator(inDir))
-            {
-                if (entry.is_regular_file()) stemFilenames.push_back(entry.path().stem().u8string());
-            }
-
-            constexpr size_t k = 30;
-            size_t blockSize = stemFilenames.size() / k;
-            if ((blockSize == 0) || (stemFilenames.size() <= k)) blockSize = 1;
-
-#if defined(PRJ_DEBUG) && 0
-            cout << omw::fgBrightBlack << "@" << __FUNCTION__ << " blockSize: " << blockSize << ", stemFilenames.size(): " << stemFilenames.size() << omw::fgDefault << endl;
-#endif
-
-            std::vector<omw::string> analyze;
-            for (size_t i = 0; i < stemFilenames.size(); ++i)
-            {
-                if ((i % blockSize) == 0) analyze.push_back(stemFilenames[i]);
-            }
-
-            stemFilenames.clear();
-            stemFilenames.shrink_to_fit();
-
-            size_t cnt_huawai = 0;
-            size_t cnt_samsung = 0;
-            size_t cnt_winphone = 0;
-
-            for (size_t i = 0; i < analyze.size(); ++i)
-            {
-                const auto tokens = analyze[i].split(inFileDelimiter, nTokensMax + 1);
-                if (schemeIsHuawai(tokens)) ++cnt_huawai;
-                if (schemeIsSamsung(tokens)) ++cnt_samsung;
-                if (schemeIsWinPhone(tokens)) ++cnt_winphone;
-            }
-
-            std::array<size_t, 3> cnt = { cnt_huawai, cnt_samsung, cnt_winphone };
-            std::sort(cnt.begin(), cnt.end(), std::greater<size_t>());
-
-            const double rate = (double)(cnt[0]) / (double)(analyze.size());
-            if (pRate) *pRate = rate;
-
-            if ((cnt[0] != cnt[1]) && (rate >= 0.75))
-            {
-                if (cnt[0] == cnt_huawai) r = SCHEME::huawai;
-                else if (cnt[0] == cnt_samsung) r = SCHEME::samsung;
-                else if (cnt[0] == cnt_winphone) r = SCHEME::winphone;
-                //else if (cnt[0] == cnt_) r = SCHEME::;
-                else
-                {
-                    r = SCHEME::unknown;
-                    // maybe print something
-                }
-            }
-            else
-            {
-                r = SCHEME::unknown;
-                // maybe print something
-            }
-        }
-        else
-        {
-            r = SCHEME::unknown;
-            // maybe print something
-        }
-
-        if (pRate && (r == SCHEME::unknown)) *pRate = 1;
-
-        return r;
-    }
-
-    constexpr char outFileDelimiter = '-';
-    constexpr char outFileDelimiter_opt = '_';
-
-    // YYYYMMDD-hhmmss-NAME[_...]
-    std::string outFileStem(const scheme_t& scheme, const omw::stringVector_t& tokens, const std::string& inDirName)
+    std::string inDirTitle(const app::InDir& inDir, const app::UserSchemes& userSchemes)
     {
         std::string r;
-        size_t nTokens;
-
-        switch (scheme)
-        {
-        case SCHEME::huawai:
-            r = tokens[1] + outFileDelimiter + tokens[2] + outFileDelimiter + inDirName;
-            nTokens = nTokensHuawai;
-            break;
-
-        case SCHEME::samsung:
-            r = tokens[0] + outFileDelimiter + tokens[1] + outFileDelimiter + inDirName;
-            nTokens = nTokensSamsung;
-            break;
-
-        case SCHEME::winphone:
-            r = tokens[1] + outFileDelimiter + tokens[2] + tokens[3] + tokens[4] + outFileDelimiter + inDirName + outFileDelimiter + tokens[0];
-            nTokens = nTokensWinPhone;
-            break;
-
-        default:
-            throw (int)(__LINE__);
-            break;
-        }
 
-        for (size_t i = nTokens; i < tokens.size(); ++i)
+        if ((inDir.status == app::InDir::notADir) || (inDir.status == app::InDir::unreadable)) r = "###\"" + inDir.path + "\"";
+        else
         {
-            r += (outFileDelimiter_opt + tokens[i]);
+            r = "###\"" + (fs::path(inDir.path)).make_preferred().u8string() + "\" " + app::toString(inDir.scheme, userSchemes);
+            if (inDir.scheme != app::SCHEME::unknown) r += " (" + std::to_string((int)round(inDir.rate * 100)) + "%)";
         }
 
         return r;
     }
 
-    util::FileCounter process(const scheme_t& scheme, const std::string& inDir, const std::string& inDirName, const std::string& outDir, const app::Flags& flags, util::ResultCounter& rcnt)
-    {
-        IMPLEMENT_FLAGS();
-
-        util::FileCounter rFileCnt;
-
-        if (scheme == SCHEME::unknown) throw (int)(__LINE__);
-
-        for (const fs::directory_entry& entry : fs::directory_iterator(inDir))
-        {
-            if (entry.is_regular_file())
-            {
-                rFileCnt.addTotal();
-
-                const fs::path inFile = (fs::path(entry.path())).make_preferred();
-                auto ___inFileStemTokens = omw_::split(inFile.stem().u8string(), inFileDelimiter);
-                const auto& inFileStemTokens = ___inFileStemTokens;
-
-                // Samsung multiple images in same second
-                if ((inFileStemTokens.size() >= nTokensSamsung) && inFileStemTokens[1].contains('(') && (inFileStemTokens[1].back() == ')'))
-                {
-                    const auto samsungTimeTokens = inFileStemTokens[1].split('(');
-                    const auto& timeToken = samsungTimeTokens[0];
-                    const auto nToken = samsungTimeTokens[1].split(')')[0];
-
-                    if ((samsungTimeTokens.size() == 2) && omw::isUInteger(timeToken) && omw::isUInteger(nToken))
-                    {
-                        ___inFileStemTokens[1] = timeToken;
-                        ___inFileStemTokens.insert(___inFileStemTokens.begin() + 2, nToken);
-                    }
-                }
-
-                if (scheme == detectScheme(inFileStemTokens))
-                {
-                    const auto outFileName = outFileStem(scheme, inFileStemTokens, inDirName) + inFile.extension().u8string();
-                    const fs::path outFile = outDir / fs::path(outFileName);
-
-#if defined(PRJ_DEBUG) && 0
-                    printFormattedLine("###\"" + inFile.u8string() + "\" -> \"" + outFile.u8string() + "\"");
-#endif
-                    const bool outFileExists = fs::exists(outFile);
-                    bool perform = true;
-                    fs::copy_options opt = fs::copy_options::none;
-
-                    if (outFileExists && flags.force)
-                    {
-                        opt = fs::copy_options::overwrite_existing;
-                        if (verbose) WARNING_PRINT("###overwriting destination file \"" + outFile.u8string() + "\"");
-                    }
-                    else if (outFileExists && verbose)
-                    {
-                        printInfo("###destination file \"" + outFile.u8string() + "\" exists");
-                        if (cliChoice("overwrite destination file?") == 1) opt = fs::copy_options::overwrite_existing;
-                        else perform = false;
-                    }
-                    else if(outFileExists)
-                    {
-                        perform = false;
-                        ERROR_PRINT("###destination file \"" + outFile.u8string() + "\" exists");
-                    }
-
-                    if (perform)
-                    {
-                        std::error_code ec;
-                        const bool copied = fs::copy_file(inFile, outFile, opt, ec);
-
-                        if ((copied && !(ec.value() == 0)) ||
-                            (!copied && (ec.value() == 0)))
-                        {
-                            throw (int)(__LINE__);
-                        }
-
-                        if (copied) rFileCnt.addCopied();
-                        else
-                        {
-                            ERROR_PRINT("###failed to copy file \"" + inFile.u8string() + "\" to \"" + outFile.u8string() + "\"");
-                            if (verbose) printInfo(ec.message());
-                        }
-                    }
-                }
-                else
-                {
-                    ERROR_PRINT("###scheme mismatch on file \"" + inFile.u8string() + "\", file not copied");
-
-                    if (verbose)
-                    {
-                        std::string outFileName = inFile.stem().u8string() + outFileDelimiter + inDirName + inFile.extension().u8string();
-                        const fs::path outFile = (fs::path(outDir) / outFileName).make_preferred();
-
-                        printInfo();
-                        cout << "you may use: " << omw::fgBrightWhite;
-#if defined(OMW_PLAT_UNIX)
-                        cout << "cp";
-#elif defined(OMW_PLAT_WIN)
-                        cout << "copy";
-#else
-                        cout << "<COPY>";
-#endif // OMW_PLAT_x
-                        cout << " \"" + inFile.u8string() + "\" \"" + outFile.u8string() + "\"";
-                        cout << omw::fgDefault << endl;
-                    }
-                }
-            }
-        }
-
-        return rFileCnt;
-    }
-
 #if defined(PRJ_DEBUG)
     void dbg_rm_outDir(const std::string& outDir)
     {
@@ -630,116 +340,343 @@ int app::process(const std::vector<std::string>& inDirs, const std::string& outD
 
     IMPLEMENT_FLAGS();
 
+    const util::Stopwatch swRun;
+    std::unique_ptr<app::Merger> pMerger;
+    size_t nSucceeded = 0;
+    bool scanned = false;
+
     try
     {
         util::FileCounter fileCnt;
         util::ResultCounter rcnt = 0;
-        size_t nSucceeded = 0;
-        omw::vector<std::string> postfixes;
-
-        std::vector<fs::path> ___inDirPaths(inDirs.size());
-        const std::vector<fs::path>& inDirPaths = ___inDirPaths;
-        const fs::path outDirPath = outDir;
-        for (size_t i = 0; i < inDirs.size(); ++i) ___inDirPaths.at(i) = inDirs[i];
+        std::vector<size_t> nErrors(inDirs.size(), 0);
+        size_t nOutDirErrors = 0; // errors not belonging to an INDIR, e.g. a failed flush
+        bool scanning = true;
+        std::vector<std::vector<app::Message>> scanMsgs(inDirs.size());
 
 
 #if defined(PRJ_DEBUG) && 1
         dbg_rm_outDir(outDir);
 #endif
 
+        if (flags.watch && !util::DirWatcher::isSupported()) ERROR_PRINT_EC_THROWLINE("watch mode is not supported on this platform", EC_ERROR);
+
+        app::Options options;
+        options.force = flags.force;
+        options.layout = flags.layout;
+        options.watch = flags.watch;
+        options.verify = flags.verify;
+        options.verifyNoCache = flags.verifyNoCache;
+        options.preserveTimes = flags.preserveTimes;
+        options.deviceJobs = flags.deviceJobs;
+        options.writeJobs = flags.writeJobs;
+        options.maxBandwidth = flags.maxBandwidth;
+        options.maxIops = flags.maxIops;
+        options.output = flags.output;
+        options.nearDedup = flags.nearDedup;
+        options.memLimit = flags.memLimit;
+        options.physicalOrder = flags.physicalOrder;
+        options.durability = flags.durability;
+        options.userSchemes = flags.userSchemes;
+
+        // the cached results don't know the user schemes
+        if (flags.schemeCache && (flags.userSchemes.size() == 0)) options.schemeCacheFile = app::SchemeCache::defaultFile();
+
+        pMerger = std::make_unique<app::Merger>(inDirs, outDir, options);
+        app::Merger& merger = *pMerger;
+
+        const auto printMessage = [&](const app::Message& msg)
+        {
+            const std::string path1 = msg.path1.u8string();
+            const std::string path2 = msg.path2.u8string();
+            const auto nErrorsOld = rcnt.errors();
 
-        ///////////////////////////////////////////////////////////
-        // check/create out dir
-        ///////////////////////////////////////////////////////////
+            switch (msg.code)
+            {
+            case MSGCODE::outDirInEq:
+                ERROR_PRINT("an INDIR and the OUTDIR are equivalent");
+                r = EC_INOUTDIR_EQ;
+                break;
+
+            case MSGCODE::outDirNotEmpty:
+                ERROR_PRINT("###OUTDIR \"" + outDir + "\" is not empty");
+                r = EC_OUTDIR_NOTEMPTY;
+                break;
+
+            case MSGCODE::outDirUsingNotEmpty:
+                if (verbose) WARNING_PRINT("using non empty OUTDIR");
+                break;
+
+            case MSGCODE::outDirNotCreated:
+                ERROR_PRINT("failed to create OUTDIR");
+                r = EC_OUTDIR_NOTCREATED;
+                break;
+
+            case MSGCODE::archiveExists:
+                ERROR_PRINT("###archive \"" + path1 + "\" exists");
+                r = EC_OUTDIR_NOTEMPTY;
+                break;
+
+            case MSGCODE::archiveOverwriting:
+                if (verbose) WARNING_PRINT("###overwriting archive \"" + path1 + "\"");
+                break;
+
+            case MSGCODE::archiveFailed:
+                ERROR_PRINT("###failed to write archive \"" + path1 + "\"");
+                if (verbose) printInfo(msg.detail);
+                r = EC_OUTDIR_NOTCREATED;
+                break;
+
+            case MSGCODE::syncFailed:
+                ERROR_PRINT("###failed to flush \"" + path1 + "\" to the device");
+                if (verbose) printInfo(msg.detail);
+                r = EC_ERROR;
+                break;
+
+            case MSGCODE::inDirNotADir:
+                ERROR_PRINT("INDIR is not a directory");
+                break;
+
+            case MSGCODE::inDirUnreadable:
+                ERROR_PRINT("failed to read archive");
+                if (verbose) printInfo(msg.detail);
+                break;
+
+            case MSGCODE::inDirNotExisting:
+                ERROR_PRINT("INDIR does not exist");
+                break;
+
+            case MSGCODE::inDirEmpty:
+                WARNING_PRINT("INDIR is empty");
+                break;
+
+            case MSGCODE::inDirUnknownScheme:
+                ERROR_PRINT("unknown scheme");
+                break;
+
+            case MSGCODE::inDirNameUsed:
+                ERROR_PRINT("INDIR name was already used, no files copied");
+                break;
+
+            case MSGCODE::inDirWatchFailed:
+                ERROR_PRINT("failed to watch INDIR");
+                break;
+
+            case MSGCODE::inDirWatchOverflow:
+                WARNING_PRINT("###too many events on \"" + path1 + "\", checking all files of the INDIR");
+                break;
+
+            case MSGCODE::schemeMismatch:
+                ERROR_PRINT("###scheme mismatch on file \"" + path1 + "\", file not copied");
+
+                if (verbose && !path2.empty())
+                {
+                    printInfo();
+                    cout << "you may use: " << omw::fgBrightWhite;
+#if defined(OMW_PLAT_UNIX)
+                    cout << "cp";
+#elif defined(OMW_PLAT_WIN)
+                    cout << "copy";
+#else
+                    cout << "<COPY>";
+#endif // OMW_PLAT_x
+                    cout << " \"" + path1 + "\" \"" + path2 + "\"";
+                    cout << omw::fgDefault << endl;
+                }
+                break;
+
+            case MSGCODE::destExists:
+                ERROR_PRINT("###destination file \"" + path2 + "\" exists");
+                break;
+
+            case MSGCODE::destOverwriting:
+                if (verbose) WARNING_PRINT("###overwriting destination file \"" + path2 + "\"");
+                break;
+
+            case MSGCODE::nearDuplicate:
+                if (verbose) WARNING_PRINT("###\"" + path1 + "\" looks like \"" + path2 + "\", file not copied");
+                break;
+
+            case MSGCODE::copyFailed:
+                ERROR_PRINT("###failed to copy file \"" + path1 + "\" to \"" + path2 + "\"");
+                if (verbose) printInfo(msg.detail);
+                break;
+
+            case MSGCODE::verifyFailed:
+                ERROR_PRINT("###verification of \"" + path2 + "\" failed, it differs from \"" + path1 + "\"");
+                if (verbose && !msg.detail.empty()) printInfo(msg.detail);
+                break;
+
+            case MSGCODE::manifestNotWritten:
+                ERROR_PRINT("###failed to write manifest file \"" + path1 + "\"");
+                break;
 
-        if (fs::exists(outDir))
+            default:
+                throw (int)(__LINE__);
+                break;
+            }
+
+            if (rcnt.errors() != nErrorsOld)
+            {
+                if (msg.inDirIdx != app::Message::npos) ++nErrors.at(msg.inDirIdx);
+                else ++nOutDirErrors;
+            }
+        };
+
+        merger.onMessage = [&](const app::Message& msg)
         {
-            if (::equivalent(inDirPaths, outDirPath)) ERROR_PRINT_EC_THROWLINE("an INDIR and the OUTDIR are equivalent", EC_INOUTDIR_EQ);
+            // INDIR messages are printed below the INDIR title
+            if (scanning && (msg.inDirIdx != app::Message::npos)) scanMsgs.at(msg.inDirIdx).push_back(msg);
+            else printMessage(msg);
+        };
 
-            if (!fs::is_empty(outDir))
+        if (verbose)
+        {
+            merger.onQuestion = [&](const app::Message& msg)
             {
-                if (flags.force)
+                bool answer = false;
+
+                if (msg.code == MSGCODE::outDirNotEmpty)
+                {
+                    printInfo("###OUTDIR \"" + outDir + "\" is not empty");
+                    answer = (cliChoice("use non empty OUTDIR?") == 1);
+                    if (!answer) r = EC_USER_ABORT;
+                }
+                else if (msg.code == MSGCODE::archiveExists)
                 {
-                    if (verbose) WARNING_PRINT("using non empty OUTDIR");
+                    printInfo("###archive \"" + msg.path1.u8string() + "\" exists");
+                    answer = (cliChoice("overwrite archive?") == 1);
+                    if (!answer) r = EC_USER_ABORT;
                 }
-                else
+                else if (msg.code == MSGCODE::destExists)
                 {
-                    const std::string msg = "###OUTDIR \"" + outDir + "\" is not empty";
+                    printInfo("###destination file \"" + msg.path2.u8string() + "\" exists");
+                    answer = (cliChoice("overwrite destination file?") == 1);
+                }
+                else throw (int)(__LINE__);
+
+                return answer;
+            };
+        }
+
+
+        // the effective rate is printed while throttled, so that it's visible when the limits kick in
+        if (merger.rateLimiter() && !quiet)
+        {
+            const util::RateLimiter& limiter = *merger.rateLimiter();
+
+            merger.onProgress = [&limiter, sw = util::Stopwatch(), bytes = uint64_t(0), ops = uint64_t(0), throttled = 0.0, rate = std::string()](size_t nDone, size_t nTotal) mutable
+            {
+                const double t = sw.elapsed();
 
-                    if (verbose)
+                if ((t >= 2.0) || (nDone == nTotal))
+                {
+                    // a short last interval says nothing, the previous rate is kept
+                    if ((t >= 0.5) || rate.empty())
                     {
-                        printInfo(msg);
+                        const uint64_t dBytes = limiter.bytes() - bytes;
+                        const uint64_t dOps = limiter.ops() - ops;
+                        const bool isThrottled = (limiter.throttled() > throttled);
 
-                        if (2 == cliChoice("use non empty OUTDIR?"))
-                        {
-                            r = EC_USER_ABORT;
-                            throw (int)(__LINE__);
-                        }
+                        bytes = limiter.bytes();
+                        ops = limiter.ops();
+                        throttled = limiter.throttled();
+                        sw.restart();
+
+                        rate = rateString(t > 0 ? (double)dBytes / t : 0) + ", " + std::to_string((uint64_t)std::round(t > 0 ? (double)dOps / t : 0)) + " IOPS" + (isThrottled ? " (throttled)" : "");
                     }
-                    else ERROR_PRINT_EC_THROWLINE(msg, EC_OUTDIR_NOTEMPTY);
+
+                    printInfo("###progress @" + std::to_string(nDone) + "/" + std::to_string(nTotal) + "@ files, " + rate);
                 }
-            }
+            };
         }
-        else
-        {
-            fs::create_directories(outDirPath);
 
-            if (!fs::exists(outDir)) ERROR_PRINT_EC_THROWLINE("failed to create OUTDIR", EC_OUTDIR_NOTCREATED);
-        }
+
+        ///////////////////////////////////////////////////////////
+        // check/create out dir, scan in dirs
+        ///////////////////////////////////////////////////////////
+
+        if (!merger.scan()) throw (int)(__LINE__);
+
+        scanning = false;
+        scanned = true;
 
 
         ///////////////////////////////////////////////////////////
         // process
         ///////////////////////////////////////////////////////////
 
-        double rate = 0;
-        scheme_t scheme;
-        omw::vector<omw::string> usedInDirNames;
+        // INDIRs on different devices are copied at the same time and archives are written in chronological order, so
+        // all INDIRs are planned first
+        const bool planAllFirst = merger.planAllFirst();
 
         for (size_t i_inDir = 0; i_inDir < inDirs.size(); ++i_inDir)
         {
-            const auto nErrorsOld = rcnt.errors();
-            const auto& inDir = inDirs[i_inDir];
+            const auto& inDir = merger.inDirs()[i_inDir];
 
             if (verbose && (i_inDir > 0)) cout << endl;
 
-            if (fs::directory_entry(inDir).is_directory())
+            if (!quiet) printFormattedLine(inDirTitle(inDir, merger.options().userSchemes));
+            for (const auto& msg : scanMsgs[i_inDir]) printMessage(msg);
+
+            if (planAllFirst) merger.plan(i_inDir);
+            else
             {
-                scheme = detectScheme(inDir, &rate);
-                if (!quiet) printFormattedLine("###\"" + (fs::path(inDir)).make_preferred().u8string() + "\" " + toString(scheme) + (scheme == SCHEME::unknown ? "" : " (" + std::to_string((int)round(rate * 100)) + "%)"));
+                merger.planAndExecute(i_inDir);
 
-                if (scheme != SCHEME::unknown)
+                if (verbose && (inDir.status == app::InDir::ok)) printInfo("###copied @" + std::to_string(inDir.fileCnt.copied()) + "/" + std::to_string(inDir.fileCnt.total()) + "@ files" + dedupString(inDir.fileCnt));
+            }
+        }
+
+        if (planAllFirst)
+        {
+            if (verbose) cout << endl;
+
+            merger.execute();
+
+            if (verbose)
+            {
+                for (const auto& inDir : merger.inDirs())
                 {
-                    if (fs::exists(inDir))
-                    {
-                        if (!fs::is_empty(inDir))
-                        {
-                            const auto inDirName = getDirName(inDir);
-
-                            if (!usedInDirNames.contains(inDirName))
-                            {
-                                usedInDirNames.push_back(inDirName);
-                                const auto tmpFileCnt = ::process(scheme, inDir, inDirName, outDir, flags, rcnt);
-                                if (verbose) printInfo("###copied @" + std::to_string(tmpFileCnt.copied()) + "/" + std::to_string(tmpFileCnt.total()) + "@ files");
-                                fileCnt.add(tmpFileCnt);
-                            }
-                            else ERROR_PRINT("INDIR name was already used, no files copied");
-                        }
-                        else WARNING_PRINT("INDIR is empty");
-                    }
-                    else ERROR_PRINT("INDIR does not exist");
+                    if (inDir.status == app::InDir::ok) printInfo("###\"" + inDir.name + "\" copied @" + std::to_string(inDir.fileCnt.copied()) + "/" + std::to_string(inDir.fileCnt.total()) + "@ files" + dedupString(inDir.fileCnt));
                 }
-                else ERROR_PRINT("unknown scheme");
             }
-            else
+        }
+
+        if (flags.watch)
+        {
+            size_t nWatched = 0;
+            for (const auto& inDir : merger.inDirs()) if ((inDir.status == app::InDir::ok) && !inDir.archive) ++nWatched;
+
+            if (nWatched > 0)
             {
-                if (!quiet) printFormattedLine("###\"" + inDir + "\"");
-                ERROR_PRINT("INDIR is not a directory");
-            }
+                if (verbose)
+                {
+                    merger.onFileDone = [](const app::PlanEntry& entry, const app::CopyResult& result)
+                    {
+                        if (result.copied) printFormattedLine("###copied \"" + entry.inFile.u8string() + "\" to \"" + entry.outFile.u8string() + "\"");
+                    };
+                }
+
+                watchStop = 0;
+                const auto oldSigInt = std::signal(SIGINT, watchSignalHandler);
+                const auto oldSigTerm = std::signal(SIGTERM, watchSignalHandler);
+
+                if (verbose) cout << endl;
+                INFO_PRINT("watching " + std::to_string(nWatched) + " INDIR" + (nWatched == 1 ? "" : "s") + ", press Ctrl+C to stop");
 
-            if (rcnt.errors() == nErrorsOld) ++nSucceeded;
+                merger.watch([]() { return (watchStop != 0); });
+
+                std::signal(SIGINT, oldSigInt);
+                std::signal(SIGTERM, oldSigTerm);
+            }
         }
 
+        merger.finish();
+
+        fileCnt = merger.fileCount();
+        for (const auto& n : nErrors) if (n == 0) ++nSucceeded;
+
         ///////////////////////////////////////////////////////////
         // end
         ///////////////////////////////////////////////////////////
@@ -771,11 +708,27 @@ int app::process(const std::vector<std::string>& inDirs, const std::string& outD
             cout << " ========" << endl;
 
             //if (verbose) printFormattedLine("###copied @" + std::to_string(fileCnt.copied()) + "/" + std::to_string(fileCnt.total()) + "@ files");
-            if (verbose) printFormattedLine("copied " + std::to_string(fileCnt.copied()) + "/" + std::to_string(fileCnt.total()) + " files");
+            if (verbose) printFormattedLine("copied " + std::to_string(fileCnt.copied()) + "/" + std::to_string(fileCnt.total()) + " files" + dedupString(fileCnt));
+
+            const auto& latencies = merger.latencies();
+
+            if (verbose && (latencies.copy.count() > 0))
+            {
+                printFormattedLine("copy latency: " + latencyString(latencies.copy));
+                if (latencies.verify.count() > 0) printFormattedLine("verify latency: " + latencyString(latencies.verify));
+
+                printFormattedLine("slowest files:");
+                for (const auto& file : latencies.slowest)
+                {
+                    std::ostringstream oss;
+                    oss << std::right << std::setw(7) << durationString(file.duration) << "  " << std::setw(10) << sizeString((double)file.size);
+                    printFormattedLine("###    " + oss.str() + "  \"" + file.path.u8string() + "\"");
+                }
+            }
         }
 
-        if (((nSucceeded == inDirs.size()) && (rcnt.errors() != 0)) ||
-            ((nSucceeded != inDirs.size()) && (rcnt.errors() == 0)))
+        if (((nSucceeded == inDirs.size()) && (rcnt.errors() != nOutDirErrors)) ||
+            ((nSucceeded != inDirs.size()) && (rcnt.errors() == nOutDirErrors)))
         {
             r = EC_OK;
             throw (int)(__LINE__);
@@ -783,7 +736,7 @@ int app::process(const std::vector<std::string>& inDirs, const std::string& outD
 
         //if (verbose) cout << "\n" << omw::fgBrightGreen << "done" << omw::defaultForeColor << endl;
 
-        if (nSucceeded != inDirs.size()) r = EC_ERROR;
+        if ((nSucceeded != inDirs.size()) || (nOutDirErrors != 0)) r = EC_ERROR;
     }
     catch (const std::filesystem::filesystem_error& ex)
     {
@@ -841,5 +794,61 @@ int app::process(const std::vector<std::string>& inDirs, const std::string& outD
 
     if (r == EC_USER_ABORT) r = EC_OK;
 
+    if (flags.index && scanned)
+    {
+        if (!app::updateTimeline(*pMerger, flags.indexCsv))
+        {
+            if (!quiet) printError("###failed to update the timeline index \"" + (fs::u8path(outDir) / app::timelineFileName).u8string() + "\"");
+            if (r == EC_OK) r = EC_ERROR;
+        }
+    }
+
+    if (!flags.report.empty() && pMerger)
+    {
+        app::RunSummary summary;
+        summary.exitCode = r;
+        summary.nSucceeded = nSucceeded;
+        summary.duration = swRun.elapsed();
+
+        if (!app::writeJsonReport(flags.report, *pMerger, summary))
+        {
+            if (!quiet) printError("###failed to write report file \"" + flags.report + "\"");
+            if (r == EC_OK) r = EC_ERROR;
+        }
+    }
+
+    return r;
+}
+
+int app::query(const std::string& outDir, uint64_t from, uint64_t to, const std::string& who)
+{
+    int r = EC_OK;
+
+    const std::string file = (fs::u8path(outDir) / app::timelineFileName).u8string();
+    app::TimelineIndex index;
+
+    if (index.open(file))
+    {
+        try
+        {
+            for (const auto& rec : index.query(from, to, who))
+            {
+                cout << app::formatTimestamp(rec.timestamp) << '\t' << rec.who << '\t' << rec.name << '\t' << rec.size << '\n';
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            r = EC_ERROR;
+            printError(ex.what());
+        }
+    }
+    else
+    {
+        r = EC_ERROR;
+        printError("###failed to read the timeline index \"" + file + "\"");
+    }
+
+    cout << std::flush;
+
     return r;
 }
@@ -7,9 +7,12 @@ copyright       GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
 #ifndef IG_APP_PROCESSOR_H
 #define IG_APP_PROCESSOR_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "application/merger.h"
+
 
 namespace app
 {
@@ -18,15 +21,37 @@ namespace app
         Flags() = delete;
 
         Flags(bool force_, bool quiet_, bool verbose_)
-            : force(force_), quiet(quiet_), verbose(verbose_)
+            : force(force_), quiet(quiet_), verbose(verbose_), layout(LAYOUT::flat), watch(false), report(), index(false), indexCsv(false), verify(false), verifyNoCache(false), preserveTimes(false), deviceJobs(1), writeJobs(4), maxBandwidth(0), maxIops(0), output(OUTPUT::directory), nearDedup(false), memLimit(0), physicalOrder(false), durability(DURABILITY::none), schemeCache(true), userSchemes()
         {}
 
         bool force;
         bool quiet;
         bool verbose;
+        app::layout_t layout;
+        bool watch;
+        std::string report; // JSON report file, empty if none
+        bool index;         // update the timeline index of the OUTDIR
+        bool indexCsv;      // also write the timeline index as CSV
+        bool verify;
+        bool verifyNoCache;
+        bool preserveTimes;
+        size_t deviceJobs;  // concurrent copies per source device
+        size_t writeJobs;   // concurrent copies to the OUTDIR
+        uint64_t maxBandwidth; // bytes per second, 0 is unlimited
+        uint64_t maxIops;   // 0 is unlimited
+        app::output_t output;
+        bool nearDedup;
+        uint64_t memLimit;  // bytes, 0 is unlimited
+        bool physicalOrder;
+        app::durability_t durability;
+        bool schemeCache;   // use the scheme cache in the user's cache directory
+        app::UserSchemes userSchemes;
     };
 
     int process(const std::vector<std::string>& inDirs, const std::string& outDir, const app::Flags& flags);
+
+    // prints the records of the timeline index of the OUTDIR with from <= timestamp <= to (YYYYMMDDhhmmss), of the photographer who (all if empty)
+    int query(const std::string& outDir, uint64_t from, uint64_t to, const std::string& who);
 }
 
 
@@ -0,0 +1,177 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "merger.h"
+#include "middleware/json.h"
+#include "middleware/util.h"
+#include "project.h"
+#include "report.h"
+#include "scheme.h"
+
+
+namespace
+{
+    const char* toString(const app::InDir::status_t& status)
+    {
+        const char* r;
+
+        switch (status)
+        {
+        case app::InDir::pending: r = "pending"; break;
+        case app::InDir::ok: r = "ok"; break;
+        case app::InDir::notADir: r = "notADirectory"; break;
+        case app::InDir::unreadable: r = "unreadable"; break;
+        case app::InDir::notExisting: r = "notExisting"; break;
+        case app::InDir::empty: r = "empty"; break;
+        case app::InDir::unknownScheme: r = "unknownScheme"; break;
+        case app::InDir::nameUsed: r = "nameUsed"; break;
+        default: r = "ERROR"; break;
+        }
+
+        return r;
+    }
+
+    double perSecond(double value, double duration)
+    {
+        return (duration > 0 ? (value / duration) : 0);
+    }
+
+    void writeFiles(util::JsonWriter& json, const util::FileCounter& cnt)
+    {
+        json.beginObject("files");
+        json.value("total", (uint64_t)cnt.total());
+        json.value("copied", (uint64_t)cnt.copied());
+        json.value("skipped", (uint64_t)cnt.skipped());
+        json.value("deduplicated", (uint64_t)cnt.deduplicated());
+        json.value("failed", (uint64_t)cnt.failed());
+        json.value("bytesCopied", (uint64_t)cnt.bytesCopied());
+        json.endObject();
+    }
+
+    void writeDurations(util::JsonWriter& json, const util::PhaseDurations& dur)
+    {
+        json.beginObject("durations");
+        json.value("scan", dur.scan());
+        json.value("plan", dur.plan());
+        json.value("copy", dur.copy());
+        json.endObject();
+    }
+
+    // seconds
+    void writeLatency(util::JsonWriter& json, const std::string& key, const util::Histogram& h)
+    {
+        json.beginObject(key);
+        json.value("count", h.count());
+        json.value("p50", (double)h.percentile(0.5) * 1e-6);
+        json.value("p90", (double)h.percentile(0.9) * 1e-6);
+        json.value("p99", (double)h.percentile(0.99) * 1e-6);
+        json.value("max", (double)h.max() * 1e-6);
+        json.endObject();
+    }
+
+    void writeLatencies(util::JsonWriter& json, const app::Latencies& latencies)
+    {
+        json.beginObject("latencies");
+        writeLatency(json, "copy", latencies.copy);
+        writeLatency(json, "verify", latencies.verify);
+
+        json.beginArray("slowest");
+        for (const auto& file : latencies.slowest)
+        {
+            json.beginObject();
+            json.value("path", file.path.u8string());
+            json.value("size", file.size);
+            json.value("duration", file.duration);
+            json.endObject();
+        }
+        json.endArray();
+
+        json.endObject();
+    }
+
+    // based on the copy duration
+    void writeThroughput(util::JsonWriter& json, const util::FileCounter& cnt, const util::PhaseDurations& dur)
+    {
+        json.beginObject("throughput");
+        json.value("filesPerSecond", perSecond((double)cnt.copied(), dur.copy()));
+        json.value("bytesPerSecond", perSecond((double)cnt.bytesCopied(), dur.copy()));
+        json.endObject();
+    }
+}
+
+
+
+std::string app::jsonReport(const app::Merger& merger, const app::RunSummary& summary)
+{
+    const auto fileCnt = merger.fileCount();
+    const auto rcnt = merger.resultCount();
+    const auto& inDirs = merger.inDirs();
+
+    util::JsonWriter json;
+
+    json.beginObject();
+    json.value("version", prj::version.toString());
+    json.value("outDir", merger.outDir());
+
+    json.beginObject("result");
+    json.value("exitCode", summary.exitCode);
+    json.value("inDirs", (uint64_t)inDirs.size());
+    json.value("succeeded", (uint64_t)summary.nSucceeded);
+    json.value("errors", (uint64_t)rcnt.errors());
+    json.value("warnings", (uint64_t)rcnt.warnings());
+    json.value("duration", summary.duration);
+    json.endObject();
+
+    writeFiles(json, fileCnt);
+    writeDurations(json, merger.durations());
+    writeThroughput(json, fileCnt, merger.durations());
+    writeLatencies(json, merger.latencies());
+
+    // if the plan was spilled, the memory is the one of the last executed batch
+    const auto& plan = merger.entries();
+    json.beginObject("plan");
+    json.value("entries", (uint64_t)(merger.spill() ? merger.spill()->size() : plan.size()));
+    if (merger.spill()) json.value("spilledRuns", (uint64_t)merger.spill()->runs());
+    json.value("memory", (uint64_t)plan.memoryUsage());
+    json.value("memoryPerEntry", (plan.empty() ? 0.0 : ((double)plan.memoryUsage() / (double)plan.size())));
+    json.endObject();
+
+    json.beginArray("inDirs");
+    for (const auto& inDir : inDirs)
+    {
+        json.beginObject();
+        json.value("path", inDir.path);
+        json.value("name", inDir.name);
+        json.value("status", ::toString(inDir.status));
+        json.value("scheme", app::toString(inDir.scheme, merger.options().userSchemes));
+        json.value("detectionRate", inDir.rate);
+        json.value("schemeCached", inDir.schemeCached);
+        json.value("errors", (uint64_t)inDir.rcnt.errors());
+        json.value("warnings", (uint64_t)inDir.rcnt.warnings());
+        writeFiles(json, inDir.fileCnt);
+        writeDurations(json, inDir.durations);
+        writeThroughput(json, inDir.fileCnt, inDir.durations);
+        json.endObject();
+    }
+    json.endArray();
+
+    json.endObject();
+
+    return json.str();
+}
+
+bool app::writeJsonReport(const std::string& file, const app::Merger& merger, const app::RunSummary& summary)
+{
+    std::ofstream ofs(file, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (ofs.good()) ofs << jsonReport(merger, summary);
+
+    return ofs.good();
+}
@@ -0,0 +1,35 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_APP_REPORT_H
+#define IG_APP_REPORT_H
+
+#include <cstddef>
+#include <string>
+
+#include "application/merger.h"
+
+
+namespace app
+{
+    struct RunSummary
+    {
+        RunSummary() : exitCode(0), nSucceeded(0), duration(0) {}
+
+        int exitCode;
+        size_t nSucceeded;  // number of INDIRs without errors
+        double duration;    // wall time of the whole run in seconds
+    };
+
+    // returns the machine readable JSON report of a (finished) merge
+    std::string jsonReport(const app::Merger& merger, const app::RunSummary& summary);
+
+    // returns false if the file could not be written
+    bool writeJsonReport(const std::string& file, const app::Merger& merger, const app::RunSummary& summary);
+}
+
+
+#endif // IG_APP_REPORT_H
@@ -0,0 +1,321 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "middleware/util.h"
+#include "project.h"
+#include "scheme.h"
+
+#include <omw/string.h>
+
+
+omw::string app::toString(const app::scheme_t& scheme, const app::UserSchemes& userSchemes)
+{
+    omw::string r = "ERROR";
+
+    switch (scheme)
+    {
+    case SCHEME::unknown:
+        r = "Unknown";
+        break;
+
+    case SCHEME::huawai:
+        r = "Huawai";
+        break;
+
+    case SCHEME::samsung:
+        r = "Samsung";
+        break;
+
+    case SCHEME::winphone:
+        r = "Winphone";
+        break;
+
+    default:
+        if ((scheme >= SCHEME::user) && ((size_t)(scheme - SCHEME::user) < userSchemes.size())) r = userSchemes.name(scheme - SCHEME::user);
+        else r = "ERROR";
+        break;
+    }
+
+    return r;
+}
+
+bool app::schemeIsHuawai(const omw::stringVector_t& tokens)
+{
+    bool r = false;
+
+    if (tokens.size() >= nTokensHuawai)
+    {
+        if (((tokens[0] == "IMG") || (tokens[0] == "VID") || (tokens[0] == "PANO")) &&
+            (tokens[1].length() == 8) && omw::isUInteger(tokens[1]) &&
+            (tokens[2].length() == 6) && omw::isUInteger(tokens[2]))
+        {
+            r = true;
+        }
+    }
+
+    return r;
+}
+
+bool app::schemeIsSamsung(const omw::stringVector_t& tokens)
+{
+    bool r = false;
+
+    if (tokens.size() >= nTokensSamsung)
+    {
+        if ((tokens[0].length() == 8) && omw::isUInteger(tokens[0]) &&
+            (tokens[1].length() == 6) && omw::isUInteger(tokens[1]))
+        {
+            r = true;
+        }
+    }
+
+    return r;
+}
+
+bool app::schemeIsWinPhone(const omw::stringVector_t& tokens)
+{
+    bool r = false;
+
+    if (tokens.size() >= nTokensWinPhone)
+    {
+        if ((tokens[0] == "WP") &&
+            (tokens[1].length() == 8) && omw::isUInteger(tokens[1]) &&
+            (tokens[2].length() == 2) && omw::isUInteger(tokens[2]) &&
+            (tokens[3].length() == 2) && omw::isUInteger(tokens[3]) &&
+            (tokens[4].length() == 2) && omw::isUInteger(tokens[4]) &&
+            (tokens[5] == "Pro"))
+        {
+            r = true;
+        }
+    }
+
+    return r;
+}
+
+omw::stringVector_t app::tokenize(const std::string& inFileStem)
+{
+    omw::stringVector_t r = omw_::split(inFileStem, inFileDelimiter);
+
+    // Samsung multiple images in same second
+    if ((r.size() >= nTokensSamsung) && r[1].contains('(') && (r[1].back() == ')'))
+    {
+        const auto samsungTimeTokens = r[1].split('(');
+        const auto& timeToken = samsungTimeTokens[0];
+        const auto nToken = samsungTimeTokens[1].split(')')[0];
+
+        if ((samsungTimeTokens.size() == 2) && omw::isUInteger(timeToken) && omw::isUInteger(nToken))
+        {
+            r[1] = timeToken;
+            r.insert(r.begin() + 2, nToken);
+        }
+    }
+
+    return r;
+}
+
+app::scheme_t app::detectScheme(const omw::stringVector_t& tokens)
+{
+    scheme_t r = SCHEME::unknown;
+
+    const bool huawai = schemeIsHuawai(tokens);
+    const bool samsung = schemeIsSamsung(tokens);
+    const bool wp = schemeIsWinPhone(tokens);
+
+    if (huawai && !samsung && !wp) r = SCHEME::huawai;
+    else if (!huawai && samsung && !wp) r = SCHEME::samsung;
+    else if (!huawai && !samsung && wp) r = SCHEME::winphone;
+    // else nop
+
+    return r;
+}
+
+app::scheme_t app::detectScheme(const std::string& inFileStem, const app::UserSchemes& userSchemes)
+{
+    const size_t idx = userSchemes.match(inFileStem);
+
+    if (idx != UserSchemes::npos) return (scheme_t)(SCHEME::user + idx);
+
+    return detectScheme(tokenize(inFileStem));
+}
+
+app::scheme_t app::detectScheme(const std::vector<std::string>& stemFilenames, const app::UserSchemes& userSchemes, double* pRate)
+{
+    return detectScheme(stemFilenames.size(), [&stemFilenames](size_t i) { return stemFilenames[i]; }, userSchemes, pRate);
+}
+
+app::scheme_t app::detectScheme(size_t nFiles, const std::function<std::string(size_t i)>& stem, const app::UserSchemes& userSchemes, double* pRate, size_t* pSampled)
+{
+    scheme_t r = SCHEME::unknown;
+
+    constexpr size_t k = 30;
+    size_t blockSize = nFiles / k;
+    if ((blockSize == 0) || (nFiles <= k)) blockSize = 1;
+
+    size_t nAnalyzed = 0;
+
+    // huawai, samsung, winphone, then the user schemes
+    std::vector<size_t> cnt(3 + userSchemes.size(), 0);
+
+    for (size_t i = 0; i < nFiles; i += blockSize)
+    {
+        const std::string stemFilename = stem(i);
+        const size_t idx = userSchemes.match(stemFilename);
+
+        if (idx != UserSchemes::npos) ++cnt[3 + idx];
+        else
+        {
+            const auto tokens = omw::string(stemFilename).split(inFileDelimiter, nTokensMax + 1);
+            if (schemeIsHuawai(tokens)) ++cnt[0];
+            if (schemeIsSamsung(tokens)) ++cnt[1];
+            if (schemeIsWinPhone(tokens)) ++cnt[2];
+        }
+
+        ++nAnalyzed;
+    }
+
+    const size_t first = std::max_element(cnt.begin(), cnt.end()) - cnt.begin();
+    const size_t nFirst = cnt[first];
+    const bool unique = (std::count(cnt.begin(), cnt.end(), nFirst) == 1);
+
+    const double rate = (double)(nFirst) / (double)(nAnalyzed);
+    if (pRate) *pRate = rate;
+
+    if (unique && (rate >= 0.75))
+    {
+        if (first == 0) r = SCHEME::huawai;
+        else if (first == 1) r = SCHEME::samsung;
+        else if (first == 2) r = SCHEME::winphone;
+        else r = (scheme_t)(SCHEME::user + (first - 3));
+    }
+    else
+    {
+        r = SCHEME::unknown;
+        // maybe print something
+    }
+
+    if (pRate && (r == SCHEME::unknown)) *pRate = 1;
+    if (pSampled) *pSampled = nAnalyzed;
+
+    return r;
+}
+
+std::string app::outFileStem(const app::scheme_t& scheme, const omw::stringVector_t& tokens, const std::string& inDirName)
+{
+    std::string r;
+    size_t nTokens;
+
+    // appended in place, this is called for every file
+    r.reserve(32 + inDirName.size());
+
+    switch (scheme)
+    {
+    case SCHEME::huawai:
+        r.append(tokens[1]).append(1, outFileDelimiter).append(tokens[2]).append(1, outFileDelimiter).append(inDirName);
+        nTokens = nTokensHuawai;
+        break;
+
+    case SCHEME::samsung:
+        r.append(tokens[0]).append(1, outFileDelimiter).append(tokens[1]).append(1, outFileDelimiter).append(inDirName);
+        nTokens = nTokensSamsung;
+        break;
+
+    case SCHEME::winphone:
+        r.append(tokens[1]).append(1, outFileDelimiter).append(tokens[2]).append(tokens[3]).append(tokens[4]).append(1, outFileDelimiter).append(inDirName).append(1, outFileDelimiter).append(tokens[0]);
+        nTokens = nTokensWinPhone;
+        break;
+
+    default:
+        throw (int)(__LINE__);
+        break;
+    }
+
+    for (size_t i = nTokens; i < tokens.size(); ++i)
+    {
+        r.append(1, outFileDelimiter_opt).append(tokens[i]);
+    }
+
+    return r;
+}
+
+const omw::string& app::dateToken(const app::scheme_t& scheme, const omw::stringVector_t& tokens)
+{
+    switch (scheme)
+    {
+    case SCHEME::huawai:
+    case SCHEME::winphone:
+        return tokens[1];
+
+    case SCHEME::samsung:
+        return tokens[0];
+
+    default:
+        throw (int)(__LINE__);
+        break;
+    }
+}
+
+uint64_t app::timestamp(const app::scheme_t& scheme, const omw::stringVector_t& tokens)
+{
+    std::string time;
+
+    switch (scheme)
+    {
+    case SCHEME::huawai:
+        time = tokens[2];
+        break;
+
+    case SCHEME::samsung:
+        time = tokens[1];
+        break;
+
+    case SCHEME::winphone:
+        time = tokens[2] + tokens[3] + tokens[4];
+        break;
+
+    default:
+        throw (int)(__LINE__);
+        break;
+    }
+
+    return ((uint64_t)std::stoull(dateToken(scheme, tokens)) * 1000000ull) + (uint64_t)std::stoull(time);
+}
+
+bool app::parseStem(const app::scheme_t& scheme, const std::string_view& inFileStem, const std::string& inDirName, const app::UserSchemes& userSchemes, app::ParsedStem& result)
+{
+    const size_t idx = userSchemes.match(inFileStem);
+
+    if (idx != UserSchemes::npos)
+    {
+        UserSchemes::Match m;
+
+        if ((scheme != (scheme_t)(SCHEME::user + idx)) || !userSchemes.extract(idx, inFileStem, m)) return false;
+
+        result.date = m.date;
+        result.timestamp = ((uint64_t)std::stoull(m.date) * 1000000ull) + (uint64_t)std::stoull(m.time);
+        result.outStem.clear();
+        result.outStem.reserve(16 + inDirName.size() + m.suffix.size());
+        result.outStem.append(m.date).append(1, outFileDelimiter).append(m.time).append(1, outFileDelimiter).append(inDirName).append(m.suffix);
+    }
+    else
+    {
+        const auto tokens = tokenize(std::string(inFileStem));
+
+        if ((scheme == SCHEME::unknown) || (scheme != detectScheme(tokens))) return false;
+
+        result.date = dateToken(scheme, tokens);
+        result.timestamp = timestamp(scheme, tokens);
+        result.outStem = outFileStem(scheme, tokens, inDirName);
+    }
+
+    return true;
+}
@@ -0,0 +1,91 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_APP_SCHEME_H
+#define IG_APP_SCHEME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "application/userscheme.h"
+
+#include <omw/string.h>
+
+
+namespace app
+{
+    constexpr char inFileDelimiter = '_';
+    constexpr char outFileDelimiter = '-';
+    constexpr char outFileDelimiter_opt = '_';
+
+    typedef enum SCHEME
+    {
+        unknown = 0,
+        huawai,     // IMG_YYYYMMDD_hhmmss
+        samsung,    // YYYYMMDD_hhmmss
+        winphone,   // WP_YYYYMMDD_hh_mm_ss_Pro
+
+        user = 0x100 // user + i is the i-th scheme of app::Options::userSchemes, see app::UserSchemes::maxSchemes
+    } scheme_t;
+
+    // the name of a user scheme is taken from userSchemes
+    omw::string toString(const app::scheme_t& scheme, const app::UserSchemes& userSchemes);
+
+    constexpr size_t nTokensHuawai = 3;
+    constexpr size_t nTokensSamsung = 2;
+    constexpr size_t nTokensWinPhone = 6;
+    constexpr size_t nTokensMax = nTokensWinPhone;
+
+    bool schemeIsHuawai(const omw::stringVector_t& tokens);
+    bool schemeIsSamsung(const omw::stringVector_t& tokens);
+    bool schemeIsWinPhone(const omw::stringVector_t& tokens);
+
+    // Splits the stem of an input file name into its tokens, Samsung's "YYYYMMDD_hhmmss(n)" is split into "YYYYMMDD", "hhmmss" and "n".
+    omw::stringVector_t tokenize(const std::string& inFileStem);
+
+    // The user schemes passed to the functions below are checked before the built in schemes, a file name matching a
+    // user scheme is of the first matching user scheme only.
+
+    // returns the built in scheme of a single file name, SCHEME::unknown if it's ambiguous
+    app::scheme_t detectScheme(const omw::stringVector_t& tokens);
+
+    // returns the scheme of a single file name, including the user schemes
+    app::scheme_t detectScheme(const std::string& inFileStem, const app::UserSchemes& userSchemes);
+
+    // Returns the dominating scheme of the file names. Returns SCHEME::unknown if the rate is too small.
+    app::scheme_t detectScheme(const std::vector<std::string>& stemFilenames, const app::UserSchemes& userSchemes, double* pRate = nullptr);
+
+    // Same as above, without the need of a list of all file names, stem(i) is called for the sampled files only. The
+    // number of sampled files is written to pSampled.
+    app::scheme_t detectScheme(size_t nFiles, const std::function<std::string(size_t i)>& stem, const app::UserSchemes& userSchemes, double* pRate = nullptr, size_t* pSampled = nullptr);
+
+    // YYYYMMDD-hhmmss-NAME[_...] of a built in scheme
+    std::string outFileStem(const app::scheme_t& scheme, const omw::stringVector_t& tokens, const std::string& inDirName);
+
+    // YYYYMMDD
+    const omw::string& dateToken(const app::scheme_t& scheme, const omw::stringVector_t& tokens);
+
+    // YYYYMMDDhhmmss as integer, the tokens have to match the scheme
+    uint64_t timestamp(const app::scheme_t& scheme, const omw::stringVector_t& tokens);
+
+    struct ParsedStem
+    {
+        std::string date;       // YYYYMMDD
+        uint64_t timestamp;     // YYYYMMDDhhmmss
+        std::string outStem;    // YYYYMMDD-hhmmss-NAME[...]
+    };
+
+    // Parses the stem of an input file name, of built in and user schemes. Returns false if the stem is not of the
+    // scheme (see detectScheme(const std::string&, const app::UserSchemes&)).
+    bool parseStem(const app::scheme_t& scheme, const std::string_view& inFileStem, const std::string& inDirName, const app::UserSchemes& userSchemes, app::ParsedStem& result);
+}
+
+
+#endif // IG_APP_SCHEME_H
@@ -0,0 +1,141 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "project.h"
+#include "schemecache.h"
+
+#include <omw/defs.h>
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // increment if the detection changes, so that old results are not used
+    const char* const versionLine = "phodime-schemes 1";
+}
+
+
+
+void app::SchemeCache::load()
+{
+    m_results.clear();
+    m_modified = false;
+
+    std::ifstream ifs(fs::u8path(m_file), std::ios::in | std::ios::binary);
+    std::string line;
+
+    if (!std::getline(ifs, line) || (line != versionLine)) return;
+
+    while (std::getline(ifs, line))
+    {
+        std::istringstream iss(line);
+        uint64_t device, inode, nFiles;
+        int64_t mtime;
+        int scheme;
+        Entry entry;
+
+        if ((iss >> device >> inode >> mtime >> nFiles >> scheme >> entry.result.rate >> entry.result.nSampled) &&
+            (scheme >= SCHEME::unknown) && (scheme <= SCHEME::winphone))
+        {
+            entry.mtime = mtime;
+            entry.nFiles = nFiles;
+            entry.result.scheme = (app::scheme_t)scheme;
+            entry.used = false;
+
+            m_results[std::make_pair(device, inode)] = entry;
+        }
+    }
+}
+
+bool app::SchemeCache::save()
+{
+    if (!m_modified) return true;
+
+    if (m_results.size() > maxSize)
+    {
+        for (auto it = m_results.begin(); it != m_results.end();)
+        {
+            if (it->second.used) ++it;
+            else it = m_results.erase(it);
+        }
+    }
+
+    const fs::path file = fs::u8path(m_file);
+    const fs::path tmp = fs::u8path(m_file + ".tmp");
+    std::error_code ec;
+
+    if (file.has_parent_path()) fs::create_directories(file.parent_path(), ec);
+
+    {
+        std::ofstream ofs(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        ofs << versionLine << '\n';
+        ofs.precision(17);
+
+        for (const auto& it : m_results)
+        {
+            const auto& e = it.second;
+            ofs << it.first.first << ' ' << it.first.second << ' ' << e.mtime << ' ' << e.nFiles << ' ' << (int)e.result.scheme << ' ' << e.result.rate << ' ' << e.result.nSampled << '\n';
+        }
+
+        ofs.close();
+        if (ofs.fail()) return false;
+    }
+
+    // replaced at once, so that concurrent runs read either the old or the new file
+    fs::rename(tmp, file, ec);
+    if (ec) fs::remove(tmp, ec);
+
+    m_modified = false;
+
+    return !ec;
+}
+
+bool app::SchemeCache::find(const util::FileIdentity& id, uint64_t nFiles, app::SchemeCache::Result& result)
+{
+    const auto it = m_results.find(std::make_pair(id.device, id.inode));
+
+    if ((it == m_results.end()) || (it->second.mtime != id.mtime) || (it->second.nFiles != nFiles)) return false;
+
+    it->second.used = true;
+    result = it->second.result;
+
+    return true;
+}
+
+void app::SchemeCache::set(const util::FileIdentity& id, uint64_t nFiles, const app::SchemeCache::Result& result)
+{
+    m_results[std::make_pair(id.device, id.inode)] = Entry{ id.mtime, nFiles, result, true };
+    m_modified = true;
+}
+
+std::string app::SchemeCache::defaultFile()
+{
+    std::string dir;
+
+#if defined(OMW_PLAT_UNIX)
+    const char* const xdgCacheHome = std::getenv("XDG_CACHE_HOME");
+    const char* const home = std::getenv("HOME");
+
+    // relative paths in XDG variables are invalid and ignored
+    if (xdgCacheHome && (xdgCacheHome[0] == '/')) dir = std::string(xdgCacheHome) + '/' + prj::exeName;
+    else if (home && (home[0] != 0)) dir = std::string(home) + "/.cache/" + prj::exeName;
+#endif
+
+    return (dir.empty() ? dir : (fs::u8path(dir) / "schemes").u8string());
+}
@@ -0,0 +1,80 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_APP_SCHEMECACHE_H
+#define IG_APP_SCHEMECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "application/scheme.h"
+#include "middleware/util.h"
+
+
+namespace app
+{
+    // Persistent results of the scheme detection of INDIRs, so that unchanged INDIRs are not sampled again.
+    //
+    // A result is stored per INDIR identity (device and inode of the directory or archive file) together with the
+    // modification time and the number of files, it's only found if both still match. Adding, removing or renaming a
+    // file changes the modification time of the directory, the new result then replaces the old one.
+    //
+    // The file starts with a version line, followed by one result per line:
+    // "DEVICE INODE MTIME NFILES SCHEME RATE NSAMPLED". Results which have not been used by the run are dropped on save
+    // if there are more than maxSize.
+    class SchemeCache
+    {
+    public:
+        struct Result
+        {
+            app::scheme_t scheme;
+            double rate;
+            size_t nSampled;    // number of file names the result is based on
+        };
+
+        static constexpr size_t maxSize = 100000;
+
+    public:
+        SchemeCache() = delete;
+        explicit SchemeCache(const std::string& file) : m_file(file), m_results(), m_modified(false) {}
+        virtual ~SchemeCache() {}
+
+        // reads the file, a missing, corrupt or outdated file is an empty cache
+        void load();
+
+        // writes the file if results have been added, returns false on error
+        bool save();
+
+        bool find(const util::FileIdentity& id, uint64_t nFiles, app::SchemeCache::Result& result);
+        void set(const util::FileIdentity& id, uint64_t nFiles, const app::SchemeCache::Result& result);
+
+        size_t size() const { return m_results.size(); }
+
+        // "$XDG_CACHE_HOME/phodime/schemes", "~/.cache/phodime/schemes" if XDG_CACHE_HOME is not set, empty if the
+        // variables are not set. Empty on platforms other than UNIX, the INDIR identities are not supported there (see
+        // util::fileIdentity()).
+        static std::string defaultFile();
+
+    private:
+        struct Entry
+        {
+            int64_t mtime;
+            uint64_t nFiles;
+            Result result;
+            bool used;
+        };
+
+        std::string m_file;
+        std::map<std::pair<uint64_t, uint64_t>, Entry> m_results; // key: device and inode
+        bool m_modified;
+    };
+}
+
+
+#endif // IG_APP_SCHEMECACHE_H
@@ -0,0 +1,446 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "merger.h"
+#include "middleware/util.h"
+#include "plan.h"
+#include "timeline.h"
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char magic[8] = { 'P', 'H', 'O', 'D', 'I', 'M', 'T', 'L' };
+    constexpr uint32_t version = 1;
+    constexpr size_t headerSize = 32;
+    constexpr size_t recordSize = 32;
+    constexpr size_t whoSize = 8;
+
+    uint32_t getU32(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+    }
+
+    uint64_t getU64(const uint8_t* p)
+    {
+        return ((uint64_t)getU32(p) | ((uint64_t)getU32(p + 4) << 32));
+    }
+
+    void putU32(std::ostream& os, uint32_t value)
+    {
+        const char buffer[4] = { (char)(value), (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+        os.write(buffer, sizeof(buffer));
+    }
+
+    void putU64(std::ostream& os, uint64_t value)
+    {
+        putU32(os, (uint32_t)(value));
+        putU32(os, (uint32_t)(value >> 32));
+    }
+
+    std::string csvField(const std::string& str)
+    {
+        if (str.find_first_of(",\"\r\n") == std::string::npos) return str;
+
+        std::string r = "\"";
+
+        for (const char c : str)
+        {
+            if (c == '\"') r += '\"';
+            r += c;
+        }
+
+        return (r + '\"');
+    }
+
+    // all records of the index before they are sorted and written
+    class Builder
+    {
+    public:
+        struct Record
+        {
+            uint64_t timestamp;
+            uint64_t size;
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint32_t who;
+        };
+
+    public:
+        Builder() {}
+        virtual ~Builder() {}
+
+        void add(uint64_t timestamp, uint64_t size, const std::string& who, const std::string_view& name)
+        {
+            Record rec;
+            rec.timestamp = timestamp;
+            rec.size = size;
+            rec.nameOffset = m_names.add(name);
+            rec.nameLength = (uint32_t)name.size();
+            rec.who = whoIdx(who);
+
+            m_records.push_back(rec);
+        }
+
+        // sorts the records by timestamp and name, of records with the same name the last added is kept
+        void sort()
+        {
+            const auto less = [this](const Record& a, const Record& b)
+            {
+                if (a.timestamp != b.timestamp) return (a.timestamp < b.timestamp);
+                return (name(a) < name(b));
+            };
+
+            std::stable_sort(m_records.begin(), m_records.end(), less);
+
+            size_t n = 0;
+
+            for (size_t i = 0; i < m_records.size(); ++i)
+            {
+                const bool duplicate = ((i + 1) < m_records.size()) && !less(m_records[i], m_records[i + 1]);
+                if (!duplicate) m_records[n++] = m_records[i];
+            }
+
+            m_records.resize(n);
+        }
+
+        bool write(const fs::path& file) const;
+        bool writeCsv(const fs::path& file) const;
+
+    private:
+        std::vector<Record> m_records;
+        util::StringArena m_names;
+        std::vector<std::string> m_who;
+        std::unordered_map<std::string, uint32_t> m_whoIdx;
+
+        std::string_view name(const Record& rec) const { return m_names.get(rec.nameOffset, rec.nameLength); }
+
+        uint32_t whoIdx(const std::string& who)
+        {
+            const auto it = m_whoIdx.find(who);
+            if (it != m_whoIdx.end()) return it->second;
+
+            const uint32_t r = (uint32_t)m_who.size();
+            m_who.push_back(who);
+            m_whoIdx.emplace(who, r);
+
+            return r;
+        }
+    };
+
+    bool Builder::write(const fs::path& file) const
+    {
+        std::ofstream ofs(file, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!ofs.good()) return false;
+
+        uint64_t stringsSize = 0;
+        for (const auto& rec : m_records) stringsSize += rec.nameLength;
+        for (const auto& who : m_who) stringsSize += who.size();
+
+        ofs.write(magic, sizeof(magic));
+        putU32(ofs, version);
+        putU32(ofs, (uint32_t)m_who.size());
+        putU64(ofs, (uint64_t)m_records.size());
+        putU64(ofs, stringsSize);
+
+        // the names are written in the order of the records, followed by the photographers
+        uint64_t offset = 0;
+
+        for (const auto& rec : m_records)
+        {
+            putU64(ofs, rec.timestamp);
+            putU64(ofs, rec.size);
+            putU32(ofs, (uint32_t)offset);
+            putU32(ofs, rec.nameLength);
+            putU32(ofs, rec.who);
+            putU32(ofs, 0);
+
+            offset += rec.nameLength;
+        }
+
+        for (const auto& who : m_who)
+        {
+            putU32(ofs, (uint32_t)offset);
+            putU32(ofs, (uint32_t)who.size());
+
+            offset += who.size();
+        }
+
+        for (const auto& rec : m_records)
+        {
+            const auto n = name(rec);
+            ofs.write(n.data(), n.size());
+        }
+
+        for (const auto& who : m_who) ofs.write(who.data(), who.size());
+
+        ofs.flush();
+
+        return ofs.good();
+    }
+
+    bool Builder::writeCsv(const fs::path& file) const
+    {
+        std::ofstream ofs(file, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!ofs.good()) return false;
+
+        ofs << "timestamp,photographer,name,size\n";
+
+        for (const auto& rec : m_records)
+        {
+            ofs << app::formatTimestamp(rec.timestamp) << ',';
+            ofs << csvField(m_who[rec.who]) << ',';
+            ofs << csvField(std::string(name(rec))) << ',';
+            ofs << rec.size << '\n';
+        }
+
+        ofs.flush();
+
+        return ofs.good();
+    }
+
+    // writes to a temporary file first, so that the index is never left half written
+    bool replaceFile(const fs::path& file, const std::function<bool(const fs::path&)>& write)
+    {
+        fs::path tmp = file;
+        tmp += ".tmp";
+
+        bool r = write(tmp);
+
+        std::error_code ec;
+
+        if (r)
+        {
+            fs::rename(tmp, file, ec);
+            if (ec) r = false;
+        }
+
+        if (!r) fs::remove(tmp, ec);
+
+        return r;
+    }
+}
+
+
+
+app::TimelineIndex::TimelineIndex()
+    : m_nRecords(0), m_nWho(0), m_records(nullptr), m_who(nullptr), m_strings(nullptr), m_stringsSize(0)
+{}
+
+bool app::TimelineIndex::open(const std::string& file)
+{
+    m_nRecords = 0;
+    m_nWho = 0;
+
+    if (!m_file.open(file)) return false;
+
+    const uint8_t* const p = m_file.data();
+    const size_t size = m_file.size();
+
+    if ((size < headerSize) || (std::memcmp(p, magic, sizeof(magic)) != 0) || (getU32(p + 8) != version)) return false;
+
+    const uint64_t nWho = getU32(p + 12);
+    const uint64_t nRecords = getU64(p + 16);
+    const uint64_t stringsSize = getU64(p + 24);
+
+    // checked step by step, so that corrupt sizes can't overflow
+    if ((nRecords > (size / recordSize)) || (stringsSize > size)) return false;
+    if ((headerSize + (nRecords * recordSize) + (nWho * whoSize) + stringsSize) != size) return false;
+
+    m_nRecords = (size_t)nRecords;
+    m_nWho = (size_t)nWho;
+    m_records = p + headerSize;
+    m_who = m_records + (m_nRecords * recordSize);
+    m_strings = m_who + (m_nWho * whoSize);
+    m_stringsSize = (size_t)stringsSize;
+
+    return true;
+}
+
+uint64_t app::TimelineIndex::timestamp(size_t idx) const
+{
+    return getU64(m_records + (idx * recordSize));
+}
+
+app::TimelineRecord app::TimelineIndex::record(size_t idx) const
+{
+    const uint8_t* const p = m_records + (idx * recordSize);
+
+    TimelineRecord r;
+    r.timestamp = getU64(p);
+    r.size = getU64(p + 8);
+    r.name = string(getU32(p + 16), getU32(p + 20));
+    r.who = who(getU32(p + 24));
+
+    return r;
+}
+
+size_t app::TimelineIndex::lowerBound(uint64_t ts) const
+{
+    size_t first = 0;
+    size_t count = m_nRecords;
+
+    while (count > 0)
+    {
+        const size_t step = count / 2;
+        const size_t i = first + step;
+
+        if (timestamp(i) < ts)
+        {
+            first = i + 1;
+            count -= step + 1;
+        }
+        else count = step;
+    }
+
+    return first;
+}
+
+std::vector<app::TimelineRecord> app::TimelineIndex::query(uint64_t from, uint64_t to, const std::string& who) const
+{
+    std::vector<TimelineRecord> r;
+
+    uint32_t whoIdx = 0;
+
+    if (!who.empty())
+    {
+        bool found = false;
+
+        for (size_t i = 0; (i < m_nWho) && !found; ++i)
+        {
+            if (this->who((uint32_t)i) == who)
+            {
+                whoIdx = (uint32_t)i;
+                found = true;
+            }
+        }
+
+        if (!found) return r;
+    }
+
+    for (size_t i = lowerBound(from); (i < m_nRecords) && (timestamp(i) <= to); ++i)
+    {
+        if (who.empty() || (getU32(m_records + (i * recordSize) + 24) == whoIdx)) r.push_back(record(i));
+    }
+
+    return r;
+}
+
+std::string app::TimelineIndex::string(uint32_t offset, uint32_t length) const
+{
+    if (((uint64_t)offset + (uint64_t)length) > (uint64_t)m_stringsSize) throw std::runtime_error("corrupt timeline index");
+
+    return std::string((const char*)(m_strings + offset), length);
+}
+
+std::string app::TimelineIndex::who(uint32_t idx) const
+{
+    if (idx >= m_nWho) throw std::runtime_error("corrupt timeline index");
+
+    const uint8_t* const p = m_who + ((size_t)idx * whoSize);
+
+    return string(getU32(p), getU32(p + 4));
+}
+
+
+
+bool app::updateTimeline(const app::Merger& merger, bool csv)
+{
+    const fs::path outDir = fs::u8path(merger.outDir());
+    const fs::path indexFile = outDir / timelineFileName;
+
+    Builder builder;
+    bool r;
+
+    try
+    {
+        std::error_code ec;
+
+        if (fs::exists(indexFile, ec))
+        {
+            TimelineIndex index;
+
+            if (!index.open(indexFile.u8string())) return false;
+
+            for (size_t i = 0; i < index.size(); ++i)
+            {
+                const auto rec = index.record(i);
+                builder.add(rec.timestamp, rec.size, rec.who, rec.name);
+            }
+        }
+
+        const auto& plan = merger.entries();
+        const auto& inDirs = merger.inDirs();
+        const auto layout = merger.options().layout;
+
+        for (size_t i = 0; i < plan.size(); ++i)
+        {
+            const auto& entry = plan[i];
+
+            if (entry.flags & Plan::flag_copied)
+            {
+                std::string name = layoutDir(layout, plan.date(entry));
+                if (!name.empty()) name += '/';
+                name += plan.outFileName(entry);
+
+                builder.add(entry.timestamp, entry.size, inDirs[entry.inDirIdx].name, name);
+            }
+        }
+
+        builder.sort();
+
+        r = replaceFile(indexFile, [&builder](const fs::path& file) { return builder.write(file); });
+
+        if (r && csv) r = replaceFile(outDir / timelineCsvFileName, [&builder](const fs::path& file) { return builder.writeCsv(file); });
+    }
+    catch (const std::exception&)
+    {
+        r = false;
+    }
+
+    return r;
+}
+
+bool app::parseTimestamp(const std::string& str, char fill, uint64_t& timestamp)
+{
+    std::string digits;
+
+    for (const char c : str)
+    {
+        if ((c >= '0') && (c <= '9')) digits += c;
+        else if ((c != '-') && (c != ':') && (c != ' ') && (c != 'T')) return false;
+    }
+
+    if ((digits.length() < 4) || (digits.length() > 14) || ((digits.length() % 2) != 0)) return false;
+
+    digits.resize(14, fill);
+    timestamp = std::stoull(digits);
+
+    return true;
+}
+
+std::string app::formatTimestamp(uint64_t timestamp)
+{
+    const std::string ts = std::to_string(timestamp);
+
+    if (ts.length() != 14) return ts;
+
+    return ts.substr(0, 4) + '-' + ts.substr(4, 2) + '-' + ts.substr(6, 2) + ' ' + ts.substr(8, 2) + ':' + ts.substr(10, 2) + ':' + ts.substr(12, 2);
+}
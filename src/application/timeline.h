@@ -0,0 +1,92 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_APP_TIMELINE_H
+#define IG_APP_TIMELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "application/merger.h"
+#include "middleware/mappedfile.h"
+
+
+namespace app
+{
+    // Chronological index of the merged files, written to the OUTDIR.
+    //
+    // Binary format, all integers are little endian:
+    //   header         32 bytes, "PHODIMTL", uint32 version, uint32 number of photographers, uint64 number of records,
+    //                  uint64 size of the string table
+    //   records        32 bytes each, uint64 timestamp (YYYYMMDDhhmmss), uint64 file size, uint32 name offset,
+    //                  uint32 name length, uint32 photographer index, uint32 reserved
+    //   photographers  8 bytes each, uint32 offset, uint32 length
+    //   string table   UTF-8, not terminated
+    //
+    // The records are sorted by timestamp and name. The name is the path of the file relative to the OUTDIR with '/' as
+    // separator, the photographer is the INDIR name.
+    const char* const timelineFileName = ".phodime-index";
+    const char* const timelineCsvFileName = ".phodime-index.csv";
+
+    struct TimelineRecord
+    {
+        uint64_t timestamp; // YYYYMMDDhhmmss
+        uint64_t size;
+        std::string who;
+        std::string name;
+    };
+
+    // read access to the memory mapped index file
+    class TimelineIndex
+    {
+    public:
+        TimelineIndex();
+        virtual ~TimelineIndex() {}
+
+        // returns false if the file can't be read or is not a valid index
+        bool open(const std::string& file);
+
+        size_t size() const { return m_nRecords; }
+        uint64_t timestamp(size_t idx) const;
+
+        // throws std::runtime_error if the record is corrupt
+        app::TimelineRecord record(size_t idx) const;
+
+        // index of the first record with a timestamp not less than ts
+        size_t lowerBound(uint64_t ts) const;
+
+        // records with from <= timestamp <= to, of the photographer who (all if empty)
+        std::vector<app::TimelineRecord> query(uint64_t from, uint64_t to, const std::string& who = std::string()) const;
+
+    private:
+        util::MappedFile m_file;
+        size_t m_nRecords;
+        size_t m_nWho;
+        const uint8_t* m_records;
+        const uint8_t* m_who;
+        const uint8_t* m_strings;
+        size_t m_stringsSize;
+
+        std::string string(uint32_t offset, uint32_t length) const;
+        std::string who(uint32_t idx) const;
+    };
+
+    // Adds the files copied by the merger to the index of the OUTDIR, creates it if needed. If csv is set, the index is
+    // also written as CSV. Returns false on error, an existing but invalid index is not overwritten.
+    bool updateTimeline(const app::Merger& merger, bool csv);
+
+    // Parses "YYYY[MM[DD[hh[mm[ss]]]]]", the separators '-', ':', ' ' and 'T' are ignored. The missing digits are filled
+    // with fill ('0' for the begin of a range, '9' for the end). Returns false if the string is invalid.
+    bool parseTimestamp(const std::string& str, char fill, uint64_t& timestamp);
+
+    // YYYY-MM-DD hh:mm:ss
+    std::string formatTimestamp(uint64_t timestamp);
+}
+
+
+#endif // IG_APP_TIMELINE_H
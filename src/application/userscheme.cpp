@@ -0,0 +1,514 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "userscheme.h"
+
+#include <omw/string.h>
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // limits the memory of patterns with many {*} and {#}, the DFA of 20 ordinary schemes has a few hundred states
+    constexpr size_t maxStates = 0x10000;
+
+    struct Field
+    {
+        const char* name;
+        int pos;    // in YYYYMMDDhhmmss
+        int width;
+    };
+
+    const Field fields[] = {
+        { "YYYY", 0, 4 },
+        { "MM", 4, 2 },
+        { "DD", 6, 2 },
+        { "hh", 8, 2 },
+        { "mm", 10, 2 },
+        { "ss", 12, 2 },
+    };
+
+    // names of the built in schemes, see app::toString(const app::scheme_t&, const app::UserSchemes&)
+    const char* const reservedNames[] = { "unknown", "huawai", "samsung", "winphone" };
+
+    bool isDigit(char c) { return ((c >= '0') && (c <= '9')); }
+
+    bool isNameChar(char c)
+    {
+        return (((c >= 'A') && (c <= 'Z')) || ((c >= 'a') && (c <= 'z')) || isDigit(c) || (c == '-') || (c == '_'));
+    }
+
+    struct NfaState
+    {
+        std::vector<std::pair<std::pair<int, char>, uint32_t>> next; // ((ELEMENT, literal character), target)
+        size_t accept;
+    };
+}
+
+
+
+app::UserSchemes::UserSchemes()
+    : m_schemes(), m_class(), m_nClasses(0), m_next(), m_accept(), m_start(0)
+{}
+
+bool app::UserSchemes::load(const std::string& file, std::string& error)
+{
+    std::ifstream ifs(fs::u8path(file), std::ios::in | std::ios::binary);
+
+    if (!ifs.good())
+    {
+        error = "failed to open the file";
+        return false;
+    }
+
+    std::vector<Scheme> schemes;
+    std::string line;
+    size_t lineNumber = 0;
+
+    while (std::getline(ifs, line))
+    {
+        ++lineNumber;
+
+        if (!line.empty() && (line.back() == '\r')) line.pop_back();
+
+        const size_t first = line.find_first_not_of(" \t");
+        if ((first == std::string::npos) || (line[first] == '#')) continue;
+
+        Scheme scheme;
+
+        if (!parse(line, scheme, error))
+        {
+            error = "line " + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+
+        for (const auto& other : schemes)
+        {
+            if (omw::string(other.name).toLower_ascii() == omw::string(scheme.name).toLower_ascii())
+            {
+                error = "line " + std::to_string(lineNumber) + ": scheme \"" + scheme.name + "\" is already defined";
+                return false;
+            }
+        }
+
+        if (schemes.size() >= maxSchemes)
+        {
+            error = "line " + std::to_string(lineNumber) + ": more than " + std::to_string(maxSchemes) + " schemes";
+            return false;
+        }
+
+        schemes.push_back(scheme);
+    }
+
+    if (ifs.bad())
+    {
+        error = "failed to read the file";
+        return false;
+    }
+
+    if (!compile(schemes, error)) return false;
+
+    m_schemes = schemes;
+
+    return true;
+}
+
+size_t app::UserSchemes::match(const std::string_view& stem) const
+{
+    if (m_schemes.empty()) return npos;
+
+    uint32_t state = m_start;
+
+    for (const char c : stem)
+    {
+        state = m_next[(size_t)state * m_nClasses + m_class[(uint8_t)c]];
+        if (state == 0) return npos;
+    }
+
+    return m_accept[state];
+}
+
+bool app::UserSchemes::extract(size_t idx, const std::string_view& stem, app::UserSchemes::Match& m) const
+{
+    const Scheme& scheme = m_schemes[idx];
+    std::vector<std::pair<size_t, size_t>> captures(scheme.nCaptures); // (position, length)
+    std::string fields(14, '0');
+
+    if (!matchPattern(scheme.pattern, stem, captures, fields)) return false;
+
+    m.date = fields.substr(0, 8);
+    m.time = fields.substr(8, 6);
+    m.suffix.clear();
+
+    for (size_t i = 0; i < scheme.suffix.size(); ++i)
+    {
+        // validated by parse(), "{N}" with 1 <= N <= nCaptures
+        if (scheme.suffix[i] == '{')
+        {
+            const auto& capture = captures[scheme.suffix[i + 1] - '1'];
+            m.suffix.append(stem.substr(capture.first, capture.second));
+            i += 2;
+        }
+        else m.suffix += scheme.suffix[i];
+    }
+
+    return true;
+}
+
+bool app::UserSchemes::parse(const std::string& line, app::UserSchemes::Scheme& scheme, std::string& error)
+{
+    std::istringstream iss(line);
+    std::string pattern, rest;
+
+    iss >> scheme.name >> pattern;
+    if (!(iss >> scheme.suffix)) scheme.suffix.clear();
+
+    if (pattern.empty())
+    {
+        error = "expected \"NAME PATTERN [SUFFIX]\"";
+        return false;
+    }
+
+    if (iss >> rest)
+    {
+        error = "unexpected \"" + rest + "\"";
+        return false;
+    }
+
+    if (!std::all_of(scheme.name.begin(), scheme.name.end(), isNameChar))
+    {
+        error = "invalid name \"" + scheme.name + "\", allowed are A-Z a-z 0-9 - _";
+        return false;
+    }
+
+    for (const char* const reserved : reservedNames)
+    {
+        if (omw::string(scheme.name).toLower_ascii() == reserved)
+        {
+            error = "\"" + scheme.name + "\" is the name of a built in scheme";
+            return false;
+        }
+    }
+
+    scheme.pattern.clear();
+    scheme.nCaptures = 0;
+
+    bool seen[sizeof(fields) / sizeof(fields[0])] = {};
+
+    for (size_t i = 0; i < pattern.size();)
+    {
+        if (pattern[i] != '{')
+        {
+            scheme.pattern.push_back(Element{ ELEMENT::literal, pattern[i], -1, 0 });
+            ++i;
+            continue;
+        }
+
+        const size_t end = pattern.find('}', i);
+
+        if (end == std::string::npos)
+        {
+            error = "missing '}' in pattern";
+            return false;
+        }
+
+        const std::string name = pattern.substr(i + 1, end - i - 1);
+        size_t f = 0;
+        while ((f < (sizeof(fields) / sizeof(fields[0]))) && (name != fields[f].name)) ++f;
+
+        if (f < (sizeof(fields) / sizeof(fields[0])))
+        {
+            if (seen[f])
+            {
+                error = "{" + name + "} is more than once in the pattern";
+                return false;
+            }
+
+            for (int k = 0; k < fields[f].width; ++k) scheme.pattern.push_back(Element{ ELEMENT::digit, 0, fields[f].pos + k, 0 });
+            seen[f] = true;
+        }
+        else if (name == "d") scheme.pattern.push_back(Element{ ELEMENT::digit, 0, -1, 0 });
+        else if (name == "#") scheme.pattern.push_back(Element{ ELEMENT::digits, 0, -1, scheme.nCaptures++ });
+        else if (name == "*") scheme.pattern.push_back(Element{ ELEMENT::any, 0, -1, scheme.nCaptures++ });
+        else
+        {
+            error = "unknown field {" + name + "} in pattern";
+            return false;
+        }
+
+        i = end + 1;
+    }
+
+    for (size_t f = 0; f < (sizeof(fields) / sizeof(fields[0])); ++f)
+    {
+        if (!seen[f])
+        {
+            error = "{" + std::string(fields[f].name) + "} is missing in the pattern";
+            return false;
+        }
+    }
+
+    if (scheme.nCaptures > 9)
+    {
+        error = "more than 9 captures in the pattern";
+        return false;
+    }
+
+    for (size_t i = 0; i < scheme.suffix.size(); ++i)
+    {
+        const char c = scheme.suffix[i];
+
+        if ((c == '/') || (c == '\\') || (c == '}'))
+        {
+            error = std::string("invalid character '") + c + "' in suffix";
+            return false;
+        }
+
+        if (c == '{')
+        {
+            if (((i + 2) >= scheme.suffix.size()) || (scheme.suffix[i + 2] != '}') ||
+                (scheme.suffix[i + 1] < '1') || ((size_t)(scheme.suffix[i + 1] - '0') > scheme.nCaptures))
+            {
+                error = "invalid capture reference in suffix, the pattern has " + std::to_string(scheme.nCaptures) + " captures";
+                return false;
+            }
+
+            i += 2;
+        }
+    }
+
+    return true;
+}
+
+// Builds an NFA with one state per consumed character and self loops for {#} and {*}, then the DFA by subset
+// construction. The literal characters of the patterns get a character class each, the other digits and the other
+// characters one class each.
+bool app::UserSchemes::compile(const std::vector<app::UserSchemes::Scheme>& schemes, std::string& error)
+{
+    std::vector<NfaState> nfa;
+    std::vector<uint32_t> starts;
+
+    for (size_t i = 0; i < schemes.size(); ++i)
+    {
+        uint32_t s = (uint32_t)nfa.size();
+        nfa.push_back(NfaState{ {}, npos });
+        starts.push_back(s);
+
+        for (const auto& el : schemes[i].pattern)
+        {
+            const auto predicate = std::make_pair((int)(el.type == ELEMENT::digits ? ELEMENT::digit : el.type), el.c);
+
+            if (el.type == ELEMENT::any) nfa[s].next.push_back(std::make_pair(predicate, s));
+            else
+            {
+                const uint32_t t = (uint32_t)nfa.size();
+                nfa.push_back(NfaState{ {}, npos });
+                nfa[s].next.push_back(std::make_pair(predicate, t));
+                if (el.type == ELEMENT::digits) nfa[t].next.push_back(std::make_pair(predicate, t));
+                s = t;
+            }
+        }
+
+        nfa[s].accept = i;
+    }
+
+    std::array<uint16_t, 256> classOf;
+    std::vector<uint8_t> representative;
+    classOf.fill(0xFFFF);
+
+    for (const auto& scheme : schemes)
+    {
+        for (const auto& el : scheme.pattern)
+        {
+            if ((el.type == ELEMENT::literal) && (classOf[(uint8_t)el.c] == 0xFFFF))
+            {
+                classOf[(uint8_t)el.c] = (uint16_t)representative.size();
+                representative.push_back((uint8_t)el.c);
+            }
+        }
+    }
+
+    const uint16_t digitClass = (uint16_t)representative.size();
+    const uint16_t otherClass = digitClass + 1;
+    representative.push_back(0);
+    representative.push_back(0);
+
+    for (size_t b = 256; b-- > 0;)
+    {
+        if (classOf[b] == 0xFFFF)
+        {
+            classOf[b] = (isDigit((char)b) ? digitClass : otherClass);
+            representative[classOf[b]] = (uint8_t)b;
+        }
+    }
+
+    // the digit class is empty if all digits are literals, its transitions lead to the dead state then
+    bool digitClassUsed = false;
+    for (size_t b = '0'; b <= '9'; ++b) digitClassUsed = (digitClassUsed || (classOf[b] == digitClass));
+
+    const size_t nClasses = representative.size();
+    std::map<std::vector<uint32_t>, uint32_t> ids;
+    std::vector<std::vector<uint32_t>> sets;
+    std::vector<uint32_t> next;
+    std::vector<size_t> accept;
+
+    sets.push_back({});
+    ids[sets.back()] = 0;
+
+    std::sort(starts.begin(), starts.end());
+    ids[starts] = 1;
+    sets.push_back(starts);
+
+    for (size_t si = 0; si < sets.size(); ++si)
+    {
+        if (sets.size() > maxStates)
+        {
+            error = "the patterns are too complex, more than " + std::to_string(maxStates) + " DFA states";
+            return false;
+        }
+
+        const std::vector<uint32_t> set = sets[si];
+        size_t acc = npos;
+
+        for (const uint32_t s : set) acc = std::min(acc, nfa[s].accept);
+        accept.push_back(acc);
+
+        for (size_t cls = 0; cls < nClasses; ++cls)
+        {
+            const char c = (char)representative[cls];
+            std::vector<uint32_t> targets;
+
+            if ((cls != digitClass) || digitClassUsed)
+            {
+                for (const uint32_t s : set)
+                {
+                    for (const auto& transition : nfa[s].next)
+                    {
+                        const int type = transition.first.first;
+
+                        if ((type == (int)ELEMENT::any) ||
+                            ((type == (int)ELEMENT::digit) && isDigit(c)) ||
+                            ((type == (int)ELEMENT::literal) && (transition.first.second == c)))
+                        {
+                            targets.push_back(transition.second);
+                        }
+                    }
+                }
+            }
+
+            std::sort(targets.begin(), targets.end());
+            targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+            const auto it = ids.find(targets);
+            uint32_t id;
+
+            if (it != ids.end()) id = it->second;
+            else
+            {
+                id = (uint32_t)sets.size();
+                ids[targets] = id;
+                sets.push_back(targets);
+            }
+
+            next.push_back(id);
+        }
+    }
+
+    m_class = classOf;
+    m_nClasses = nClasses;
+    m_next = std::move(next);
+    m_accept = std::move(accept);
+    m_start = 1;
+
+    return true;
+}
+
+// ok[ei * (n + 1) + si] tells whether pattern[ei...] matches stem[si...], it's filled from the end. The captures are then
+// taken in the order of the pattern, each as long as the rest still matches, in time proportional to the pattern
+// length times the stem length.
+bool app::UserSchemes::matchPattern(const std::vector<app::UserSchemes::Element>& pattern, const std::string_view& stem, std::vector<std::pair<size_t, size_t>>& captures, std::string& fields)
+{
+    const size_t n = stem.size();
+    const size_t w = n + 1;
+    std::vector<uint8_t> ok((pattern.size() + 1) * w, 0);
+
+    ok[pattern.size() * w + n] = 1;
+
+    for (size_t ei = pattern.size(); ei-- > 0;)
+    {
+        const Element& el = pattern[ei];
+        const uint8_t* const rest = ok.data() + (ei + 1) * w;
+        uint8_t* const row = ok.data() + ei * w;
+
+        for (size_t si = w; si-- > 0;)
+        {
+            const bool more = (si < n);
+
+            switch (el.type)
+            {
+            case ELEMENT::literal:
+                row[si] = (more && (stem[si] == el.c) && rest[si + 1]);
+                break;
+
+            case ELEMENT::digit:
+                row[si] = (more && isDigit(stem[si]) && rest[si + 1]);
+                break;
+
+            case ELEMENT::digits:
+                row[si] = (more && isDigit(stem[si]) && (rest[si + 1] || row[si + 1]));
+                break;
+
+            case ELEMENT::any:
+                row[si] = (rest[si] || (more && row[si + 1]));
+                break;
+
+            default:
+                throw (int)(__LINE__);
+                break;
+            }
+        }
+    }
+
+    if (!ok[0]) return false;
+
+    size_t si = 0;
+
+    for (size_t ei = 0; ei < pattern.size(); ++ei)
+    {
+        const Element& el = pattern[ei];
+
+        if ((el.type == ELEMENT::digits) || (el.type == ELEMENT::any))
+        {
+            // longest first, ok[] guarantees a length (at least 1 for digits)
+            size_t len = 0;
+            while (((si + len) < n) && ((el.type == ELEMENT::any) || isDigit(stem[si + len]))) ++len;
+            while (!ok[(ei + 1) * w + si + len]) --len;
+
+            captures[el.capture] = std::make_pair(si, len);
+            si += len;
+        }
+        else
+        {
+            if (el.pos >= 0) fields[el.pos] = stem[si];
+            ++si;
+        }
+    }
+
+    return true;
+}
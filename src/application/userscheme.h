@@ -0,0 +1,107 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_APP_USERSCHEME_H
+#define IG_APP_USERSCHEME_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace app
+{
+    // File name schemes of a scheme file (see the readme). Each line defines a scheme:
+    //   NAME PATTERN [SUFFIX]
+    //
+    // The pattern has to match the whole stem of a file name. Besides literal characters it contains:
+    //   {YYYY} {MM} {DD} {hh} {mm} {ss}   date and time digits, each exactly once
+    //   {d}                               a digit
+    //   {#}                               one or more digits, captured
+    //   {*}                               any characters, also none, captured
+    //
+    // The output file stem is "YYYYMMDD-hhmmss-INDIRNAME" followed by the suffix, in which {1} to {9} are replaced by
+    // the captures in the order of the pattern. Empty lines and lines starting with '#' are ignored.
+    //
+    // All patterns are compiled into one DFA, a stem is classified in one pass regardless of the number of schemes.
+    class UserSchemes
+    {
+    public:
+        static constexpr size_t npos = (size_t)(-1);
+
+        // SCHEME::user + i has to stay in the range of values of app::scheme_t (up to 0x1FF)
+        static constexpr size_t maxSchemes = 0x100;
+
+        struct Match
+        {
+            std::string date;   // YYYYMMDD
+            std::string time;   // hhmmss
+            std::string suffix;
+        };
+
+    public:
+        UserSchemes();
+        virtual ~UserSchemes() {}
+
+        // Replaces the schemes by the ones of the file. Returns false and writes the reason to error if the file can't
+        // be read or is invalid, the schemes are left unchanged then.
+        bool load(const std::string& file, std::string& error);
+
+        size_t size() const { return m_schemes.size(); }
+        const std::string& name(size_t idx) const { return m_schemes[idx].name; }
+
+        // index of the first scheme of the file matching the stem, npos if none
+        size_t match(const std::string_view& stem) const;
+
+        // Date, time and suffix of a stem. Returns false if the stem doesn't match the scheme.
+        bool extract(size_t idx, const std::string_view& stem, app::UserSchemes::Match& m) const;
+
+    private:
+        enum class ELEMENT
+        {
+            literal,
+            digit,  // also the date and time digits
+            digits,
+            any
+        };
+
+        struct Element
+        {
+            ELEMENT type;
+            char c;         // literal character
+            int pos;        // index in YYYYMMDDhhmmss of a date or time digit, -1 otherwise
+            size_t capture; // capture index of digits and any
+        };
+
+        struct Scheme
+        {
+            std::string name;
+            std::vector<Element> pattern;
+            size_t nCaptures;
+            std::string suffix; // template
+        };
+
+        std::vector<Scheme> m_schemes;
+
+        // DFA, state 0 is the dead state
+        std::array<uint16_t, 256> m_class;  // byte to character class
+        size_t m_nClasses;
+        std::vector<uint32_t> m_next;       // [state * m_nClasses + class]
+        std::vector<size_t> m_accept;       // scheme index of the state, npos if not accepting
+        uint32_t m_start;
+
+        static bool parse(const std::string& line, app::UserSchemes::Scheme& scheme, std::string& error);
+        static bool matchPattern(const std::vector<app::UserSchemes::Element>& pattern, const std::string_view& stem, std::vector<std::pair<size_t, size_t>>& captures, std::string& fields);
+        bool compile(const std::vector<app::UserSchemes::Scheme>& schemes, std::string& error);
+    };
+}
+
+
+#endif // IG_APP_USERSCHEME_H
@@ -12,6 +12,8 @@ copyright       GNU GPLv3 - Copyright (c) 2023 Oliver Blaser
 
 #include "application/cliarg.h"
 #include "application/processor.h"
+#include "application/scheme.h"
+#include "application/timeline.h"
 #include "project.h"
 
 #include <omw/cli.h>
@@ -25,24 +27,51 @@ using std::setw;
 namespace
 {
     const std::string usageString = std::string(prj::exeName) + " [options] INDIR [INDIR [INDIR [...]]] OUTDIR";
+    const std::string queryUsageString = std::string(prj::exeName) + " " + argstr::cmdQuery + " [options] OUTDIR";
 
     void printHelp()
     {
-        constexpr int lw = 18;
+        constexpr int lw = 24;
 
         cout << prj::appName << endl;
         cout << endl;
         cout << "Usage:" << endl;
         cout << "  " << usageString << endl;
+        cout << "  " << queryUsageString << endl;
         cout << endl;
         cout << "Options:" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::deviceJobs + "=N" << "concurrent copies per source device (default 1)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::durability + "=MODE" << "flush the copied files to the device: none (default), file, batch or end" << endl;
         cout << std::left << setw(lw) << std::string("  ") + argstr::force << "force overwriting output files" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::index << "add the copied files to the timeline index of OUTDIR" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::indexCsv << "same as " << argstr::index << ", also write the index as CSV" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::inDirsFrom + "=FILE" << "read more INDIRs from FILE (- for stdin), one per line or NUL separated" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::layout + "=LAYOUT" << "OUTDIR layout: flat (default), year, year/month or year/month/day" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::maxBandwidth + "=RATE" << "limit the bytes per second read and written, e.g. 20M (K, M, G are powers of 1024)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::maxIops + "=N" << "limit the I/O operations per second (each file and each 1MiB chunk count as one)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::memLimit + "=SIZE" << "plan in sorted runs on disk, using about SIZE bytes of memory (e.g. 512M)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::nearDedup << "don't copy JPEGs which look like an already copied one (compares the EXIF thumbnails)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::noSchemeCache << "don't read or write the cached schemes of the INDIRs" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::outputArchive + "=FILE" << "write a .tar or uncompressed .zip instead of an OUTDIR, all other arguments are INDIRs" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::physicalOrder << "copy the files in their order on the source disk, for hard disks (Linux)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::preserve + "=LIST" << "keep file attributes: times, mode (comma separated, mode is always kept)" << endl;
         cout << std::left << setw(lw) << std::string("  ") + argstr::quiet << "quiet" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::report + "=FILE" << "write a JSON report of the run to FILE" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::schemes + "=FILE" << "read additional file name schemes from FILE, see the readme" << endl;
         cout << std::left << setw(lw) << std::string("  ") + argstr::verbose << "verbose" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::verify << "re-read and compare the copied files, write their XXH64 to OUTDIR/" << app::manifestFileName << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::verifyNoCache << "same as " << argstr::verify << ", read back from the device instead of the page cache (Linux)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::watch << "keep running and merge new files of the INDIRs (Linux only)" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::writeJobs + "=N" << "max concurrent copies to OUTDIR (default 4)" << endl;
         cout << std::left << setw(lw) << std::string("  ") + argstr::noColor << "monochrome console output" << endl;
         cout << std::left << setw(lw) << std::string("  ") + argstr::help + std::string(", ") + argstr::help_alt << "prints this help text" << endl;
         cout << std::left << setw(lw) << std::string("  ") + argstr::version << "prints version info" << endl;
         cout << endl;
+        cout << "Query options (range of the timeline index, TIME is YYYY[MM[DD[hh[mm[ss]]]]]):" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::from + "=TIME" << "first timestamp" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::to + "=TIME" << "last timestamp" << endl;
+        cout << std::left << setw(lw) << std::string("  ") + argstr::who + "=NAME" << "files of this photographer (INDIR name) only" << endl;
+        cout << endl;
         cout << "Website: <" << prj::website << ">" << endl;
     }
 
@@ -123,7 +152,8 @@ int main(int argc, char** argv)
     }
 
 #ifndef PRJ_DEBUG
-    if (prj::version.isPreRelease()) cout << omw::fgBrightMagenta << "pre-release v" << prj::version.toString() << omw::defaultForeColor << endl;
+    // the query output is meant to be processed by other tools
+    if (prj::version.isPreRelease() && !args.isQuery()) cout << omw::fgBrightMagenta << "pre-release v" << prj::version.toString() << omw::defaultForeColor << endl;
 #endif
 
 #if defined(PRJ_DEBUG) && 1
@@ -136,13 +166,137 @@ int main(int argc, char** argv)
     {
         if (args.containsHelp()) printHelp();
         else if (args.containsVersion()) printVersion();
+        else if (args.isQuery())
+        {
+            uint64_t from = 0;
+            uint64_t to = 99999999999999;
+
+            r = 1;
+
+            if (args.inDirs().size() != 1)
+            {
+                cout << prj::exeName << ": " << argstr::cmdQuery << " takes exactly one OUTDIR" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsFrom() && !app::parseTimestamp(args.from(), '0', from))
+            {
+                cout << prj::exeName << ": invalid argument '" << args.from() << "' for '" << argstr::from << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsTo() && !app::parseTimestamp(args.to(), '9', to))
+            {
+                cout << prj::exeName << ": invalid argument '" << args.to() << "' for '" << argstr::to << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else r = app::query(args.outDir(), from, to, args.who());
+        }
         else
         {
-            const auto flags = app::Flags(args.containsForce(),
+            auto flags = app::Flags(args.containsForce(),
                 args.containsQuiet(),
                 args.containsVerbose());
 
-            r = app::process(args.inDirs(), args.outDir(), flags);
+            flags.watch = args.containsWatch();
+            if (args.containsReport()) flags.report = args.report();
+            flags.index = args.containsIndex();
+            flags.indexCsv = args.containsIndexCsv();
+            flags.verify = args.containsVerify();
+            flags.verifyNoCache = args.containsVerifyNoCache();
+            flags.nearDedup = args.containsNearDedup();
+            flags.physicalOrder = args.containsPhysicalOrder();
+            flags.schemeCache = !args.containsNoSchemeCache();
+
+            if (args.containsLayout() && !app::parseLayout(args.layout(), flags.layout))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.layout() << "' for '" << argstr::layout << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsPreserve() && !app::parsePreserve(args.preserve(), flags.preserveTimes))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.preserve() << "' for '" << argstr::preserve << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsDeviceJobs() && !app::parseJobs(args.deviceJobs(), flags.deviceJobs))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.deviceJobs() << "' for '" << argstr::deviceJobs << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsDurability() && !app::parseDurability(args.durability(), flags.durability))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.durability() << "' for '" << argstr::durability << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsWriteJobs() && !app::parseJobs(args.writeJobs(), flags.writeJobs))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.writeJobs() << "' for '" << argstr::writeJobs << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsMaxBandwidth() && !app::parseRate(args.maxBandwidth(), flags.maxBandwidth))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.maxBandwidth() << "' for '" << argstr::maxBandwidth << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsMaxIops() && !app::parseRate(args.maxIops(), flags.maxIops))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.maxIops() << "' for '" << argstr::maxIops << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsMemLimit() && !app::parseSize(args.memLimit(), flags.memLimit))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.memLimit() << "' for '" << argstr::memLimit << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsOutputArchive() && !app::parseOutputArchive(args.outputArchive(), flags.output))
+            {
+                r = 1;
+                cout << prj::exeName << ": invalid argument '" << args.outputArchive() << "' for '" << argstr::outputArchive << "', the file has to end with .tar or .zip" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsOutputArchive() && (flags.watch || flags.index || flags.verify || flags.physicalOrder))
+            {
+                r = 1;
+                const char* const other = (flags.watch ? argstr::watch : (flags.index ? argstr::index : (flags.verify ? argstr::verify : argstr::physicalOrder)));
+                cout << prj::exeName << ": '" << argstr::outputArchive << "' can't be combined with '" << other << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else if (args.containsMemLimit() && (flags.watch || flags.index || flags.nearDedup))
+            {
+                r = 1;
+                const char* const other = (flags.watch ? argstr::watch : (flags.index ? argstr::index : argstr::nearDedup));
+                cout << prj::exeName << ": '" << argstr::memLimit << "' can't be combined with '" << other << "'" << endl;
+                printUsageAndTryHelp();
+            }
+            else
+            {
+                std::vector<std::string> inDirs = args.inDirs();
+                std::string error;
+
+                if (args.containsInDirsFrom() && !app::readInDirList(args.inDirsFrom(), inDirs))
+                {
+                    r = 1;
+                    cout << prj::exeName << ": failed to read INDIR list '" << args.inDirsFrom() << "'" << endl;
+                }
+                else if (args.containsSchemes() && !flags.userSchemes.load(args.schemes(), error))
+                {
+                    r = 1;
+                    cout << prj::exeName << ": invalid scheme file '" << args.schemes() << "': " << error << endl;
+                }
+                else if (inDirs.empty())
+                {
+                    r = 1;
+                    cout << prj::exeName << ": no INDIRs" << endl;
+                    printUsageAndTryHelp();
+                }
+                else r = app::process(inDirs, args.outDir(), flags);
+            }
         }
     }
     else
@@ -154,6 +308,11 @@ int main(int argc, char** argv)
             cout << "No arguments." << endl;
             printUsageAndTryHelp();
         }
+        else if (args.options().valuePending())
+        {
+            cout << prj::exeName << ": option requires an argument: '" << args.options().back() << "'" << endl;
+            printUsageAndTryHelp();
+        }
         else if (!args.options().isValid())
         {
             cout << prj::exeName << ": unrecognized option: '" << args.options().unrecognized() << "'" << endl;
@@ -171,7 +330,8 @@ int main(int argc, char** argv)
     int dbg___getc_ = getc(stdin);
 #endif
 
-    cout << omw::normal << std::flush;
+    if (!args.isQuery()) cout << omw::normal;
+    cout << std::flush;
 
     return r;
 }
@@ -0,0 +1,1333 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "archive.h"
+#include "copy.h"
+#include "crc32.h"
+#include "inflate.h"
+#include "ratelimit.h"
+#include "xxhash.h"
+
+#include <omw/defs.h>
+#include <omw/string.h>
+
+#ifdef OMW_PLAT_UNIX
+#define ARCHIVE_POSIX (1)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr size_t bufferSize = 1024 * 1024;
+    constexpr size_t tarBlock = 512;
+    constexpr size_t tarRecord = 20 * tarBlock;
+    constexpr uint64_t tarMaxOctalSize = 077777777777ull; // 11 octal digits
+    constexpr uint32_t zipMax32 = 0xFFFFFFFFu;
+    constexpr uint16_t zipMax16 = 0xFFFFu;
+    constexpr uint16_t zipFlagUtf8 = 0x0800;
+
+    std::vector<char>& buffer()
+    {
+        thread_local std::vector<char> buffer(bufferSize);
+        return buffer;
+    }
+
+    std::error_code streamError() { return (errno != 0 ? std::error_code(errno, std::generic_category()) : std::make_error_code(std::errc::io_error)); }
+
+    // size, modification time (seconds since the epoch) and permissions of a regular file
+    bool fileInfo(const fs::path& file, uint64_t& size, int64_t& mtime, uint32_t& mode, std::error_code& ec)
+    {
+#ifdef OMW_PLAT_UNIX
+        struct stat st;
+
+        if (stat(file.c_str(), &st) != 0)
+        {
+            ec = std::error_code(errno, std::generic_category());
+            return false;
+        }
+
+        if (!S_ISREG(st.st_mode))
+        {
+            ec = std::make_error_code(std::errc::not_supported);
+            return false;
+        }
+
+        size = (uint64_t)st.st_size;
+        mtime = (int64_t)st.st_mtime;
+        mode = (uint32_t)(st.st_mode & 07777);
+#else
+        size = fs::file_size(file, ec);
+        if (ec) return false;
+
+        // there is no clock_cast in C++17, the offset between the clocks is taken from now
+        const auto ftime = fs::last_write_time(file, ec);
+        if (ec) return false;
+        const auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+        mtime = (int64_t)std::chrono::system_clock::to_time_t(sctp);
+
+        mode = (uint32_t)(fs::status(file, ec).permissions() & fs::perms::mask);
+        if (ec) return false;
+#endif
+
+        return true;
+    }
+
+    void dosTime(int64_t mtime, uint16_t& time, uint16_t& date)
+    {
+        const std::time_t t = (std::time_t)mtime;
+        std::tm tm;
+
+#if defined(OMW_PLAT_WIN)
+        const bool ok = (localtime_s(&tm, &t) == 0);
+#else
+        const bool ok = (localtime_r(&t, &tm) != nullptr);
+#endif
+
+        if (!ok || (tm.tm_year < 80))
+        {
+            time = 0;
+            date = (1 << 5) | 1; // 1980-01-01
+        }
+        else
+        {
+            time = (uint16_t)((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+            date = (uint16_t)(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+        }
+    }
+
+    void put16(std::string& buf, uint16_t value)
+    {
+        buf += (char)(value);
+        buf += (char)(value >> 8);
+    }
+
+    void put32(std::string& buf, uint32_t value)
+    {
+        put16(buf, (uint16_t)value);
+        put16(buf, (uint16_t)(value >> 16));
+    }
+
+    void put64(std::string& buf, uint64_t value)
+    {
+        put32(buf, (uint32_t)value);
+        put32(buf, (uint32_t)(value >> 32));
+    }
+
+    // zero padded octal number with a terminating NUL
+    void octal(char* field, size_t fieldSize, uint64_t value)
+    {
+        for (size_t i = fieldSize - 1; i > 0; --i)
+        {
+            field[i - 1] = (char)('0' + (value & 7));
+            value >>= 3;
+        }
+
+        field[fieldSize - 1] = 0;
+    }
+
+    // GNU base-256 encoding for numbers too large for the octal field
+    void base256(char* field, size_t fieldSize, uint64_t value)
+    {
+        for (size_t i = fieldSize - 1; i > 0; --i)
+        {
+            field[i] = (char)(value & 0xFF);
+            value >>= 8;
+        }
+
+        field[0] = (char)0x80;
+    }
+
+    // "LEN key=value\n", LEN includes itself
+    std::string paxRecord(const std::string& key, const std::string& value)
+    {
+        const size_t n = key.size() + value.size() + 3; // ' ', '=' and '\n'
+        size_t len = n + 1;
+        while (std::to_string(len).size() + n != len) ++len;
+
+        return std::to_string(len) + ' ' + key + '=' + value + '\n';
+    }
+
+    // splits the name into the ustar prefix and name fields, returns false if it doesn't fit
+    bool splitTarName(const std::string& name, std::string& prefix, std::string& base)
+    {
+        if (name.size() <= 100)
+        {
+            prefix.clear();
+            base = name;
+            return true;
+        }
+
+        for (size_t pos = name.rfind('/'); (pos != std::string::npos) && (pos > 0); pos = name.rfind('/', pos - 1))
+        {
+            if ((name.size() - pos - 1) > 100) break;
+
+            if (pos <= 155)
+            {
+                prefix = name.substr(0, pos);
+                base = name.substr(pos + 1);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void tarHeader(char* block, const std::string& prefix, const std::string& name, uint64_t size, int64_t mtime, uint32_t mode, char type)
+    {
+        std::memset(block, 0, tarBlock);
+
+        std::memcpy(block, name.data(), std::min<size_t>(name.size(), 100));
+        octal(block + 100, 8, mode & 07777);
+        octal(block + 108, 8, 0); // uid
+        octal(block + 116, 8, 0); // gid
+        if (size > tarMaxOctalSize) base256(block + 124, 12, size);
+        else octal(block + 124, 12, size);
+        octal(block + 136, 12, (uint64_t)(mtime < 0 ? 0 : mtime));
+        block[156] = type;
+        std::memcpy(block + 257, "ustar", 6);
+        std::memcpy(block + 263, "00", 2);
+        std::memcpy(block + 345, prefix.data(), std::min<size_t>(prefix.size(), 155));
+
+        std::memset(block + 148, ' ', 8);
+        uint32_t sum = 0;
+        for (size_t i = 0; i < tarBlock; ++i) sum += (uint8_t)block[i];
+        octal(block + 148, 7, sum);
+        block[155] = ' ';
+    }
+
+    uint16_t get16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+    uint32_t get32(const uint8_t* p) { return ((uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16)); }
+    uint64_t get64(const uint8_t* p) { return ((uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32)); }
+
+    std::error_code corrupt() { return std::make_error_code(std::errc::bad_message); }
+
+    // random access to the archive file, one instance per thread
+    class Input
+    {
+    public:
+        Input() : m_size(0) {}
+        virtual ~Input() { close(); }
+
+        Input(const Input& other) = delete;
+        Input& operator=(const Input& other) = delete;
+
+        bool open(const fs::path& file, std::error_code& ec);
+        void close();
+        uint64_t size() const { return m_size; }
+
+        // reads exactly size bytes, a short read is reported as a corrupt archive
+        bool readAt(uint64_t offset, void* data, size_t size, std::error_code& ec);
+
+#ifdef ARCHIVE_POSIX
+        int fd() const { return m_fd; }
+
+    private:
+        int m_fd = -1;
+#else
+    private:
+        std::ifstream m_ifs;
+#endif
+        uint64_t m_size;
+    };
+
+    bool Input::open(const fs::path& file, std::error_code& ec)
+    {
+#ifdef ARCHIVE_POSIX
+        m_fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+        struct stat st;
+
+        if (m_fd < 0) ec = std::error_code(errno, std::generic_category());
+        else if (fstat(m_fd, &st) != 0) ec = std::error_code(errno, std::generic_category());
+        else if (!S_ISREG(st.st_mode)) ec = std::make_error_code(std::errc::not_supported);
+        else m_size = (uint64_t)st.st_size;
+#else
+        m_size = fs::file_size(file, ec);
+
+        if (!ec)
+        {
+            errno = 0;
+            m_ifs.open(file, std::ios::in | std::ios::binary);
+            if (!m_ifs.is_open()) ec = streamError();
+        }
+#endif
+
+        if (ec) close();
+
+        return !ec;
+    }
+
+    void Input::close()
+    {
+#ifdef ARCHIVE_POSIX
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+#else
+        if (m_ifs.is_open()) m_ifs.close();
+#endif
+    }
+
+    bool Input::readAt(uint64_t offset, void* data, size_t size, std::error_code& ec)
+    {
+        if ((offset > m_size) || (size > (m_size - offset)))
+        {
+            ec = corrupt();
+            return false;
+        }
+
+#ifdef ARCHIVE_POSIX
+        char* p = (char*)data;
+
+        while (size > 0)
+        {
+            const ssize_t n = ::pread(m_fd, p, size, (off_t)offset);
+
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                ec = std::error_code(errno, std::generic_category());
+                return false;
+            }
+            else if (n == 0)
+            {
+                ec = corrupt();
+                return false;
+            }
+
+            p += n;
+            size -= (size_t)n;
+            offset += (uint64_t)n;
+        }
+#else
+        m_ifs.clear();
+        m_ifs.seekg((std::streamoff)offset);
+        m_ifs.read((char*)data, (std::streamsize)size);
+
+        if ((size_t)m_ifs.gcount() != size)
+        {
+            ec = (m_ifs.bad() ? std::make_error_code(std::errc::io_error) : corrupt());
+            return false;
+        }
+#endif
+
+        return true;
+    }
+
+    // "./dir/file" and "/dir/file" are listed as "dir/file"
+    std::string memberName(std::string name)
+    {
+        size_t pos = 0;
+
+        while (pos < name.size())
+        {
+            if (name[pos] == '/') ++pos;
+            else if (name.compare(pos, 2, "./") == 0) pos += 2;
+            else break;
+        }
+
+        return name.substr(pos);
+    }
+
+    // octal, or GNU base-256 if the first byte has the high bit set
+    uint64_t tarNumber(const char* field, size_t fieldSize)
+    {
+        uint64_t r = 0;
+
+        if ((uint8_t)field[0] & 0x80)
+        {
+            for (size_t i = 1; i < fieldSize; ++i) r = (r << 8) | (uint8_t)field[i];
+        }
+        else
+        {
+            size_t i = 0;
+            while ((i < fieldSize) && ((field[i] == ' ') || (field[i] == 0))) ++i;
+            while ((i < fieldSize) && (field[i] >= '0') && (field[i] <= '7')) r = (r << 3) | (uint64_t)(field[i++] - '0');
+        }
+
+        return r;
+    }
+
+    std::string tarString(const char* field, size_t fieldSize) { return std::string(field, strnlen(field, fieldSize)); }
+
+    struct PaxHeader
+    {
+        std::string path;
+        bool hasSize = false;
+        uint64_t size = 0;
+        bool hasMtime = false;
+        int64_t mtime = 0;
+    };
+
+    // "LEN key=value\n" records, unknown keys are ignored
+    bool parsePax(const std::string& data, PaxHeader& pax)
+    {
+        size_t pos = 0;
+
+        while (pos < data.size())
+        {
+            const size_t space = data.find(' ', pos);
+            if (space == std::string::npos) return false;
+
+            const size_t len = (size_t)std::strtoull(data.c_str() + pos, nullptr, 10);
+            if ((len <= (space - pos)) || (len > (data.size() - pos))) return false;
+
+            const std::string record = data.substr(space + 1, pos + len - space - 2); // without the '\n'
+            const size_t eq = record.find('=');
+
+            if (eq != std::string::npos)
+            {
+                const std::string key = record.substr(0, eq);
+                const std::string value = record.substr(eq + 1);
+
+                if (key == "path") pax.path = value;
+                else if (key == "size")
+                {
+                    pax.hasSize = true;
+                    pax.size = std::strtoull(value.c_str(), nullptr, 10);
+                }
+                else if (key == "mtime")
+                {
+                    pax.hasMtime = true;
+                    pax.mtime = std::strtoll(value.c_str(), nullptr, 10);
+                }
+            }
+
+            pos += len;
+        }
+
+        return true;
+    }
+
+    bool readTar(Input& in, std::vector<util::ArchiveReader::Member>& members, std::error_code& ec)
+    {
+        char block[tarBlock];
+        uint64_t pos = 0;
+        PaxHeader pax;
+        std::string longName;
+
+        while ((pos + tarBlock) <= in.size())
+        {
+            if (!in.readAt(pos, block, tarBlock, ec)) return false;
+
+            if (std::all_of(block, block + tarBlock, [](char c) { return (c == 0); })) break;
+
+            uint32_t sum = 0;
+            for (size_t i = 0; i < tarBlock; ++i) sum += ((i >= 148) && (i < 156) ? (uint32_t)' ' : (uint32_t)(uint8_t)block[i]);
+
+            if (sum != tarNumber(block + 148, 8))
+            {
+                ec = corrupt();
+                return false;
+            }
+
+            const char type = block[156];
+            const uint64_t headerSize = tarNumber(block + 124, 12);
+            const uint64_t data = pos + tarBlock;
+            uint64_t dataSize = headerSize; // the size of a regular file may be set by the pax header
+
+            if (headerSize > (in.size() - data))
+            {
+                ec = corrupt();
+                return false;
+            }
+
+            if ((type == 'x') || (type == 'L'))
+            {
+                // belongs to the next header, there is no reason for it to be large
+                if (headerSize > bufferSize)
+                {
+                    ec = corrupt();
+                    return false;
+                }
+
+                std::string tmp((size_t)headerSize, 0);
+                if (!in.readAt(data, tmp.data(), tmp.size(), ec)) return false;
+
+                if (type == 'L') longName = tarString(tmp.data(), tmp.size());
+                else if (!parsePax(tmp, pax))
+                {
+                    ec = corrupt();
+                    return false;
+                }
+            }
+            else
+            {
+                if ((type == '0') || (type == 0) || (type == '7'))
+                {
+                    util::ArchiveReader::Member m;
+
+                    if (!longName.empty()) m.name = longName;
+                    else if (!pax.path.empty()) m.name = pax.path;
+                    else
+                    {
+                        m.name = tarString(block, 100);
+
+                        const std::string prefix = tarString(block + 345, 155);
+                        if ((std::memcmp(block + 257, "ustar", 5) == 0) && !prefix.empty()) m.name = prefix + '/' + m.name;
+                    }
+
+                    m.name = memberName(m.name);
+                    m.offset = data;
+                    m.size = (pax.hasSize ? pax.size : headerSize);
+                    m.compressedSize = m.size;
+                    dataSize = m.size;
+                    m.mtime = (pax.hasMtime ? pax.mtime : (int64_t)tarNumber(block + 136, 12));
+                    m.mode = (uint32_t)(tarNumber(block + 100, 8) & 07777);
+                    m.crc = 0;
+                    m.method = 0;
+                    m.encrypted = false;
+
+                    if (m.size > (in.size() - data))
+                    {
+                        ec = corrupt();
+                        return false;
+                    }
+
+                    if (!m.name.empty() && (m.name.back() != '/')) members.push_back(m);
+                }
+
+                // the global pax header ('g') applies to all members, but none of its keys are used
+                if (type != 'g')
+                {
+                    pax = PaxHeader();
+                    longName.clear();
+                }
+            }
+
+            pos = data + ((dataSize + tarBlock - 1) / tarBlock) * tarBlock;
+        }
+
+        return true;
+    }
+
+    int64_t fromDosTime(uint16_t time, uint16_t date)
+    {
+        std::tm tm = {};
+        tm.tm_year = (date >> 9) + 80;
+        tm.tm_mon = ((date >> 5) & 0x0F) - 1;
+        tm.tm_mday = date & 0x1F;
+        tm.tm_hour = time >> 11;
+        tm.tm_min = (time >> 5) & 0x3F;
+        tm.tm_sec = (time & 0x1F) * 2;
+        tm.tm_isdst = -1;
+
+        return (int64_t)std::mktime(&tm);
+    }
+
+    bool readZip(Input& in, std::vector<util::ArchiveReader::Member>& members, std::error_code& ec)
+    {
+        constexpr size_t eocdSize = 22;
+
+        if (in.size() < eocdSize)
+        {
+            ec = corrupt();
+            return false;
+        }
+
+        // the end of central directory record is followed by a comment of up to 64KiB
+        const size_t tailSize = (size_t)std::min<uint64_t>(in.size(), eocdSize + zipMax16);
+        std::vector<uint8_t> tail(tailSize);
+        if (!in.readAt(in.size() - tailSize, tail.data(), tailSize, ec)) return false;
+
+        size_t eocd = tailSize - eocdSize + 1;
+
+        do { --eocd; } while ((eocd > 0) && (get32(tail.data() + eocd) != 0x06054B50));
+
+        if (get32(tail.data() + eocd) != 0x06054B50)
+        {
+            ec = corrupt();
+            return false;
+        }
+
+        uint64_t nEntries = get16(tail.data() + eocd + 10);
+        uint64_t cdSize = get32(tail.data() + eocd + 12);
+        uint64_t cdOffset = get32(tail.data() + eocd + 16);
+
+        if (((nEntries == zipMax16) || (cdSize == zipMax32) || (cdOffset == zipMax32)) && (eocd >= 20) && (get32(tail.data() + eocd - 20) == 0x07064B50))
+        {
+            uint8_t eocd64[56];
+            if (!in.readAt(get64(tail.data() + eocd - 20 + 8), eocd64, sizeof(eocd64), ec)) return false;
+
+            if (get32(eocd64) != 0x06064B50)
+            {
+                ec = corrupt();
+                return false;
+            }
+
+            nEntries = get64(eocd64 + 32);
+            cdSize = get64(eocd64 + 40);
+            cdOffset = get64(eocd64 + 48);
+        }
+
+        if ((cdOffset > in.size()) || (cdSize > (in.size() - cdOffset)))
+        {
+            ec = corrupt();
+            return false;
+        }
+
+        std::vector<uint8_t> cd((size_t)cdSize);
+        if (!in.readAt(cdOffset, cd.data(), cd.size(), ec)) return false;
+
+        members.reserve((size_t)std::min<uint64_t>(nEntries, cdSize / 46));
+
+        size_t pos = 0;
+
+        while (((pos + 46) <= cd.size()) && (get32(cd.data() + pos) == 0x02014B50))
+        {
+            const uint8_t* const p = cd.data() + pos;
+
+            const uint16_t madeBy = get16(p + 4);
+            const uint16_t flags = get16(p + 8);
+            const size_t nameLen = get16(p + 28);
+            const size_t extraLen = get16(p + 30);
+            const size_t commentLen = get16(p + 32);
+            const uint32_t attributes = get32(p + 38);
+
+            if ((pos + 46 + nameLen + extraLen + commentLen) > cd.size())
+            {
+                ec = corrupt();
+                return false;
+            }
+
+            util::ArchiveReader::Member m;
+            m.name = memberName(std::string((const char*)p + 46, nameLen));
+            m.offset = get32(p + 42);
+            m.size = get32(p + 24);
+            m.compressedSize = get32(p + 20);
+            m.mtime = fromDosTime(get16(p + 12), get16(p + 14));
+            m.mode = 0644;
+            m.crc = get32(p + 16);
+            m.method = get16(p + 10);
+            m.encrypted = ((flags & 0x0001) != 0);
+
+            bool regular = !m.name.empty() && (m.name.back() != '/');
+
+            // Unix attributes in the upper half
+            if ((madeBy >> 8) == 3)
+            {
+                const uint32_t mode = attributes >> 16;
+
+                if (((mode & 0170000) != 0) && ((mode & 0170000) != 0100000)) regular = false;
+                if ((mode & 07777) != 0) m.mode = mode & 07777;
+            }
+
+            const uint8_t* extra = p + 46 + nameLen;
+            const uint8_t* const extraEnd = extra + extraLen;
+
+            while ((extra + 4) <= extraEnd)
+            {
+                const uint16_t id = get16(extra);
+                const size_t len = get16(extra + 2);
+                const uint8_t* field = extra + 4;
+                const uint8_t* const fieldEnd = std::min(field + len, extraEnd);
+
+                if (id == 0x0001) // Zip64, only the fields which are 0xFFFFFFFF in the header, in this order
+                {
+                    if ((m.size == zipMax32) && ((field + 8) <= fieldEnd)) { m.size = get64(field); field += 8; }
+                    if ((m.compressedSize == zipMax32) && ((field + 8) <= fieldEnd)) { m.compressedSize = get64(field); field += 8; }
+                    if ((m.offset == zipMax32) && ((field + 8) <= fieldEnd)) { m.offset = get64(field); field += 8; }
+                }
+                else if ((id == 0x5455) && (len >= 5) && (field[0] & 0x01)) m.mtime = (int64_t)get32(field + 1); // extended timestamp
+
+                extra += 4 + len;
+            }
+
+            if (regular) members.push_back(m);
+
+            pos += 46 + nameLen + extraLen + commentLen;
+        }
+
+        return true;
+    }
+
+#ifdef ARCHIVE_POSIX
+    bool writeAll(int fd, const uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t n = ::write(fd, data, size);
+
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                return false;
+            }
+
+            data += n;
+            size -= (size_t)n;
+        }
+
+        return true;
+    }
+#endif
+}
+
+
+
+bool util::ArchiveReader::isArchive(const fs::path& file)
+{
+    const omw::string ext = file.extension().u8string();
+    const auto lower = ext.toLower_ascii();
+
+    return ((lower == ".tar") || (lower == ".zip"));
+}
+
+bool util::ArchiveReader::open(const fs::path& file, std::error_code& ec)
+{
+    ec.clear();
+
+    m_file = file;
+    m_zip = (omw::string(file.extension().u8string()).toLower_ascii() == ".zip");
+    m_members.clear();
+
+    Input in;
+    bool r = in.open(file, ec);
+
+    if (r) r = (m_zip ? readZip(in, m_members, ec) : readTar(in, m_members, ec));
+
+    if (r)
+    {
+        // stable, so that of duplicates the last one is at the end of its range
+        std::stable_sort(m_members.begin(), m_members.end(), [](const Member& a, const Member& b) { return (a.name < b.name); });
+
+        size_t n = 0;
+
+        for (size_t i = 0; i < m_members.size(); ++i)
+        {
+            const bool duplicate = ((i + 1) < m_members.size()) && (m_members[i].name == m_members[i + 1].name);
+            if (!duplicate)
+            {
+                if (n != i) m_members[n] = std::move(m_members[i]);
+                ++n;
+            }
+        }
+
+        m_members.resize(n);
+    }
+    else m_members.clear();
+
+    return r;
+}
+
+const util::ArchiveReader::Member* util::ArchiveReader::find(const std::string_view& name) const
+{
+    const auto it = std::lower_bound(m_members.begin(), m_members.end(), name, [](const Member& m, const std::string_view& n) { return (m.name < n); });
+
+    return (((it != m_members.end()) && (it->name == name)) ? &(*it) : nullptr);
+}
+
+bool util::ArchiveReader::read(const util::ArchiveReader::Member& member, const sink_t& sink, std::error_code& ec, util::RateLimiter* limiter) const
+{
+    ec.clear();
+
+    if (member.encrypted || ((member.method != 0) && (member.method != 8)))
+    {
+        ec = std::make_error_code(std::errc::not_supported);
+        return false;
+    }
+
+    Input in;
+    if (!in.open(m_file, ec)) return false;
+
+    // the local header of a zip member may differ from the central directory in the length of the extra field
+    uint64_t pos = member.offset;
+
+    if (m_zip)
+    {
+        uint8_t header[30];
+        if (!in.readAt(member.offset, header, sizeof(header), ec)) return false;
+
+        if (get32(header) != 0x04034B50)
+        {
+            ec = corrupt();
+            return false;
+        }
+
+        pos += sizeof(header) + get16(header + 26) + get16(header + 28);
+    }
+
+    const uint64_t end = pos + member.compressedSize;
+
+    if ((end < pos) || (end > in.size()))
+    {
+        ec = corrupt();
+        return false;
+    }
+
+    auto& buf = buffer();
+    CRC32 crc;
+    RateLimiter::Bucket bucket(limiter);
+    bool aborted = false;
+    uint64_t size = 0;
+
+    bucket.consume(0, 1);
+
+    const auto put = [&](const uint8_t* data, size_t n)
+    {
+        if (m_zip) crc.update(data, n);
+        size += (uint64_t)n;
+        aborted = !sink(data, n);
+        return !aborted;
+    };
+
+    if (member.method == 0)
+    {
+        while (!ec && !aborted && (pos < end))
+        {
+            const size_t n = (size_t)std::min<uint64_t>(buf.size(), end - pos);
+
+            if (in.readAt(pos, buf.data(), n, ec))
+            {
+                pos += n;
+                bucket.consume((uint64_t)n, 1);
+                put((const uint8_t*)buf.data(), n);
+            }
+        }
+    }
+    else
+    {
+        const Inflater::source_t source = [&](uint8_t* data, size_t n) -> size_t
+        {
+            n = (size_t)std::min<uint64_t>(n, end - pos);
+            if ((n == 0) || !in.readAt(pos, data, n, ec)) return 0;
+
+            pos += n;
+            bucket.consume((uint64_t)n, 1);
+
+            return n;
+        };
+
+        Inflater inflater;
+        if (!inflater.inflate(source, put) && !ec && !aborted) ec = corrupt();
+    }
+
+    if (!ec && !aborted && ((size != member.size) || (m_zip && (crc.digest() != member.crc)))) ec = corrupt();
+
+    return (!ec && !aborted);
+}
+
+bool util::ArchiveReader::extract(const util::ArchiveReader::Member& member, const fs::path& dst, const util::CopyOptions& options, uint64_t& hash, std::error_code& ec) const
+{
+    ec.clear();
+
+    XXH64 h;
+    std::error_code writeEc;
+
+#ifdef ARCHIVE_POSIX
+    const int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (options.overwrite ? O_TRUNC : O_EXCL), (mode_t)member.mode);
+    if (out < 0)
+    {
+        ec = std::error_code(errno, std::generic_category());
+        return false;
+    }
+
+    bool copied = false;
+
+#ifdef __linux__
+    // the data of a stored member is a plain range of the archive, the zip CRC can't be checked this way
+    if (!options.hash && (member.method == 0) && !member.encrypted)
+    {
+        Input in;
+        loff_t off = (loff_t)member.offset;
+
+        if (in.open(m_file, ec) && m_zip)
+        {
+            uint8_t header[30];
+
+            if (in.readAt(member.offset, header, sizeof(header), ec))
+            {
+                if (get32(header) != 0x04034B50) ec = corrupt();
+                else off += (loff_t)(sizeof(header) + get16(header + 26) + get16(header + 28));
+            }
+        }
+
+        RateLimiter::Bucket bucket(options.limiter);
+        uint64_t remaining = member.size;
+        bool first = true;
+
+        bucket.consume(0, 1);
+        copied = !ec;
+
+        // smaller chunks if limited, so that the limiter can keep the rate steady
+        const uint64_t chunkSize = (options.limiter ? bufferSize : bufferSize * 64);
+
+        while (!ec && (remaining > 0))
+        {
+            const ssize_t n = copy_file_range(in.fd(), &off, out, nullptr, (size_t)std::min(remaining, chunkSize), 0);
+
+            if (n > 0)
+            {
+                first = false;
+                remaining -= (uint64_t)n;
+                bucket.consume((uint64_t)n, 1);
+            }
+            else if (n == 0) ec = corrupt();
+            else if (errno == EINTR) continue;
+            else if (first && ((errno == EXDEV) || (errno == ENOSYS) || (errno == EINVAL) || (errno == EOPNOTSUPP)))
+            {
+                // not supported for these file systems, nothing has been copied yet
+                copied = false;
+                break;
+            }
+            else ec = std::error_code(errno, std::generic_category());
+        }
+    }
+#endif
+
+    if (!copied && !ec)
+    {
+        const auto sink = [&](const uint8_t* data, size_t size)
+        {
+            if (options.hash) h.update(data, size);
+            if (!writeAll(out, data, size)) writeEc = std::error_code(errno, std::generic_category());
+            return !writeEc;
+        };
+
+        read(member, sink, ec, options.limiter);
+    }
+
+    if (writeEc) ec = writeEc;
+
+    if (!ec && (fchmod(out, (mode_t)member.mode) != 0)) ec = std::error_code(errno, std::generic_category());
+
+    if (!ec && options.preserveTimes)
+    {
+        struct timespec times[2];
+        times[0].tv_sec = (time_t)member.mtime;
+        times[0].tv_nsec = 0;
+        times[1] = times[0];
+
+        if (futimens(out, times) != 0) ec = std::error_code(errno, std::generic_category());
+    }
+
+    if (!ec) syncDestination(out, options, ec);
+
+    if ((::close(out) != 0) && !ec) ec = std::error_code(errno, std::generic_category());
+#else
+    if (!options.overwrite && fs::exists(dst))
+    {
+        ec = std::make_error_code(std::errc::file_exists);
+        return false;
+    }
+
+    std::ofstream ofs(dst, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs.good()) ec = std::make_error_code(std::errc::io_error);
+
+    if (!ec)
+    {
+        const auto sink = [&](const uint8_t* data, size_t size)
+        {
+            if (options.hash) h.update(data, size);
+            if (!ofs.write((const char*)data, (std::streamsize)size).good()) writeEc = std::make_error_code(std::errc::io_error);
+            return !writeEc;
+        };
+
+        read(member, sink, ec, options.limiter);
+    }
+
+    ofs.close();
+    if (writeEc) ec = writeEc;
+    if (!ec && ofs.fail()) ec = std::make_error_code(std::errc::io_error);
+
+    if (!ec) fs::permissions(dst, (fs::perms)member.mode, ec);
+
+    // same clock offset as in fileInfo()
+    if (!ec && options.preserveTimes)
+    {
+        const auto t = std::chrono::system_clock::from_time_t((std::time_t)member.mtime) - std::chrono::system_clock::now() + fs::file_time_type::clock::now();
+        fs::last_write_time(dst, std::chrono::time_point_cast<fs::file_time_type::duration>(t), ec);
+    }
+#endif
+
+    if (ec)
+    {
+        std::error_code tmp;
+        fs::remove(dst, tmp);
+        return false;
+    }
+
+    hash = (options.hash ? h.digest() : 0);
+
+    return true;
+}
+
+bool util::ArchiveWriter::open(const fs::path& file, util::ArchiveWriter::format_t format, std::error_code& ec)
+{
+    ec.clear();
+
+    m_format = format;
+    m_file = file;
+    m_offset = 0;
+    m_zipEntries.clear();
+
+    errno = 0;
+    m_ofs.open(file, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_ofs.is_open()) ec = streamError();
+
+    return !ec;
+}
+
+bool util::ArchiveWriter::add(const fs::path& src, const std::string& name, uint64_t& size, std::error_code& ec, util::RateLimiter* limiter)
+{
+    ec.clear();
+    size = 0;
+
+    if (!isOpen())
+    {
+        ec = std::make_error_code(std::errc::bad_file_descriptor);
+        return false;
+    }
+
+    uint64_t srcSize;
+    int64_t mtime;
+    uint32_t mode;
+
+    if (!fileInfo(src, srcSize, mtime, mode, ec)) return false;
+
+    errno = 0;
+    std::ifstream ifs(src, std::ios::in | std::ios::binary);
+
+    if (!ifs.good())
+    {
+        ec = streamError();
+        return false;
+    }
+
+    const auto source = [&ifs](const ArchiveReader::sink_t& sink, std::error_code&)
+    {
+        auto& buf = buffer();
+        bool ok = true;
+
+        while (ok && ifs.good())
+        {
+            ifs.read(buf.data(), buf.size());
+            const auto n = ifs.gcount();
+
+            if (ifs.bad()) ok = false;
+            else if (n > 0) ok = sink((const uint8_t*)buf.data(), (size_t)n);
+        }
+
+        return ok;
+    };
+
+    return add(name, srcSize, mtime, mode, source, size, ec, limiter);
+}
+
+bool util::ArchiveWriter::add(const util::ArchiveReader& reader, const util::ArchiveReader::Member& member, const std::string& name, uint64_t& size, std::error_code& ec, util::RateLimiter* limiter)
+{
+    ec.clear();
+    size = 0;
+
+    if (!isOpen())
+    {
+        ec = std::make_error_code(std::errc::bad_file_descriptor);
+        return false;
+    }
+
+    const auto source = [&reader, &member](const ArchiveReader::sink_t& sink, std::error_code& ec) { return reader.read(member, sink, ec); };
+
+    return add(name, member.size, member.mtime, member.mode, source, size, ec, limiter);
+}
+
+bool util::ArchiveWriter::add(const std::string& name, uint64_t srcSize, int64_t mtime, uint32_t mode, const source_t& source, uint64_t& size, std::error_code& ec, util::RateLimiter* limiter)
+{
+    ZipEntry zipEntry;
+    bool ok;
+
+    if (m_format == zip)
+    {
+        zipEntry.name = name;
+        zipEntry.offset = m_offset;
+        zipEntry.size = srcSize;
+        zipEntry.crc = 0; // patched after the data
+        zipEntry.mode = mode;
+        dosTime(mtime, zipEntry.time, zipEntry.date);
+
+        const bool zip64 = (srcSize >= zipMax32);
+
+        std::string header;
+        put32(header, 0x04034B50);
+        put16(header, (zip64 ? 45 : 20));
+        put16(header, zipFlagUtf8);
+        put16(header, 0); // stored
+        put16(header, zipEntry.time);
+        put16(header, zipEntry.date);
+        put32(header, 0);
+        put32(header, (zip64 ? zipMax32 : (uint32_t)srcSize));
+        put32(header, (zip64 ? zipMax32 : (uint32_t)srcSize));
+        put16(header, (uint16_t)name.size());
+        put16(header, (zip64 ? 20 : 0));
+        header += name;
+
+        if (zip64)
+        {
+            put16(header, 0x0001);
+            put16(header, 16);
+            put64(header, srcSize);
+            put64(header, srcSize);
+        }
+
+        ok = write(header.data(), header.size());
+    }
+    else ok = writeTarHeader(name, srcSize, mtime, mode);
+
+    CRC32 crc;
+    RateLimiter::Bucket bucket(limiter);
+
+    bucket.consume(0, 1);
+
+    const auto sink = [this, &crc, &bucket, &size](const uint8_t* data, size_t n)
+    {
+        if (m_format == zip) crc.update(data, n);
+        if (!write(data, n)) return false;
+        size += (uint64_t)n;
+        bucket.consume((uint64_t)n, 1);
+        return true;
+    };
+
+    ok = ok && source(sink, ec);
+
+    // the size is in the header already, a file which has changed can't be stored
+    if (ok && (size != srcSize))
+    {
+        ok = false;
+        ec = std::make_error_code(std::errc::io_error);
+    }
+
+    if (ok && (m_format == tar) && ((size % tarBlock) != 0))
+    {
+        const char zeros[tarBlock] = { 0 };
+        ok = write(zeros, tarBlock - (size_t)(size % tarBlock));
+    }
+
+    if (ok && (m_format == zip))
+    {
+        zipEntry.crc = crc.digest();
+
+        std::string tmp;
+        put32(tmp, zipEntry.crc);
+
+        const auto end = m_ofs.tellp();
+        m_ofs.seekp((std::streamoff)(zipEntry.offset + 14));
+        ok = write(tmp.data(), tmp.size());
+        m_ofs.seekp(end);
+        ok = ok && m_ofs.good();
+    }
+
+    if (!ok)
+    {
+        if (!ec) ec = std::make_error_code(std::errc::io_error);
+
+        std::error_code tmp;
+        rollback(tmp);
+
+        return false;
+    }
+
+    m_offset = (uint64_t)m_ofs.tellp();
+    if (m_format == zip) m_zipEntries.push_back(zipEntry);
+
+    return true;
+}
+
+bool util::ArchiveWriter::close(std::error_code& ec)
+{
+    ec.clear();
+
+    if (!isOpen()) return true;
+
+    m_ofs.clear();
+    m_ofs.seekp((std::streamoff)m_offset);
+
+    bool ok = m_ofs.good();
+
+    if (ok && (m_format == zip))
+    {
+        const uint64_t cdOffset = m_offset;
+        std::string cd;
+
+        for (const auto& e : m_zipEntries)
+        {
+            const bool size64 = (e.size >= zipMax32);
+            const bool offset64 = (e.offset >= zipMax32);
+            const uint16_t extraSize = (uint16_t)((size64 ? 16 : 0) + (offset64 ? 8 : 0));
+
+            put32(cd, 0x02014B50);
+            put16(cd, (3 << 8) | 45); // Unix, 4.5
+            put16(cd, ((size64 || offset64) ? 45 : 20));
+            put16(cd, zipFlagUtf8);
+            put16(cd, 0);
+            put16(cd, e.time);
+            put16(cd, e.date);
+            put32(cd, e.crc);
+            put32(cd, (size64 ? zipMax32 : (uint32_t)e.size));
+            put32(cd, (size64 ? zipMax32 : (uint32_t)e.size));
+            put16(cd, (uint16_t)e.name.size());
+            put16(cd, (extraSize > 0 ? extraSize + 4 : 0));
+            put16(cd, 0); // comment
+            put16(cd, 0); // disk
+            put16(cd, 0); // internal attributes
+            put32(cd, ((0100000u | e.mode) << 16)); // regular file
+            put32(cd, (offset64 ? zipMax32 : (uint32_t)e.offset));
+            cd += e.name;
+
+            if (extraSize > 0)
+            {
+                put16(cd, 0x0001);
+                put16(cd, extraSize);
+
+                if (size64)
+                {
+                    put64(cd, e.size);
+                    put64(cd, e.size);
+                }
+
+                if (offset64) put64(cd, e.offset);
+            }
+
+            if (cd.size() >= bufferSize)
+            {
+                ok = ok && write(cd.data(), cd.size());
+                m_offset += cd.size();
+                cd.clear();
+            }
+        }
+
+        ok = ok && write(cd.data(), cd.size());
+        m_offset += cd.size();
+
+        const uint64_t cdSize = m_offset - cdOffset;
+        const uint64_t nEntries = m_zipEntries.size();
+        const bool zip64 = ((nEntries >= zipMax16) || (cdSize >= zipMax32) || (cdOffset >= zipMax32));
+
+        std::string end;
+
+        if (zip64)
+        {
+            put32(end, 0x06064B50);
+            put64(end, 44);
+            put16(end, (3 << 8) | 45);
+            put16(end, 45);
+            put32(end, 0);
+            put32(end, 0);
+            put64(end, nEntries);
+            put64(end, nEntries);
+            put64(end, cdSize);
+            put64(end, cdOffset);
+
+            put32(end, 0x07064B50);
+            put32(end, 0);
+            put64(end, m_offset); // offset of the Zip64 end of central directory record
+            put32(end, 1);
+        }
+
+        put32(end, 0x06054B50);
+        put16(end, 0);
+        put16(end, 0);
+        put16(end, (zip64 ? zipMax16 : (uint16_t)nEntries));
+        put16(end, (zip64 ? zipMax16 : (uint16_t)nEntries));
+        put32(end, (zip64 ? zipMax32 : (uint32_t)cdSize));
+        put32(end, (zip64 ? zipMax32 : (uint32_t)cdOffset));
+        put16(end, 0);
+
+        ok = ok && write(end.data(), end.size());
+        m_offset += end.size();
+    }
+    else if (ok)
+    {
+        // two zero blocks, padded to a full record
+        size_t n = 2 * tarBlock;
+        if (((m_offset + n) % tarRecord) != 0) n += tarRecord - (size_t)((m_offset + n) % tarRecord);
+
+        const std::vector<char> zeros(n, 0);
+        ok = write(zeros.data(), zeros.size());
+        m_offset += n;
+    }
+
+    m_ofs.close();
+    ok = ok && !m_ofs.fail();
+
+    // members which have been rolled back may have left data behind the end
+    if (ok) fs::resize_file(m_file, m_offset, ec);
+    else ec = std::make_error_code(std::errc::io_error);
+
+    m_zipEntries.clear();
+    m_zipEntries.shrink_to_fit();
+
+    return !ec;
+}
+
+bool util::ArchiveWriter::write(const void* data, size_t size)
+{
+    m_ofs.write((const char*)data, (std::streamsize)size);
+    return m_ofs.good();
+}
+
+bool util::ArchiveWriter::writeTarHeader(const std::string& name, uint64_t size, int64_t mtime, uint32_t mode)
+{
+    char block[tarBlock];
+    std::string prefix;
+    std::string base;
+
+    const bool nameFits = splitTarName(name, prefix, base);
+    const bool sizeFits = (size <= tarMaxOctalSize);
+
+    if (!nameFits || !sizeFits)
+    {
+        std::string pax;
+        if (!nameFits) pax += paxRecord("path", name);
+        if (!sizeFits) pax += paxRecord("size", std::to_string(size));
+
+        const size_t slash = name.rfind('/');
+        const std::string paxName = "PaxHeaders/" + (slash == std::string::npos ? name : name.substr(slash + 1));
+
+        tarHeader(block, std::string(), paxName, pax.size(), mtime, 0644, 'x');
+        if (!write(block, tarBlock)) return false;
+
+        pax.resize(((pax.size() + tarBlock - 1) / tarBlock) * tarBlock, 0);
+        if (!write(pax.data(), pax.size())) return false;
+
+        if (!nameFits)
+        {
+            prefix.clear();
+            base = name.substr(0, 100);
+        }
+    }
+
+    tarHeader(block, prefix, base, size, mtime, mode, '0');
+
+    return write(block, tarBlock);
+}
+
+bool util::ArchiveWriter::rollback(std::error_code& ec)
+{
+    ec.clear();
+
+    m_ofs.clear();
+    m_ofs.seekp((std::streamoff)m_offset);
+
+    if (!m_ofs.good()) ec = std::make_error_code(std::errc::io_error);
+
+    return !ec;
+}
@@ -0,0 +1,153 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_ARCHIVE_H
+#define IG_MDW_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+
+namespace util
+{
+    struct CopyOptions;
+    class RateLimiter;
+
+    // Lists the regular files of a tar or zip archive and extracts them. open() reads only the headers (tar) or the
+    // central directory (zip), the data is not touched until a member is read. read() and extract() open the archive
+    // on their own and may be called from any thread.
+    //
+    // Stored data (tar, zip method 0) is read at its offset in the archive, deflated zip members (method 8) are
+    // decoded on the fly. Other methods and encrypted members can't be read (std::errc::not_supported). Corrupt
+    // archives are reported as std::errc::bad_message.
+    class ArchiveReader
+    {
+    public:
+        struct Member
+        {
+            std::string name;           // '/' separated, UTF-8
+            uint64_t offset;            // of the data (tar) or of the local header (zip)
+            uint64_t size;
+            uint64_t compressedSize;    // same as size if stored
+            int64_t mtime;              // seconds since the epoch
+            uint32_t mode;              // permissions
+            uint32_t crc;               // zip only
+            uint16_t method;            // zip compression method, 0 (stored) for tar
+            bool encrypted;
+        };
+
+        // called with the data of a member in chunks, returns false to abort
+        typedef std::function<bool(const uint8_t* data, size_t size)> sink_t;
+
+    public:
+        ArchiveReader() : m_zip(false) {}
+        virtual ~ArchiveReader() {}
+
+        ArchiveReader(const ArchiveReader& other) = delete;
+        ArchiveReader& operator=(const ArchiveReader& other) = delete;
+
+        // true if the file name ends with ".tar" or ".zip" (case insensitive)
+        static bool isArchive(const std::filesystem::path& file);
+
+        // reads the member list, returns false if the file can't be read or is not a valid archive
+        bool open(const std::filesystem::path& file, std::error_code& ec);
+
+        const std::filesystem::path& file() const { return m_file; }
+
+        // the regular files sorted by name, of duplicate names the last in the archive
+        const std::vector<util::ArchiveReader::Member>& members() const { return m_members; }
+
+        // nullptr if there is no such member
+        const util::ArchiveReader::Member* find(const std::string_view& name) const;
+
+        // Passes the (decompressed) data of the member to sink. Zip members are checked against their CRC after the
+        // data has been passed. If sink returns false, false is returned and ec is not set. The reads are limited by
+        // limiter if it's not nullptr.
+        bool read(const util::ArchiveReader::Member& member, const sink_t& sink, std::error_code& ec, util::RateLimiter* limiter = nullptr) const;
+
+        // Writes the member to dst, like util::copyFile() does with a regular file. The permissions and the
+        // modification time are taken from the member. Stored members are copied in-kernel (copy_file_range) from
+        // their offset in the archive if options.hash is not set.
+        bool extract(const util::ArchiveReader::Member& member, const std::filesystem::path& dst, const util::CopyOptions& options, uint64_t& hash, std::error_code& ec) const;
+
+    private:
+        std::filesystem::path m_file;
+        bool m_zip;
+        std::vector<Member> m_members;
+    };
+
+    // Writes a tar (POSIX ustar, pax headers for long names and files of 8GiB and more) or an uncompressed zip archive
+    // (Zip64 where needed). The files are streamed into the archive, nothing is buffered except the zip central
+    // directory.
+    class ArchiveWriter
+    {
+    public:
+        typedef enum FORMAT
+        {
+            tar = 0,
+            zip,
+        } format_t;
+
+    public:
+        ArchiveWriter() : m_format(tar), m_offset(0) {}
+        virtual ~ArchiveWriter() {}
+
+        ArchiveWriter(const ArchiveWriter& other) = delete;
+        ArchiveWriter& operator=(const ArchiveWriter& other) = delete;
+
+        // creates or truncates the archive file
+        bool open(const std::filesystem::path& file, util::ArchiveWriter::format_t format, std::error_code& ec);
+
+        // Appends the regular file src as member name ('/' separated, UTF-8). The modification time and the permissions
+        // are taken from src, size is set to the number of data bytes. If it fails, the archive is left as it was
+        // before the call. The I/O is limited by limiter if it's not nullptr.
+        bool add(const std::filesystem::path& src, const std::string& name, uint64_t& size, std::error_code& ec, util::RateLimiter* limiter = nullptr);
+
+        // same as above, but the data, the modification time and the permissions are taken from a member of another archive
+        bool add(const util::ArchiveReader& reader, const util::ArchiveReader::Member& member, const std::string& name, uint64_t& size, std::error_code& ec, util::RateLimiter* limiter = nullptr);
+
+        // writes the end of the archive and closes the file
+        bool close(std::error_code& ec);
+
+        bool isOpen() const { return m_ofs.is_open(); }
+
+    private:
+        struct ZipEntry
+        {
+            std::string name;
+            uint64_t offset; // of the local header
+            uint64_t size;
+            uint32_t crc;
+            uint16_t time;
+            uint16_t date;
+            uint32_t mode;
+        };
+
+        format_t m_format;
+        std::filesystem::path m_file;
+        std::ofstream m_ofs;
+        uint64_t m_offset; // end of the last complete member
+        std::vector<ZipEntry> m_zipEntries;
+
+        // passes the data to the sink, returns false on error
+        typedef std::function<bool(const util::ArchiveReader::sink_t& sink, std::error_code& ec)> source_t;
+
+        bool add(const std::string& name, uint64_t srcSize, int64_t mtime, uint32_t mode, const source_t& source, uint64_t& size, std::error_code& ec, util::RateLimiter* limiter);
+        bool write(const void* data, size_t size);
+        bool writeTarHeader(const std::string& name, uint64_t size, int64_t mtime, uint32_t mode);
+        bool rollback(std::error_code& ec);
+    };
+}
+
+
+#endif // IG_MDW_ARCHIVE_H
@@ -0,0 +1,423 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include "copy.h"
+#include "util.h"
+#include "xxhash.h"
+
+#include <omw/defs.h>
+
+#ifdef OMW_PLAT_UNIX
+#define COPY_POSIX (1)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr size_t bufferSize = 1024 * 1024;
+
+    // one buffer per thread, the copy functions are called from the worker threads too
+    std::vector<char>& buffer()
+    {
+        thread_local std::vector<char> buffer(bufferSize);
+        return buffer;
+    }
+
+#ifdef COPY_POSIX
+    std::error_code lastError() { return std::error_code(errno, std::generic_category()); }
+
+    // reads up to size bytes, returns -1 on error
+    ssize_t readSome(int fd, char* data, size_t size)
+    {
+        ssize_t r;
+        do { r = ::read(fd, data, size); } while ((r < 0) && (errno == EINTR));
+        return r;
+    }
+
+    bool writeAll(int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t n = ::write(fd, data, size);
+
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                return false;
+            }
+
+            data += n;
+            size -= (size_t)n;
+        }
+
+        return true;
+    }
+#endif
+}
+
+
+
+#ifdef COPY_POSIX
+bool util::syncDestination(int fd, const util::CopyOptions& options, std::error_code& ec)
+{
+    ec.clear();
+
+    if (options.syncer) options.syncer->add(fd, ec);
+    else if (options.sync)
+    {
+#ifdef __APPLE__
+        if (::fsync(fd) != 0) ec = lastError();
+#else
+        if (::fdatasync(fd) != 0) ec = lastError();
+#endif
+    }
+
+    return !ec;
+}
+#endif
+
+bool util::copyFile(const fs::path& src, const fs::path& dst, const util::CopyOptions& options, uint64_t& hash, std::error_code& ec)
+{
+    ec.clear();
+
+    auto& buf = buffer();
+    XXH64 h;
+    RateLimiter::Bucket bucket(options.limiter);
+
+    bucket.consume(0, 1);
+
+#ifdef COPY_POSIX
+    const int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+    {
+        ec = lastError();
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(in, &st) != 0) ec = lastError();
+    else if (!S_ISREG(st.st_mode)) ec = std::make_error_code(std::errc::not_supported);
+
+    if (ec)
+    {
+        ::close(in);
+        return false;
+    }
+
+#ifdef __linux__
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    const int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (options.overwrite ? O_TRUNC : O_EXCL), (mode_t)(st.st_mode & 07777));
+    if (out < 0)
+    {
+        ec = lastError();
+        ::close(in);
+        return false;
+    }
+
+    bool useBuffer = options.hash;
+
+#ifdef __linux__
+    if (!useBuffer)
+    {
+        bool first = true;
+
+        // smaller chunks if limited, so that the limiter can keep the rate steady
+        const size_t chunkSize = (options.limiter ? bufferSize : bufferSize * 64);
+
+        while (!ec)
+        {
+            const ssize_t n = copy_file_range(in, nullptr, out, nullptr, chunkSize, 0);
+
+            if (n > 0)
+            {
+                first = false;
+                bucket.consume((uint64_t)n, 1);
+            }
+            else if (n == 0) break;
+            else if (errno == EINTR) continue;
+            else if (first && ((errno == EXDEV) || (errno == ENOSYS) || (errno == EINVAL) || (errno == EOPNOTSUPP)))
+            {
+                // not supported for these file systems, nothing has been copied yet
+                useBuffer = true;
+                break;
+            }
+            else ec = lastError();
+        }
+    }
+#else
+    useBuffer = true;
+#endif
+
+    while (useBuffer && !ec)
+    {
+        const ssize_t n = readSome(in, buf.data(), buf.size());
+
+        if (n < 0) ec = lastError();
+        else if (n == 0) break;
+        else
+        {
+            if (options.hash) h.update(buf.data(), (size_t)n);
+            if (!writeAll(out, buf.data(), (size_t)n)) ec = lastError();
+            bucket.consume((uint64_t)n, 1);
+        }
+    }
+
+    if (!ec && (fchmod(out, (mode_t)(st.st_mode & 07777)) != 0)) ec = lastError();
+
+    if (!ec && options.preserveTimes)
+    {
+#ifdef __APPLE__
+        const struct timespec times[2] = { st.st_atimespec, st.st_mtimespec };
+#else
+        const struct timespec times[2] = { st.st_atim, st.st_mtim };
+#endif
+        if (futimens(out, times) != 0) ec = lastError();
+    }
+
+    if (!ec) syncDestination(out, options, ec);
+
+    if ((::close(out) != 0) && !ec) ec = lastError();
+    ::close(in);
+#else
+    if (!options.overwrite && fs::exists(dst))
+    {
+        ec = std::make_error_code(std::errc::file_exists);
+        return false;
+    }
+
+    std::ifstream ifs(src, std::ios::in | std::ios::binary);
+    std::ofstream ofs(dst, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!ifs.good() || !ofs.good()) ec = std::make_error_code(std::errc::io_error);
+
+    while (!ec && ifs.good())
+    {
+        ifs.read(buf.data(), buf.size());
+        const auto n = ifs.gcount();
+
+        if (ifs.bad()) ec = std::make_error_code(std::errc::io_error);
+        else if (n > 0)
+        {
+            if (options.hash) h.update(buf.data(), (size_t)n);
+            if (!ofs.write(buf.data(), n).good()) ec = std::make_error_code(std::errc::io_error);
+            bucket.consume((uint64_t)n, 1);
+        }
+    }
+
+    ofs.close();
+    if (!ec && ofs.fail()) ec = std::make_error_code(std::errc::io_error);
+
+    if (!ec) fs::permissions(dst, fs::status(src).permissions(), ec);
+
+    // there are no descriptor based calls, only the modification time is set
+    if (!ec && options.preserveTimes)
+    {
+        const auto t = fs::last_write_time(src, ec);
+        if (!ec) fs::last_write_time(dst, t, ec);
+    }
+#endif
+
+    if (ec)
+    {
+        std::error_code tmp;
+        fs::remove(dst, tmp);
+        return false;
+    }
+
+    hash = (options.hash ? h.digest() : 0);
+
+    return true;
+}
+
+void util::copySmallFiles(const std::vector<util::SmallFile>& files, const util::CopyOptions& options, std::vector<util::SmallFileResult>& results)
+{
+    results.assign(files.size(), SmallFileResult());
+
+#ifdef COPY_POSIX
+    struct Pending
+    {
+        size_t idx;
+        size_t offset;  // in the buffer
+        size_t size;
+        mode_t mode;
+        struct timespec times[2];
+        double readDuration;
+    };
+
+    thread_local std::vector<Pending> pending;
+
+    auto& buf = buffer();
+    size_t used = 0;
+    RateLimiter::Bucket bucket(options.limiter);
+
+    const auto writePending = [&]()
+    {
+        for (const auto& p : pending)
+        {
+            const auto& file = files[p.idx];
+            auto& r = results[p.idx];
+            const char* const data = buf.data() + p.offset;
+            const util::Stopwatch sw;
+
+            r.done = true;
+
+            const int out = ::open(file.dst.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (file.overwrite ? O_TRUNC : O_EXCL), p.mode);
+
+            if (out < 0) r.ec = lastError();
+            else
+            {
+                if (!writeAll(out, data, p.size)) r.ec = lastError();
+                else if (fchmod(out, p.mode) != 0) r.ec = lastError();
+                else if (options.preserveTimes && (futimens(out, p.times) != 0)) r.ec = lastError();
+                else syncDestination(out, options, r.ec);
+
+                if ((::close(out) != 0) && !r.ec) r.ec = lastError();
+
+                if (r.ec)
+                {
+                    std::error_code tmp;
+                    fs::remove(file.dst, tmp);
+                }
+            }
+
+            if (!r.ec)
+            {
+                r.copied = true;
+                r.size = p.size;
+                if (options.hash) r.hash = XXH64::hash(data, p.size);
+            }
+
+            r.duration = p.readDuration + sw.elapsed();
+
+            bucket.consume((uint64_t)p.size, 1);
+        }
+
+        pending.clear();
+        used = 0;
+    };
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const util::Stopwatch sw;
+        const int in = ::open(files[i].src.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) continue;
+
+        struct stat st;
+
+        if ((fstat(in, &st) == 0) && S_ISREG(st.st_mode) && ((uint64_t)st.st_size <= smallFileSize))
+        {
+            const size_t size = (size_t)st.st_size;
+
+            if ((used + size + 1) > buf.size()) writePending();
+
+            // one byte more, to notice files which have grown since fstat()
+            ssize_t n;
+            do { n = ::pread(in, buf.data() + used, size + 1, 0); } while ((n < 0) && (errno == EINTR));
+
+            bucket.consume(0, 1);
+
+            if ((n >= 0) && ((size_t)n == size))
+            {
+#ifdef __APPLE__
+                pending.push_back(Pending{ i, used, size, (mode_t)(st.st_mode & 07777), { st.st_atimespec, st.st_mtimespec }, 0 });
+#else
+                pending.push_back(Pending{ i, used, size, (mode_t)(st.st_mode & 07777), { st.st_atim, st.st_mtim }, 0 });
+#endif
+                used += size;
+            }
+        }
+
+        ::close(in);
+
+        if (!pending.empty() && (pending.back().idx == i)) pending.back().readDuration = sw.elapsed();
+    }
+
+    writePending();
+#endif
+}
+
+bool util::hashFile(const fs::path& file, bool dropCache, uint64_t& hash, std::error_code& ec, util::RateLimiter* limiter)
+{
+    ec.clear();
+
+    auto& buf = buffer();
+    XXH64 h;
+    RateLimiter::Bucket bucket(limiter);
+
+#ifdef COPY_POSIX
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        ec = lastError();
+        return false;
+    }
+
+#ifdef __linux__
+    if (dropCache)
+    {
+        // dirty pages can't be dropped, they have to be written first
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#else
+    (void)dropCache;
+#endif
+
+    while (!ec)
+    {
+        const ssize_t n = readSome(fd, buf.data(), buf.size());
+
+        if (n < 0) ec = lastError();
+        else if (n == 0) break;
+        else
+        {
+            h.update(buf.data(), (size_t)n);
+            bucket.consume((uint64_t)n, 1);
+        }
+    }
+
+    ::close(fd);
+#else
+    (void)dropCache;
+
+    std::ifstream ifs(file, std::ios::in | std::ios::binary);
+    if (!ifs.good()) ec = std::make_error_code(std::errc::io_error);
+
+    while (!ec && ifs.good())
+    {
+        ifs.read(buf.data(), buf.size());
+        const auto n = ifs.gcount();
+
+        if (ifs.bad()) ec = std::make_error_code(std::errc::io_error);
+        else if (n > 0)
+        {
+            h.update(buf.data(), (size_t)n);
+            bucket.consume((uint64_t)n, 1);
+        }
+    }
+#endif
+
+    if (ec) return false;
+
+    hash = h.digest();
+
+    return true;
+}
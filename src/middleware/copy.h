@@ -0,0 +1,82 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_COPY_H
+#define IG_MDW_COPY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include "ratelimit.h"
+#include "syncer.h"
+
+
+namespace util
+{
+    struct CopyOptions
+    {
+        CopyOptions() : overwrite(false), hash(false), preserveTimes(false), limiter(nullptr), sync(false), syncer(nullptr) {}
+
+        bool overwrite;
+        bool hash;          // compute the XXH64 of the data
+        bool preserveTimes; // set the access and modification time of the destination to the ones of the source
+        util::RateLimiter* limiter; // nullptr if not limited, the file and each chunk of up to 1MiB count as one I/O operation
+        bool sync;          // flush the data of the destination to the device before it's closed (fdatasync)
+        util::Syncer* syncer; // if not nullptr, the destination is added to it before it's closed instead of sync
+    };
+
+    // Flushes or queues the destination according to CopyOptions::sync and CopyOptions::syncer, called before it's
+    // closed. Returns false on error. UNIX only.
+    bool syncDestination(int fd, const util::CopyOptions& options, std::error_code& ec);
+
+    // Copies a regular file. Everything after opening (data, permissions and times) is done on the open descriptors,
+    // no further path lookups are needed. Like std::filesystem::copy_file() an existing destination is an error if
+    // overwrite is not set, and the permissions are copied. A partially written destination is removed.
+    //
+    // If hash is set, the data is copied through a buffer and hashed on the way, so that the source is read only once.
+    // Otherwise the in-kernel copy (copy_file_range) is used where available.
+    //
+    // Returns false on error.
+    bool copyFile(const std::filesystem::path& src, const std::filesystem::path& dst, const util::CopyOptions& options, uint64_t& hash, std::error_code& ec);
+
+    // files up to this size are copied by copySmallFiles()
+    constexpr uint64_t smallFileSize = 64 * 1024;
+
+    struct SmallFile
+    {
+        std::filesystem::path src;
+        std::filesystem::path dst;
+        bool overwrite;
+    };
+
+    struct SmallFileResult
+    {
+        bool done = false;      // if not set, the file has to be copied by copyFile()
+        bool copied = false;
+        std::error_code ec;
+        uint64_t size = 0;
+        uint64_t hash = 0;
+        double duration = 0;    // seconds spent on reading and writing this file
+    };
+
+    // Copies regular files of up to smallFileSize bytes with as few system calls as possible. The sources are read
+    // into a per thread buffer (one read each), which is then written out in a burst, and reused for the next files.
+    // Sources which are larger, have changed while reading, or couldn't be opened are not done, so that copyFile()
+    // handles and reports them. CopyOptions::overwrite is ignored, the one of each file is used. Not supported on
+    // platforms other than UNIX, nothing is done there.
+    void copySmallFiles(const std::vector<util::SmallFile>& files, const util::CopyOptions& options, std::vector<util::SmallFileResult>& results);
+
+    // Computes the XXH64 of the file content. If dropCache is set, the file is flushed and evicted from the page cache
+    // first, so that the data is read back from the device (Linux only, ignored on other platforms). The reads are
+    // limited by limiter if it's not nullptr.
+    bool hashFile(const std::filesystem::path& file, bool dropCache, uint64_t& hash, std::error_code& ec, util::RateLimiter* limiter = nullptr);
+}
+
+
+#endif // IG_MDW_COPY_H
@@ -0,0 +1,79 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+#include "crc32.h"
+
+
+namespace
+{
+    constexpr uint32_t polynomial = 0xEDB88320u; // reversed 0x04C11DB7
+
+    struct Tables
+    {
+        uint32_t t[8][256];
+
+        Tables()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t crc = i;
+                for (int k = 0; k < 8; ++k) crc = (crc & 1 ? (crc >> 1) ^ polynomial : crc >> 1);
+                t[0][i] = crc;
+            }
+
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                for (int k = 1; k < 8; ++k) t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+    };
+
+    const Tables& tables()
+    {
+        static const Tables tables;
+        return tables;
+    }
+}
+
+
+
+void util::CRC32::update(const void* data, size_t size)
+{
+    const auto& t = tables().t;
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t crc = m_crc;
+
+    while (size >= 8)
+    {
+        const uint32_t a = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        const uint32_t b = ((uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24));
+
+        crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^ t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24] ^
+            t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^ t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+
+        p += 8;
+        size -= 8;
+    }
+
+    while (size > 0)
+    {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+        ++p;
+        --size;
+    }
+
+    m_crc = crc;
+}
+
+uint32_t util::CRC32::hash(const void* data, size_t size)
+{
+    CRC32 crc;
+    crc.update(data, size);
+    return crc.digest();
+}
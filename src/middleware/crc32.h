@@ -0,0 +1,35 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_CRC32_H
+#define IG_MDW_CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace util
+{
+    // streaming CRC-32 (IEEE 802.3, as used by zip and gzip), slicing by 8
+    class CRC32
+    {
+    public:
+        CRC32() : m_crc(0xFFFFFFFFu) {}
+        virtual ~CRC32() {}
+
+        void reset() { m_crc = 0xFFFFFFFFu; }
+        void update(const void* data, size_t size);
+        uint32_t digest() const { return ~m_crc; }
+
+        static uint32_t hash(const void* data, size_t size);
+
+    private:
+        uint32_t m_crc;
+    };
+}
+
+
+#endif // IG_MDW_CRC32_H
@@ -0,0 +1,131 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "direnum.h"
+
+#include <omw/defs.h>
+
+#if defined(OMW_PLAT_UNIX) && defined(__linux__)
+#define DIRENUM_GETDENTS (1)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+#ifdef DIRENUM_GETDENTS
+    constexpr size_t bufferSize = 256 * 1024;
+
+    // layout of the records returned by getdents64
+    struct linux_dirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    // returns true if the entry is a regular file, following symlinks, size is set
+    bool statRegular(int dirFd, const char* name, uint64_t& size)
+    {
+#ifdef STATX_TYPE
+        struct statx stx;
+
+        if (statx(dirFd, name, AT_NO_AUTOMOUNT, STATX_TYPE | STATX_SIZE, &stx) == 0)
+        {
+            size = stx.stx_size;
+            return S_ISREG(stx.stx_mode);
+        }
+
+        if (errno != ENOSYS) return false;
+#endif
+
+        struct stat st;
+
+        if (fstatat(dirFd, name, &st, 0) == 0)
+        {
+            size = (uint64_t)st.st_size;
+            return S_ISREG(st.st_mode);
+        }
+
+        return false;
+    }
+#endif
+}
+
+
+
+void util::DirEnumerator::regularFiles(const fs::path& dir, const callback_type& fn)
+{
+#ifdef DIRENUM_GETDENTS
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) throw fs::filesystem_error("directory enumerator", dir, std::error_code(errno, std::generic_category()));
+
+    if (m_buffer.size() < bufferSize) m_buffer.resize(bufferSize);
+
+    while (true)
+    {
+        const long n = syscall(SYS_getdents64, fd, m_buffer.data(), m_buffer.size());
+
+        if (n < 0)
+        {
+            const std::error_code ec(errno, std::generic_category());
+            ::close(fd);
+            throw fs::filesystem_error("directory enumerator", dir, ec);
+        }
+
+        if (n == 0) break;
+
+        for (long pos = 0; pos < n;)
+        {
+            const auto* const d = (const linux_dirent64*)(m_buffer.data() + pos);
+            pos += d->d_reclen;
+
+            const char* const name = d->d_name;
+
+            if ((name[0] == '.') && ((name[1] == 0) || ((name[1] == '.') && (name[2] == 0)))) continue;
+
+            uint64_t size = unknownSize;
+            bool regular;
+
+            if (d->d_type == DT_REG) regular = true;
+            else if ((d->d_type == DT_UNKNOWN) || (d->d_type == DT_LNK)) regular = statRegular(fd, name, size);
+            else regular = false;
+
+            if (regular) fn(std::string_view(name, std::strlen(name)), size);
+        }
+    }
+
+    ::close(fd);
+#else
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir))
+    {
+        if (entry.is_regular_file())
+        {
+            std::error_code ec;
+            const uint64_t size = entry.file_size(ec);
+            const std::string name = entry.path().filename().u8string();
+
+            fn(name, (ec ? unknownSize : size));
+        }
+    }
+#endif
+}
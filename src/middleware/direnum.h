@@ -0,0 +1,48 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_DIRENUM_H
+#define IG_MDW_DIRENUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+
+namespace util
+{
+    // Lists the regular files of a directory (not recursive, symlinks are followed like
+    // std::filesystem::directory_entry::is_regular_file() does).
+    //
+    // On Linux the entries are read in large getdents64 batches into a reusable buffer, and the type is taken from
+    // d_type. statx is only called if the file system doesn't provide the type (DT_UNKNOWN) or for symlinks. Elsewhere
+    // std::filesystem::directory_iterator is used.
+    class DirEnumerator
+    {
+    public:
+        using callback_type = std::function<void(const std::string_view& name, uint64_t size)>;
+
+        // the size of a file is only known if it had to be stat'ed
+        static constexpr uint64_t unknownSize = (uint64_t)(-1);
+
+    public:
+        DirEnumerator() {}
+        virtual ~DirEnumerator() {}
+
+        // Calls fn for every regular file, the name is UTF-8. Throws std::filesystem::filesystem_error if the directory
+        // can't be read.
+        void regularFiles(const std::filesystem::path& dir, const callback_type& fn);
+
+    private:
+        std::vector<char> m_buffer;
+    };
+}
+
+
+#endif // IG_MDW_DIRENUM_H
@@ -0,0 +1,183 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "dirwatch.h"
+
+#include <omw/defs.h>
+
+#if defined(OMW_PLAT_UNIX) && defined(__linux__)
+#define DIRWATCH_INOTIFY (1)
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+    constexpr size_t bufferSize = 64 * 1024;
+}
+
+
+
+util::DirWatcher::DirWatcher()
+    : m_fd(-1), m_debounce(100), m_nOverflows(0), m_buffer(bufferSize)
+{
+#ifdef DIRWATCH_INOTIFY
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+util::DirWatcher::~DirWatcher()
+{
+#ifdef DIRWATCH_INOTIFY
+    if (m_fd >= 0) close(m_fd);
+#endif
+}
+
+int util::DirWatcher::add(const std::string& dir)
+{
+    int r = -1;
+
+#ifdef DIRWATCH_INOTIFY
+    if (m_fd >= 0)
+    {
+        const int wd = inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+
+        if (wd >= 0)
+        {
+            const auto it = m_wdToIdx.find(wd);
+
+            if (it != m_wdToIdx.end()) r = (int)(it->second); // same directory added twice
+            else
+            {
+                r = (int)m_dirs.size();
+                m_wdToIdx[wd] = m_dirs.size();
+                m_dirs.push_back(dir);
+            }
+        }
+    }
+#endif
+
+    return r;
+}
+
+std::vector<util::DirWatcher::Event> util::DirWatcher::poll(std::chrono::milliseconds timeout)
+{
+    std::vector<Event> r;
+
+#ifdef DIRWATCH_INOTIFY
+    if (m_fd >= 0)
+    {
+        // don't sleep past the earliest pending deadline
+        if (!m_pending.empty())
+        {
+            const auto now = clock_type::now();
+            auto earliest = m_pending.begin()->second;
+            for (const auto& p : m_pending) earliest = std::min(earliest, p.second);
+
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(earliest - now) + std::chrono::milliseconds(1);
+            if (remaining < timeout) timeout = std::max(remaining, std::chrono::milliseconds(0));
+        }
+
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        const int res = ::poll(&pfd, 1, (int)timeout.count());
+        if ((res > 0) && (pfd.revents & POLLIN)) read();
+
+        const auto now = clock_type::now();
+        auto it = m_pending.begin();
+        while (it != m_pending.end())
+        {
+            if (it->second <= now)
+            {
+                r.push_back(Event{ it->first.first, it->first.second });
+                it = m_pending.erase(it);
+            }
+            else ++it;
+        }
+    }
+#else
+    (void)timeout;
+#endif
+
+    return r;
+}
+
+bool util::DirWatcher::isSupported()
+{
+#ifdef DIRWATCH_INOTIFY
+    return true;
+#else
+    return false;
+#endif
+}
+
+void util::DirWatcher::read()
+{
+#ifdef DIRWATCH_INOTIFY
+    ssize_t len;
+
+    while ((len = ::read(m_fd, m_buffer.data(), m_buffer.size())) > 0)
+    {
+        const auto deadline = clock_type::now() + m_debounce;
+        size_t pos = 0;
+
+        while (pos < (size_t)len)
+        {
+            const struct inotify_event* ev = (const struct inotify_event*)(m_buffer.data() + pos);
+
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                ++m_nOverflows;
+                rescan(deadline);
+            }
+            else if ((ev->len > 0) && !(ev->mask & IN_ISDIR))
+            {
+                const auto it = m_wdToIdx.find(ev->wd);
+                if (it != m_wdToIdx.end()) m_pending[std::make_pair(it->second, std::string(ev->name))] = deadline;
+            }
+
+            pos += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+#endif
+}
+
+void util::DirWatcher::rescan(clock_type::time_point deadline)
+{
+#ifdef DIRWATCH_INOTIFY
+    for (size_t i = 0; i < m_dirs.size(); ++i)
+    {
+        DIR* const dir = opendir(m_dirs[i].c_str());
+        if (!dir) continue;
+
+        const struct dirent* de;
+
+        while ((de = readdir(dir)) != nullptr)
+        {
+            // the type is checked by the caller, only directories (also "." and "..") are left out here
+            if (de->d_type == DT_DIR) continue;
+
+            m_pending[std::make_pair(i, std::string(de->d_name))] = deadline;
+        }
+
+        closedir(dir);
+    }
+#else
+    (void)deadline;
+#endif
+}
@@ -0,0 +1,74 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_DIRWATCH_H
+#define IG_MDW_DIRWATCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace util
+{
+    // Watches directories for files which have been written or moved into them (not recursive).
+    // An event is only reported after the file has been quiet for the debounce time.
+    //
+    // If the event queue of the system overflows, events are lost. All files of the directories are reported then, so
+    // the caller has to expect events of files it already knows.
+    class DirWatcher
+    {
+    public:
+        using clock_type = std::chrono::steady_clock;
+
+        struct Event
+        {
+            size_t dirIdx;      // index returned by add()
+            std::string name;   // file name
+        };
+
+    public:
+        DirWatcher();
+        virtual ~DirWatcher();
+
+        DirWatcher(const DirWatcher& other) = delete;
+        DirWatcher& operator=(const DirWatcher& other) = delete;
+
+        // returns the index of the directory, or a negative value on error
+        int add(const std::string& dir);
+
+        // Waits at most `timeout` for events and returns the files which have settled.
+        std::vector<Event> poll(std::chrono::milliseconds timeout);
+
+        void setDebounce(std::chrono::milliseconds debounce) { m_debounce = debounce; }
+
+        // number of event queue overflows, after each of them all files of the directories have been reported
+        size_t overflows() const { return m_nOverflows; }
+
+        bool isValid() const { return (m_fd >= 0); }
+
+        static bool isSupported();
+
+    private:
+        int m_fd;
+        std::chrono::milliseconds m_debounce;
+        std::map<int, size_t> m_wdToIdx;
+        std::vector<std::string> m_dirs; // by index
+        size_t m_nOverflows;
+        std::map<std::pair<size_t, std::string>, clock_type::time_point> m_pending;
+        std::vector<uint8_t> m_buffer;
+
+        void read();
+        void rescan(clock_type::time_point deadline);
+    };
+}
+
+
+#endif // IG_MDW_DIRWATCH_H
@@ -0,0 +1,79 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "hashindex.h"
+#include "imagehash.h"
+
+
+namespace
+{
+}
+
+
+
+util::HashIndex::HashIndex(int radius)
+    : m_radius(radius), m_entries(), m_blocks()
+{
+    if ((radius < 0) || (radius > 63)) throw (int)(__LINE__);
+
+    const unsigned n = (unsigned)radius + 1;
+    unsigned shift = 0;
+
+    // the first 64 % n blocks are one bit wider
+    for (unsigned i = 0; i < n; ++i)
+    {
+        const unsigned width = (64 / n) + ((i < (64 % n)) ? 1 : 0);
+
+        m_blocks.push_back(Block{ shift, ((width < 64) ? ((1ull << width) - 1) : ~0ull), {} });
+        shift += width;
+    }
+}
+
+void util::HashIndex::insert(uint64_t hash, size_t value)
+{
+    const uint32_t idx = (uint32_t)m_entries.size();
+
+    if (m_entries.size() >= (size_t)(uint32_t)(-1)) throw (int)(__LINE__);
+
+    m_entries.push_back(Entry{ hash, value });
+
+    for (auto& block : m_blocks) block.table[(hash >> block.shift) & block.mask].push_back(idx);
+}
+
+bool util::HashIndex::find(uint64_t hash, size_t& value) const
+{
+    uint32_t best = (uint32_t)(-1);
+    int bestDistance = m_radius + 1;
+
+    for (const auto& block : m_blocks)
+    {
+        const auto it = block.table.find((hash >> block.shift) & block.mask);
+
+        if (it != block.table.end())
+        {
+            // a candidate may be compared once per block it shares, that's cheaper than remembering it
+            for (const uint32_t idx : it->second)
+            {
+                const int d = util::hammingDistance(hash, m_entries[idx].hash);
+
+                if ((d < bestDistance) || ((d == bestDistance) && (idx < best)))
+                {
+                    best = idx;
+                    bestDistance = d;
+                }
+            }
+        }
+    }
+
+    if (bestDistance <= m_radius) value = m_entries[best].value;
+
+    return (bestDistance <= m_radius);
+}
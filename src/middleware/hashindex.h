@@ -0,0 +1,58 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_HASHINDEX_H
+#define IG_MDW_HASHINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+namespace util
+{
+    // Multi-index hashing of 64 bit hashes for searches within a fixed Hamming radius. The hashes are split into
+    // radius + 1 blocks, each block is indexed by an exact hash table. Two hashes within the radius are equal in at least
+    // one block, so only the hashes sharing a block with the searched one are compared.
+    class HashIndex
+    {
+    public:
+        HashIndex() = delete;
+        explicit HashIndex(int radius);
+        virtual ~HashIndex() {}
+
+        void insert(uint64_t hash, size_t value);
+
+        // Finds the nearest hash within the radius (inclusive) and sets value to its value. If there are multiple, the
+        // one inserted first is found. Returns false if there is none.
+        bool find(uint64_t hash, size_t& value) const;
+
+        int radius() const { return m_radius; }
+        size_t size() const { return m_entries.size(); }
+
+    private:
+        struct Entry
+        {
+            uint64_t hash;
+            size_t value;
+        };
+
+        struct Block
+        {
+            unsigned shift;
+            uint64_t mask;
+            std::unordered_map<uint64_t, std::vector<uint32_t>> table; // block value to entry indices
+        };
+
+        int m_radius;
+        std::vector<Entry> m_entries;
+        std::vector<Block> m_blocks;
+    };
+}
+
+
+#endif // IG_MDW_HASHINDEX_H
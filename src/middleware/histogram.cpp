@@ -0,0 +1,79 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "histogram.h"
+
+
+namespace
+{
+    constexpr unsigned subBits = 5;
+    constexpr uint64_t nSub = (1ull << subBits);    // sub buckets per power of two
+    constexpr uint64_t nExact = (2 * nSub);         // values counted exactly
+    constexpr size_t nBuckets = (size_t)(nExact + (64 - subBits - 1) * nSub);
+
+    unsigned msb(uint64_t value)
+    {
+        unsigned r = 0;
+        while (value >>= 1) ++r;
+        return r;
+    }
+}
+
+
+
+util::Histogram::Histogram()
+    : m_buckets(nBuckets, 0), m_count(0), m_max(0)
+{}
+
+void util::Histogram::add(uint64_t value)
+{
+    ++m_buckets[index(value)];
+    ++m_count;
+    m_max = std::max(m_max, value);
+}
+
+uint64_t util::Histogram::percentile(double p) const
+{
+    if (m_count == 0) return 0;
+
+    // rank of the value, 1 based
+    const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(std::min(std::max(p, 0.0), 1.0) * (double)m_count));
+    uint64_t n = 0;
+
+    for (size_t i = 0; i < nBuckets; ++i)
+    {
+        n += m_buckets[i];
+        if (n >= rank) return std::min(upperBound(i), m_max);
+    }
+
+    return m_max;
+}
+
+// the top subBits + 1 bits of the value select the bucket
+size_t util::Histogram::index(uint64_t value)
+{
+    if (value < nExact) return (size_t)value;
+
+    const unsigned shift = msb(value) - subBits;
+
+    return (size_t)(nExact + (shift - 1) * nSub + ((value >> shift) - nSub));
+}
+
+uint64_t util::Histogram::upperBound(size_t idx)
+{
+    if (idx < nExact) return (uint64_t)idx;
+
+    const unsigned shift = (unsigned)((idx - nExact) / nSub) + 1;
+    const uint64_t sub = ((idx - nExact) % nSub) + nSub;
+
+    return (((sub + 1) << shift) - 1);
+}
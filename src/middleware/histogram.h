@@ -0,0 +1,46 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_HISTOGRAM_H
+#define IG_MDW_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace util
+{
+    // Histogram of positive integer values (e.g. latencies in microseconds) with a fixed relative precision, like
+    // HdrHistogram. Values below 64 are counted exactly, larger ones in 32 linear sub buckets per power of two, so the
+    // error is below 1/32 over the whole uint64_t range, using 15KiB.
+    class Histogram
+    {
+    public:
+        Histogram();
+        virtual ~Histogram() {}
+
+        void add(uint64_t value);
+
+        uint64_t count() const { return m_count; }
+        uint64_t max() const { return m_max; }
+
+        // Value below which the fraction p (0..1) of the values are, the upper bound of the bucket but not more than
+        // max(). Returns 0 if the histogram is empty.
+        uint64_t percentile(double p) const;
+
+    private:
+        std::vector<uint64_t> m_buckets;
+        uint64_t m_count;
+        uint64_t m_max;
+
+        static size_t index(uint64_t value);
+        static uint64_t upperBound(size_t idx);
+    };
+}
+
+
+#endif // IG_MDW_HISTOGRAM_H
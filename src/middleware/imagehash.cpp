@@ -0,0 +1,554 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "imagehash.h"
+
+
+namespace
+{
+    constexpr size_t hashWidth = 9; // 8 differences per row
+    constexpr size_t hashHeight = 8;
+    constexpr size_t minBits = 8;   // set and cleared bits of a distinctive hash
+
+    // thrown on corrupt or unsupported data, caught by util::jpegHash()
+    struct DecodeError {};
+
+    uint16_t getBE16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+    // canonical JPEG Huffman table (ITU T.81 F.2.2.3)
+    struct HuffmanTable
+    {
+        bool valid = false;
+        uint8_t symbols[256];
+        int32_t minCode[17];
+        int32_t maxCode[17];    // -1 if there are no codes of this length
+        int32_t valPtr[17];
+    };
+
+    // reads the entropy coded data MSB first, removes the stuffed zero bytes and stops at markers
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, const uint8_t* end) : m_p(data), m_end(end), m_buffer(0), m_count(0), m_marker(false) {}
+
+        uint32_t bit()
+        {
+            if (m_count == 0)
+            {
+                uint8_t byte = 0; // past a marker the stream is padded with zeros
+
+                if (!m_marker)
+                {
+                    if (m_p >= m_end) throw DecodeError();
+
+                    byte = *m_p;
+
+                    if (byte != 0xFF) ++m_p;
+                    else if (((m_p + 1) < m_end) && (m_p[1] == 0x00)) m_p += 2;
+                    else
+                    {
+                        m_marker = true;
+                        byte = 0;
+                    }
+                }
+
+                m_buffer = byte;
+                m_count = 8;
+            }
+
+            --m_count;
+
+            return ((m_buffer >> m_count) & 1);
+        }
+
+        int32_t bits(unsigned n)
+        {
+            int32_t r = 0;
+            for (unsigned i = 0; i < n; ++i) r = (r << 1) | (int32_t)bit();
+            return r;
+        }
+
+        int decode(const HuffmanTable& table)
+        {
+            int32_t code = (int32_t)bit();
+
+            for (size_t len = 1; len < 17; ++len)
+            {
+                if ((table.maxCode[len] >= 0) && (code <= table.maxCode[len]) && (code >= table.minCode[len])) return table.symbols[table.valPtr[len] + code - table.minCode[len]];
+                code = (code << 1) | (int32_t)bit();
+            }
+
+            throw DecodeError();
+        }
+
+        // skips the rest of the byte and the next RSTn marker
+        void restart()
+        {
+            m_count = 0;
+            m_marker = false;
+
+            while ((m_p + 1) < m_end)
+            {
+                if ((m_p[0] == 0xFF) && (m_p[1] >= 0xD0) && (m_p[1] <= 0xD7))
+                {
+                    m_p += 2;
+                    return;
+                }
+
+                ++m_p;
+            }
+
+            throw DecodeError();
+        }
+
+    private:
+        const uint8_t* m_p;
+        const uint8_t* m_end;
+        uint32_t m_buffer;
+        unsigned m_count;
+        bool m_marker;
+    };
+
+    int32_t extend(int32_t value, unsigned size)
+    {
+        if ((size > 0) && (value < (1 << (size - 1)))) value -= (1 << size) - 1;
+        return value;
+    }
+
+    void buildHuffman(HuffmanTable& table, const uint8_t* counts, const uint8_t* symbols, size_t nSymbols)
+    {
+        std::memcpy(table.symbols, symbols, nSymbols);
+
+        int32_t code = 0;
+        int32_t k = 0;
+
+        for (size_t len = 1; len < 17; ++len)
+        {
+            table.valPtr[len] = k;
+            table.minCode[len] = code;
+            code += counts[len - 1];
+            k += counts[len - 1];
+            table.maxCode[len] = (counts[len - 1] > 0 ? code - 1 : -1);
+            code <<= 1;
+        }
+
+        table.valid = true;
+    }
+
+    struct Component
+    {
+        uint8_t id;
+        unsigned h;
+        unsigned v;
+        unsigned tq;
+    };
+
+    // 9x8 area averages of the DC image, bit y * 8 + x is set if the cell is darker than its right neighbour
+    bool differenceHash(const std::vector<int32_t>& image, size_t width, size_t height, uint64_t& hash)
+    {
+        if ((width < hashWidth) || (height < hashHeight)) return false;
+
+        int64_t cells[hashHeight][hashWidth];
+
+        for (size_t ty = 0; ty < hashHeight; ++ty)
+        {
+            const size_t y0 = (ty * height) / hashHeight;
+            const size_t y1 = ((ty + 1) * height) / hashHeight;
+
+            for (size_t tx = 0; tx < hashWidth; ++tx)
+            {
+                const size_t x0 = (tx * width) / hashWidth;
+                const size_t x1 = ((tx + 1) * width) / hashWidth;
+
+                int64_t sum = 0;
+                for (size_t y = y0; y < y1; ++y)
+                {
+                    for (size_t x = x0; x < x1; ++x) sum += image[y * width + x];
+                }
+
+                // scaled to keep the precision of the mean
+                cells[ty][tx] = (sum * 16) / (int64_t)((y1 - y0) * (x1 - x0));
+            }
+        }
+
+        hash = 0;
+
+        for (size_t y = 0; y < hashHeight; ++y)
+        {
+            for (size_t x = 0; x < (hashWidth - 1); ++x)
+            {
+                if (cells[y][x] < cells[y][x + 1]) hash |= (1ull << (y * 8 + x));
+            }
+        }
+
+        // images with little structure (plain, or a single gradient) can't be told apart
+        const size_t n = std::bitset<64>(hash).count();
+
+        return ((n >= minBits) && (n <= (64 - minBits)));
+    }
+
+    class TiffReader
+    {
+    public:
+        TiffReader(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_le(true) {}
+
+        bool init()
+        {
+            if (m_size < 8) return false;
+
+            if ((m_data[0] == 'I') && (m_data[1] == 'I')) m_le = true;
+            else if ((m_data[0] == 'M') && (m_data[1] == 'M')) m_le = false;
+            else return false;
+
+            return (u16(2) == 42);
+        }
+
+        uint16_t u16(size_t offset) const { return (m_le ? (uint16_t)(m_data[offset] | (m_data[offset + 1] << 8)) : getBE16(m_data + offset)); }
+        uint32_t u32(size_t offset) const { return (m_le ? ((uint32_t)u16(offset) | ((uint32_t)u16(offset + 2) << 16)) : (((uint32_t)u16(offset) << 16) | (uint32_t)u16(offset + 2))); }
+
+        // number of entries of the IFD at offset, returns false if it's not completely in the data
+        bool entries(uint32_t offset, size_t& n) const
+        {
+            if (((uint64_t)offset + 2) > m_size) return false;
+
+            n = u16(offset);
+
+            return (((uint64_t)offset + 2 + (n * 12) + 4) <= m_size);
+        }
+
+        // offset of the next IFD
+        uint32_t next(uint32_t offset, size_t n) const { return u32(offset + 2 + (n * 12)); }
+
+        // value of a SHORT or LONG entry
+        uint32_t value(size_t entryOffset) const { return (u16(entryOffset + 2) == 3 ? u16(entryOffset + 8) : u32(entryOffset + 8)); }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        bool m_le;
+    };
+
+    bool thumbnailFromTiff(const uint8_t* tiff, size_t tiffSize, const uint8_t*& thumbnail, size_t& thumbnailSize)
+    {
+        TiffReader reader(tiff, tiffSize);
+        if (!reader.init()) return false;
+
+        const uint32_t ifd0 = reader.u32(4);
+        size_t n;
+        if (!reader.entries(ifd0, n)) return false;
+
+        // IFD1 describes the thumbnail
+        const uint32_t ifd1 = reader.next(ifd0, n);
+        if ((ifd1 == 0) || !reader.entries(ifd1, n)) return false;
+
+        uint32_t offset = 0;
+        uint32_t length = 0;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            const size_t entry = ifd1 + 2 + (i * 12);
+            const uint16_t tag = reader.u16(entry);
+
+            if (tag == 0x0201) offset = reader.value(entry);
+            else if (tag == 0x0202) length = reader.value(entry);
+        }
+
+        if ((offset == 0) || (length < 4) || (((uint64_t)offset + length) > tiffSize)) return false;
+        if ((tiff[offset] != 0xFF) || (tiff[offset + 1] != 0xD8)) return false;
+
+        thumbnail = tiff + offset;
+        thumbnailSize = length;
+
+        return true;
+    }
+
+    bool isSof(uint8_t marker) { return ((marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC)); }
+}
+
+
+
+bool util::exifThumbnail(const uint8_t* data, size_t size, const uint8_t*& thumbnail, size_t& thumbnailSize)
+{
+    if ((size < 4) || (data[0] != 0xFF) || (data[1] != 0xD8)) return false;
+
+    size_t pos = 2;
+
+    while ((pos + 4) <= size)
+    {
+        if (data[pos] != 0xFF) return false;
+
+        const uint8_t marker = data[pos + 1];
+
+        // the EXIF block is in front of the image
+        if ((marker == 0xDA) || (marker == 0xD9) || isSof(marker)) return false;
+
+        const size_t len = getBE16(data + pos + 2);
+        if ((len < 2) || ((pos + 2 + len) > size)) return false;
+
+        const uint8_t* const seg = data + pos + 4;
+        const size_t segSize = len - 2;
+
+        if ((marker == 0xE1) && (segSize > 6) && (std::memcmp(seg, "Exif\0\0", 6) == 0))
+        {
+            if (thumbnailFromTiff(seg + 6, segSize - 6, thumbnail, thumbnailSize)) return true;
+        }
+
+        pos += 2 + len;
+    }
+
+    return false;
+}
+
+bool util::jpegHash(const uint8_t* data, size_t size, uint64_t& hash)
+{
+    if ((size < 4) || (data[0] != 0xFF) || (data[1] != 0xD8)) return false;
+
+    HuffmanTable dcTables[4];
+    HuffmanTable acTables[4];
+    int32_t q0[4] = { 1, 1, 1, 1 }; // DC quantisation of the tables
+    Component components[4];
+    size_t nComponents = 0;
+    size_t width = 0;
+    size_t height = 0;
+    bool progressive = false;
+    size_t restartInterval = 0;
+
+    size_t pos = 2;
+
+    try
+    {
+        while ((pos + 4) <= size)
+        {
+            if (data[pos] != 0xFF) return false;
+
+            const uint8_t marker = data[pos + 1];
+
+            if ((marker == 0xFF) || (marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD8)))
+            {
+                pos += (marker == 0xFF ? 1 : 2);
+                continue;
+            }
+
+            if (marker == 0xD9) return false;
+
+            const size_t len = getBE16(data + pos + 2);
+            if ((len < 2) || ((pos + 2 + len) > size)) return false;
+
+            const uint8_t* const seg = data + pos + 4;
+            const size_t segSize = len - 2;
+
+            if ((marker == 0xC0) || (marker == 0xC1) || (marker == 0xC2))
+            {
+                if ((segSize < 6) || (seg[0] != 8)) return false;
+
+                progressive = (marker == 0xC2);
+                height = getBE16(seg + 1);
+                width = getBE16(seg + 3);
+                nComponents = seg[5];
+
+                if ((nComponents == 0) || (nComponents > 4) || (segSize < (6 + nComponents * 3))) return false;
+
+                for (size_t i = 0; i < nComponents; ++i)
+                {
+                    auto& c = components[i];
+                    c.id = seg[6 + i * 3];
+                    c.h = seg[7 + i * 3] >> 4;
+                    c.v = seg[7 + i * 3] & 0x0F;
+                    c.tq = seg[8 + i * 3] & 0x03;
+
+                    if ((c.h < 1) || (c.h > 4) || (c.v < 1) || (c.v > 4)) return false;
+                }
+            }
+            else if (isSof(marker)) return false; // lossless, hierarchical or arithmetic coding
+            else if (marker == 0xC4)
+            {
+                size_t i = 0;
+
+                while ((i + 17) <= segSize)
+                {
+                    const unsigned tc = seg[i] >> 4;
+                    const unsigned th = seg[i] & 0x0F;
+                    const uint8_t* const counts = seg + i + 1;
+
+                    size_t nSymbols = 0;
+                    for (size_t k = 0; k < 16; ++k) nSymbols += counts[k];
+
+                    if ((tc > 1) || (th > 3) || (nSymbols > 256) || ((i + 17 + nSymbols) > segSize)) return false;
+
+                    buildHuffman((tc == 0 ? dcTables[th] : acTables[th]), counts, seg + i + 17, nSymbols);
+                    i += 17 + nSymbols;
+                }
+            }
+            else if (marker == 0xDB)
+            {
+                size_t i = 0;
+
+                while (i < segSize)
+                {
+                    const unsigned pq = seg[i] >> 4;
+                    const unsigned tq = seg[i] & 0x0F;
+                    const size_t tableSize = (pq == 0 ? 64 : 128);
+
+                    if ((tq > 3) || ((i + 1 + tableSize) > segSize)) return false;
+
+                    q0[tq] = (pq == 0 ? seg[i + 1] : getBE16(seg + i + 1));
+                    i += 1 + tableSize;
+                }
+            }
+            else if (marker == 0xDD)
+            {
+                if (segSize < 2) return false;
+                restartInterval = getBE16(seg);
+            }
+            else if (marker == 0xDA)
+            {
+                if ((nComponents == 0) || (segSize < 1)) return false;
+
+                const size_t nScan = seg[0];
+                if ((nScan == 0) || (nScan > nComponents) || (segSize < (4 + nScan * 2))) return false;
+
+                const unsigned ss = seg[1 + nScan * 2];
+                const unsigned ah = seg[3 + nScan * 2] >> 4;
+                const unsigned al = seg[3 + nScan * 2] & 0x0F;
+
+                // scan index to component index, the first component is the luminance
+                size_t scanComp[4];
+                bool hasY = false;
+
+                for (size_t i = 0; i < nScan; ++i)
+                {
+                    size_t k = 0;
+                    while ((k < nComponents) && (components[k].id != seg[1 + i * 2])) ++k;
+                    if (k == nComponents) return false;
+
+                    scanComp[i] = k;
+                    if (k == 0) hasY = true;
+                }
+
+                if (hasY && (ss == 0) && (ah == 0))
+                {
+                    unsigned hMax = 1;
+                    unsigned vMax = 1;
+
+                    for (size_t i = 0; i < nComponents; ++i)
+                    {
+                        hMax = std::max(hMax, components[i].h);
+                        vMax = std::max(vMax, components[i].v);
+                    }
+
+                    const auto& y = components[0];
+                    const size_t blocksX = ((width * y.h + hMax - 1) / hMax + 7) / 8;
+                    const size_t blocksY = ((height * y.v + vMax - 1) / vMax + 7) / 8;
+
+                    // a single component scan is not interleaved, an MCU is one block
+                    const bool interleaved = (nScan > 1);
+                    const size_t mcusX = (interleaved ? ((width + 8 * hMax - 1) / (8 * hMax)) : blocksX);
+                    const size_t mcusY = (interleaved ? ((height + 8 * vMax - 1) / (8 * vMax)) : blocksY);
+                    const size_t gridWidth = (interleaved ? mcusX * y.h : blocksX);
+
+                    std::vector<int32_t> grid(gridWidth * (interleaved ? mcusY * y.v : blocksY), 0);
+
+                    const HuffmanTable* dc[4];
+                    const HuffmanTable* ac[4];
+
+                    for (size_t i = 0; i < nScan; ++i)
+                    {
+                        dc[i] = &dcTables[(seg[2 + i * 2] >> 4) & 0x03];
+                        ac[i] = &acTables[seg[2 + i * 2] & 0x03];
+
+                        if (!dc[i]->valid || (!progressive && !ac[i]->valid)) return false;
+                    }
+
+                    BitReader reader(data + pos + 2 + len, data + size);
+                    int32_t pred[4] = { 0, 0, 0, 0 };
+                    size_t nMcus = 0;
+
+                    for (size_t my = 0; my < mcusY; ++my)
+                    {
+                        for (size_t mx = 0; mx < mcusX; ++mx)
+                        {
+                            if ((restartInterval > 0) && (nMcus > 0) && ((nMcus % restartInterval) == 0))
+                            {
+                                reader.restart();
+                                for (auto& p : pred) p = 0;
+                            }
+
+                            for (size_t i = 0; i < nScan; ++i)
+                            {
+                                const auto& c = components[scanComp[i]];
+                                const unsigned nh = (interleaved ? c.h : 1);
+                                const unsigned nv = (interleaved ? c.v : 1);
+
+                                for (unsigned bv = 0; bv < nv; ++bv)
+                                {
+                                    for (unsigned bh = 0; bh < nh; ++bh)
+                                    {
+                                        const int s = reader.decode(*dc[i]);
+                                        if (s > 16) throw DecodeError();
+
+                                        pred[i] += extend(reader.bits((unsigned)s), (unsigned)s);
+
+                                        // the AC coefficients are decoded only to get to the next block
+                                        for (size_t k = 1; !progressive && (k < 64); ++k)
+                                        {
+                                            const int rs = reader.decode(*ac[i]);
+                                            const unsigned r = (unsigned)rs >> 4;
+                                            const unsigned acSize = (unsigned)rs & 0x0F;
+
+                                            if (acSize == 0)
+                                            {
+                                                if (r != 15) break;
+                                                k += 15;
+                                            }
+                                            else
+                                            {
+                                                k += r;
+                                                reader.bits(acSize);
+                                            }
+                                        }
+
+                                        if (scanComp[i] == 0) grid[(my * nv + bv) * gridWidth + (mx * nh + bh)] = (pred[i] * (1 << al)) * q0[c.tq];
+                                    }
+                                }
+                            }
+
+                            ++nMcus;
+                        }
+                    }
+
+                    // without the padding blocks of the MCUs
+                    std::vector<int32_t> image(blocksX * blocksY);
+                    for (size_t by = 0; by < blocksY; ++by) std::memcpy(image.data() + by * blocksX, grid.data() + by * gridWidth, blocksX * sizeof(int32_t));
+
+                    return differenceHash(image, blocksX, blocksY, hash);
+                }
+
+                // skips the entropy coded data of this scan up to the next marker
+                pos += 2 + len;
+                while (((pos + 1) < size) && ((data[pos] != 0xFF) || (data[pos + 1] == 0x00) || ((data[pos + 1] >= 0xD0) && (data[pos + 1] <= 0xD7)))) ++pos;
+                continue;
+            }
+
+            pos += 2 + len;
+        }
+    }
+    catch (const DecodeError&)
+    {}
+
+    return false;
+}
+
+int util::hammingDistance(uint64_t a, uint64_t b)
+{
+    return (int)std::bitset<64>(a ^ b).count();
+}
@@ -0,0 +1,34 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_IMAGEHASH_H
+#define IG_MDW_IMAGEHASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace util
+{
+    // The EXIF block (APP1) is limited to 64KiB and comes right after SOI and APP0, so this many bytes of the start of
+    // a JPEG file contain it completely.
+    constexpr size_t exifHeadSize = 128 * 1024;
+
+    // Locates the JPEG thumbnail in the EXIF block of a JPEG file. data has to start at the begin of the file. Returns
+    // false if there is no thumbnail or it's not completely in data.
+    bool exifThumbnail(const uint8_t* data, size_t size, const uint8_t*& thumbnail, size_t& thumbnailSize);
+
+    // Perceptual 64 bit hash (difference hash) of the luminance of a JPEG image. Only the DC coefficients (1/8 scale)
+    // are decoded, of progressive images only the first DC scan. Returns false if the image is not a baseline or
+    // progressive Huffman coded JPEG, smaller than 72x64 pixels, or has too little structure to be told apart from
+    // other images (plain, or a single gradient).
+    bool jpegHash(const uint8_t* data, size_t size, uint64_t& hash);
+
+    int hammingDistance(uint64_t a, uint64_t b);
+}
+
+
+#endif // IG_MDW_IMAGEHASH_H
@@ -0,0 +1,366 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "inflate.h"
+
+
+namespace
+{
+    constexpr size_t inSize = 64 * 1024;
+    constexpr size_t window = 32 * 1024;
+    constexpr size_t outSize = window + 256 * 1024;
+    constexpr unsigned fastBits = 9;
+
+    const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // thrown on corrupt data, end of input or an aborting sink, caught by util::Inflater::inflate()
+    struct InflateError {};
+
+    uint32_t reverse(uint32_t code, unsigned length)
+    {
+        uint32_t r = 0;
+
+        for (unsigned i = 0; i < length; ++i)
+        {
+            r = (r << 1) | (code & 1);
+            code >>= 1;
+        }
+
+        return r;
+    }
+}
+
+
+
+util::Inflater::Inflater()
+    : m_source(nullptr), m_sink(nullptr), m_in(inSize), m_inPos(0), m_inEnd(0), m_bitBuffer(0), m_bitCount(0), m_out(outSize), m_outPos(0), m_flushed(0), m_total(0)
+{
+    uint8_t lengths[288];
+
+    for (size_t i = 0; i < 144; ++i) lengths[i] = 8;
+    for (size_t i = 144; i < 256; ++i) lengths[i] = 9;
+    for (size_t i = 256; i < 280; ++i) lengths[i] = 7;
+    for (size_t i = 280; i < 288; ++i) lengths[i] = 8;
+    build(m_fixedLen, lengths, 288);
+
+    for (size_t i = 0; i < 30; ++i) lengths[i] = 5;
+    build(m_fixedDist, lengths, 30);
+}
+
+bool util::Inflater::inflate(const source_t& source, const sink_t& sink)
+{
+    m_source = &source;
+    m_sink = &sink;
+    m_inPos = 0;
+    m_inEnd = 0;
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    m_outPos = 0;
+    m_flushed = 0;
+    m_total = 0;
+
+    bool r = true;
+
+    try
+    {
+        bool last;
+
+        do
+        {
+            last = (bits(1) != 0);
+            const uint32_t type = bits(2);
+
+            if (type == 0) stored();
+            else if (type == 1) codes(m_fixedLen, m_fixedDist);
+            else if (type == 2) dynamic();
+            else throw InflateError();
+        }
+        while (!last);
+
+        flush(true);
+    }
+    catch (const InflateError&)
+    {
+        r = false;
+    }
+
+    m_source = nullptr;
+    m_sink = nullptr;
+
+    return r;
+}
+
+// canonical code of the lengths, returns false if the code is over-subscribed (incomplete codes are accepted, decoding
+// an unused code fails)
+bool util::Inflater::build(Huffman& h, const uint8_t* lengths, size_t n) const
+{
+    std::memset(h.count, 0, sizeof(h.count));
+    std::memset(h.fast, 0, sizeof(h.fast));
+
+    for (size_t i = 0; i < n; ++i) ++h.count[lengths[i]];
+
+    int left = 1;
+
+    for (size_t len = 1; len < 16; ++len)
+    {
+        left <<= 1;
+        left -= h.count[len];
+        if (left < 0) return false;
+    }
+
+    uint16_t offset[16];
+    uint32_t next[16];
+    uint32_t code = 0;
+
+    offset[1] = 0;
+    next[1] = 0;
+
+    for (size_t len = 1; len < 15; ++len) offset[len + 1] = offset[len] + h.count[len];
+
+    for (size_t len = 2; len < 16; ++len)
+    {
+        code = (code + h.count[len - 1]) << 1;
+        next[len] = code;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const unsigned len = lengths[i];
+        if (len == 0) continue;
+
+        h.symbol[offset[len]++] = (uint16_t)i;
+
+        const uint32_t c = next[len]++;
+
+        if (len <= fastBits)
+        {
+            for (uint32_t k = reverse(c, len); k < (1u << fastBits); k += (1u << len)) h.fast[k] = (uint16_t)((i << 4) | len);
+        }
+    }
+
+    return true;
+}
+
+bool util::Inflater::fill()
+{
+    m_inPos = 0;
+    m_inEnd = (*m_source)(m_in.data(), m_in.size());
+
+    return (m_inEnd > 0);
+}
+
+uint32_t util::Inflater::bits(unsigned n)
+{
+    while (m_bitCount < n)
+    {
+        if ((m_inPos == m_inEnd) && !fill()) throw InflateError();
+
+        m_bitBuffer |= (uint64_t)m_in[m_inPos++] << m_bitCount;
+        m_bitCount += 8;
+    }
+
+    const uint32_t r = (uint32_t)(m_bitBuffer & ((1ull << n) - 1));
+    m_bitBuffer >>= n;
+    m_bitCount -= n;
+
+    return r;
+}
+
+int util::Inflater::decode(const Huffman& h)
+{
+    // up to the longest code, less at the end of the input
+    while ((m_bitCount < 15) && ((m_inPos < m_inEnd) || fill()))
+    {
+        m_bitBuffer |= (uint64_t)m_in[m_inPos++] << m_bitCount;
+        m_bitCount += 8;
+    }
+
+    const uint16_t entry = h.fast[m_bitBuffer & ((1u << fastBits) - 1)];
+
+    if (entry != 0)
+    {
+        const unsigned len = entry & 0x0F;
+        if (len > m_bitCount) throw InflateError();
+
+        m_bitBuffer >>= len;
+        m_bitCount -= len;
+
+        return (entry >> 4);
+    }
+
+    // longer codes bit by bit
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (size_t len = 1; len < 16; ++len)
+    {
+        code |= (int)bits(1);
+        const int count = h.count[len];
+
+        if ((code - count) < first) return h.symbol[index + (code - first)];
+
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    throw InflateError();
+}
+
+void util::Inflater::stored()
+{
+    // the rest of the current byte is skipped
+    m_bitBuffer >>= (m_bitCount & 7);
+    m_bitCount -= (m_bitCount & 7);
+
+    size_t len = bits(16);
+    if (len != (~bits(16) & 0xFFFF)) throw InflateError();
+
+    while ((len > 0) && (m_bitCount >= 8))
+    {
+        put((uint8_t)m_bitBuffer);
+        m_bitBuffer >>= 8;
+        m_bitCount -= 8;
+        --len;
+    }
+
+    while (len > 0)
+    {
+        if (m_outPos == m_out.size()) flush(false);
+        if ((m_inPos == m_inEnd) && !fill()) throw InflateError();
+
+        const size_t n = std::min(len, std::min(m_inEnd - m_inPos, m_out.size() - m_outPos));
+
+        std::memcpy(m_out.data() + m_outPos, m_in.data() + m_inPos, n);
+        m_inPos += n;
+        m_outPos += n;
+        m_total += n;
+        len -= n;
+    }
+}
+
+void util::Inflater::codes(const Huffman& len, const Huffman& dist)
+{
+    while (true)
+    {
+        int symbol = decode(len);
+
+        if (symbol < 256) put((uint8_t)symbol);
+        else if (symbol == 256) break;
+        else
+        {
+            symbol -= 257;
+            if (symbol >= 29) throw InflateError();
+
+            size_t length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+
+            symbol = decode(dist);
+            if (symbol >= 30) throw InflateError();
+
+            const size_t distance = distBase[symbol] + bits(distExtra[symbol]);
+            if (distance > m_total) throw InflateError();
+
+            // the window is kept in front of m_outPos, see flush()
+            while (length > 0)
+            {
+                if (m_outPos == m_out.size()) flush(false);
+
+                const size_t n = std::min(length, m_out.size() - m_outPos);
+                uint8_t* const dst = m_out.data() + m_outPos;
+                const uint8_t* const src = dst - distance;
+
+                if (distance >= n) std::memcpy(dst, src, n);
+                else for (size_t i = 0; i < n; ++i) dst[i] = src[i];
+
+                m_outPos += n;
+                m_total += n;
+                length -= n;
+            }
+        }
+    }
+}
+
+void util::Inflater::dynamic()
+{
+    const size_t nLen = bits(5) + 257;
+    const size_t nDist = bits(5) + 1;
+    const size_t nCode = bits(4) + 4;
+
+    if ((nLen > 286) || (nDist > 30)) throw InflateError();
+
+    uint8_t lengths[286 + 30];
+
+    for (size_t i = 0; i < 19; ++i) lengths[codeLengthOrder[i]] = (uint8_t)(i < nCode ? bits(3) : 0);
+    if (!build(m_len, lengths, 19)) throw InflateError();
+
+    size_t index = 0;
+
+    while (index < (nLen + nDist))
+    {
+        const int symbol = decode(m_len);
+
+        if (symbol < 16) lengths[index++] = (uint8_t)symbol;
+        else
+        {
+            uint8_t len = 0;
+            size_t repeat;
+
+            if (symbol == 16)
+            {
+                if (index == 0) throw InflateError();
+                len = lengths[index - 1];
+                repeat = 3 + bits(2);
+            }
+            else if (symbol == 17) repeat = 3 + bits(3);
+            else repeat = 11 + bits(7);
+
+            if ((index + repeat) > (nLen + nDist)) throw InflateError();
+
+            while (repeat-- > 0) lengths[index++] = len;
+        }
+    }
+
+    // there has to be an end of block code
+    if (lengths[256] == 0) throw InflateError();
+
+    if (!build(m_len, lengths, nLen) || !build(m_dist, lengths + nLen, nDist)) throw InflateError();
+
+    codes(m_len, m_dist);
+}
+
+void util::Inflater::put(uint8_t byte)
+{
+    if (m_outPos == m_out.size()) flush(false);
+
+    m_out[m_outPos++] = byte;
+    ++m_total;
+}
+
+// passes the new output to the sink, and if it's not the final flush moves the window to the front of the buffer
+void util::Inflater::flush(bool final)
+{
+    if ((m_outPos > m_flushed) && !(*m_sink)(m_out.data() + m_flushed, m_outPos - m_flushed)) throw InflateError();
+
+    if (!final && (m_outPos > window))
+    {
+        std::memmove(m_out.data(), m_out.data() + m_outPos - window, window);
+        m_outPos = window;
+    }
+
+    m_flushed = m_outPos;
+}
@@ -0,0 +1,79 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_INFLATE_H
+#define IG_MDW_INFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+namespace util
+{
+    // Streaming decoder of raw deflate data (RFC 1951, zip compression method 8). The input is pulled through source,
+    // the output is passed to sink in chunks, only the 32KiB window is kept.
+    class Inflater
+    {
+    public:
+        // fills the buffer with up to size bytes and returns the number of bytes, 0 at the end of the input or on error
+        typedef std::function<size_t(uint8_t* buffer, size_t size)> source_t;
+
+        // returns false to abort
+        typedef std::function<bool(const uint8_t* data, size_t size)> sink_t;
+
+    public:
+        Inflater();
+        virtual ~Inflater() {}
+
+        Inflater(const Inflater& other) = delete;
+        Inflater& operator=(const Inflater& other) = delete;
+
+        // Decodes one deflate stream. Returns false if the data is corrupt, the input ends early or sink aborted.
+        bool inflate(const source_t& source, const sink_t& sink);
+
+        // number of bytes passed to sink by the last call to inflate()
+        uint64_t size() const { return m_total; }
+
+    private:
+        struct Huffman
+        {
+            uint16_t count[16];     // number of codes of each length
+            uint16_t symbol[288];   // symbols ordered by code
+            uint16_t fast[512];     // symbol << 4 | length for codes of up to 9 bits, 0 for longer codes
+        };
+
+        const source_t* m_source;
+        const sink_t* m_sink;
+        std::vector<uint8_t> m_in;
+        size_t m_inPos;
+        size_t m_inEnd;
+        uint64_t m_bitBuffer;
+        unsigned m_bitCount;
+        std::vector<uint8_t> m_out;
+        size_t m_outPos;
+        size_t m_flushed;
+        uint64_t m_total;
+        Huffman m_fixedLen;
+        Huffman m_fixedDist;
+        Huffman m_len;
+        Huffman m_dist;
+
+        bool build(Huffman& h, const uint8_t* lengths, size_t n) const;
+        bool fill();
+        uint32_t bits(unsigned n);
+        int decode(const Huffman& h);
+        void stored();
+        void codes(const Huffman& len, const Huffman& dist);
+        void dynamic();
+        void put(uint8_t byte);
+        void flush(bool final);
+    };
+}
+
+
+#endif // IG_MDW_INFLATE_H
@@ -0,0 +1,139 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "json.h"
+
+
+namespace
+{
+    constexpr size_t indentWidth = 2;
+}
+
+
+
+util::JsonWriter& util::JsonWriter::beginObject(const std::string& key)
+{
+    next(key);
+    m_json += '{';
+    m_first = true;
+    ++m_level;
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::endObject()
+{
+    --m_level;
+    if (!m_first) m_json += '\n' + std::string(m_level * indentWidth, ' ');
+    m_json += '}';
+    m_first = false;
+    if (m_level == 0) m_json += '\n';
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::beginArray(const std::string& key)
+{
+    next(key);
+    m_json += '[';
+    m_first = true;
+    ++m_level;
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::endArray()
+{
+    --m_level;
+    if (!m_first) m_json += '\n' + std::string(m_level * indentWidth, ' ');
+    m_json += ']';
+    m_first = false;
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::value(const std::string& key, const std::string& value)
+{
+    next(key);
+    m_json += '"' + escape(value) + '"';
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::value(const std::string& key, uint64_t value)
+{
+    next(key);
+    m_json += std::to_string(value);
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::value(const std::string& key, int value)
+{
+    next(key);
+    m_json += std::to_string(value);
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::value(const std::string& key, double value)
+{
+    next(key);
+
+    if (std::isfinite(value))
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+        m_json += buffer;
+    }
+    else m_json += "null";
+
+    return (*this);
+}
+
+util::JsonWriter& util::JsonWriter::value(const std::string& key, bool value)
+{
+    next(key);
+    m_json += (value ? "true" : "false");
+    return (*this);
+}
+
+std::string util::JsonWriter::escape(const std::string& str)
+{
+    std::string r;
+    r.reserve(str.length());
+
+    for (const char c : str)
+    {
+        switch (c)
+        {
+        case '"': r += "\\\""; break;
+        case '\\': r += "\\\\"; break;
+        case '\b': r += "\\b"; break;
+        case '\f': r += "\\f"; break;
+        case '\n': r += "\\n"; break;
+        case '\r': r += "\\r"; break;
+        case '\t': r += "\\t"; break;
+
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned int)(unsigned char)c);
+                r += buffer;
+            }
+            else r += c;
+            break;
+        }
+    }
+
+    return r;
+}
+
+void util::JsonWriter::next(const std::string& key)
+{
+    if (!m_first) m_json += ',';
+    if (m_level > 0) m_json += '\n' + std::string(m_level * indentWidth, ' ');
+    if (!key.empty()) m_json += '"' + escape(key) + "\": ";
+    m_first = false;
+}
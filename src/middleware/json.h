@@ -0,0 +1,51 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_JSON_H
+#define IG_MDW_JSON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace util
+{
+    // Minimal JSON writer, the structure is not checked (the caller is responsible for the order of the calls).
+    class JsonWriter
+    {
+    public:
+        JsonWriter() : m_json(), m_first(true), m_level(0) {}
+        virtual ~JsonWriter() {}
+
+        JsonWriter& beginObject(const std::string& key = std::string());
+        JsonWriter& endObject();
+        JsonWriter& beginArray(const std::string& key = std::string());
+        JsonWriter& endArray();
+
+        JsonWriter& value(const std::string& key, const std::string& value);
+        JsonWriter& value(const std::string& key, const char* value) { return this->value(key, std::string(value)); }
+        JsonWriter& value(const std::string& key, uint64_t value);
+        JsonWriter& value(const std::string& key, int value);
+        JsonWriter& value(const std::string& key, double value);
+        JsonWriter& value(const std::string& key, bool value);
+
+        const std::string& str() const { return m_json; }
+
+        static std::string escape(const std::string& str);
+
+    private:
+        std::string m_json;
+        bool m_first;
+        size_t m_level;
+
+        void next(const std::string& key);
+    };
+}
+
+
+#endif // IG_MDW_JSON_H
@@ -0,0 +1,84 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+#include <omw/defs.h>
+
+#ifdef OMW_PLAT_UNIX
+#define MAPPEDFILE_MMAP (1)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+}
+
+
+
+bool util::MappedFile::open(const std::string& file)
+{
+    close();
+
+#ifdef MAPPEDFILE_MMAP
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool r = (fstat(fd, &st) == 0);
+
+    if (r && (st.st_size > 0))
+    {
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (p != MAP_FAILED)
+        {
+            m_data = (const uint8_t*)p;
+            m_size = (size_t)st.st_size;
+        }
+        else r = false;
+    }
+
+    m_open = r;
+
+    ::close(fd);
+
+    return r;
+#else
+    std::ifstream ifs(file, std::ios::in | std::ios::binary);
+    if (!ifs.good()) return false;
+
+    m_buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    m_open = true;
+
+    return true;
+#endif
+}
+
+void util::MappedFile::close()
+{
+#ifdef MAPPEDFILE_MMAP
+    if (m_data) munmap((void*)m_data, m_size);
+#else
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
@@ -0,0 +1,45 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_MAPPEDFILE_H
+#define IG_MDW_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace util
+{
+    // Read only view of a whole file. The file is memory mapped on Unix and read into a buffer on other platforms.
+    class MappedFile
+    {
+    public:
+        MappedFile() : m_data(nullptr), m_size(0), m_open(false) {}
+        virtual ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile& other) = delete;
+        MappedFile& operator=(const MappedFile& other) = delete;
+
+        // returns false if the file can't be opened
+        bool open(const std::string& file);
+        void close();
+
+        bool isOpen() const { return m_open; }
+        const uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        bool m_open;
+        std::vector<uint8_t> m_buffer;
+    };
+}
+
+
+#endif // IG_MDW_MAPPEDFILE_H
@@ -0,0 +1,112 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "ratelimit.h"
+
+
+namespace
+{
+    constexpr double burst = 0.25;      // seconds of tokens the pool can hold
+    constexpr uint64_t shareDiv = 16;   // a bucket takes 1/16 s of tokens
+}
+
+
+
+util::RateLimiter::Bucket::~Bucket()
+{
+    if (m_limiter && ((m_bytes > 0) || (m_ops > 0))) m_limiter->giveBack(m_bytes, m_ops);
+}
+
+void util::RateLimiter::Bucket::consume(uint64_t bytes, uint64_t ops)
+{
+    if (!m_limiter) return;
+
+    const uint64_t limitedBytes = (m_limiter->m_bytesPerSecond == unlimited ? 0 : bytes);
+    const uint64_t limitedOps = (m_limiter->m_opsPerSecond == unlimited ? 0 : ops);
+
+    if ((limitedBytes > m_bytes) || (limitedOps > m_ops))
+    {
+        const uint64_t needBytes = (limitedBytes > m_bytes ? limitedBytes - m_bytes : 0);
+        const uint64_t needOps = (limitedOps > m_ops ? limitedOps - m_ops : 0);
+
+        m_limiter->take(needBytes, needOps, m_bytes, m_ops);
+    }
+
+    m_bytes -= limitedBytes;
+    m_ops -= limitedOps;
+
+    // counted after the wait, so that the totals follow the limited rate
+    m_limiter->m_bytesTotal += bytes;
+    m_limiter->m_opsTotal += ops;
+}
+
+
+
+util::RateLimiter::RateLimiter(uint64_t bytesPerSecond, uint64_t opsPerSecond)
+    : m_bytesPerSecond(bytesPerSecond), m_opsPerSecond(opsPerSecond),
+    m_last(clock::now()), m_bytes((double)bytesPerSecond * burst), m_ops((double)opsPerSecond * burst),
+    m_bytesTotal(0), m_opsTotal(0), m_throttledNs(0)
+{}
+
+void util::RateLimiter::take(uint64_t needBytes, uint64_t needOps, uint64_t& bytes, uint64_t& ops)
+{
+    double wait = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+
+        refill(clock::now());
+
+        if (needBytes > 0)
+        {
+            const uint64_t share = std::max<uint64_t>(needBytes, m_bytesPerSecond / shareDiv);
+            m_bytes -= (double)share;
+            bytes += share;
+
+            if (m_bytes < 0) wait = std::max(wait, -m_bytes / (double)m_bytesPerSecond);
+        }
+
+        if (needOps > 0)
+        {
+            const uint64_t share = std::max<uint64_t>(needOps, m_opsPerSecond / shareDiv);
+            m_ops -= (double)share;
+            ops += share;
+
+            if (m_ops < 0) wait = std::max(wait, -m_ops / (double)m_opsPerSecond);
+        }
+    }
+
+    if (wait > 0)
+    {
+        const auto ns = std::chrono::nanoseconds((int64_t)(wait * 1e9));
+        m_throttledNs += (uint64_t)ns.count();
+        std::this_thread::sleep_for(ns);
+    }
+}
+
+void util::RateLimiter::giveBack(uint64_t bytes, uint64_t ops)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    refill(clock::now());
+
+    if (m_bytesPerSecond != unlimited) m_bytes = std::min(m_bytes + (double)bytes, (double)m_bytesPerSecond * burst);
+    if (m_opsPerSecond != unlimited) m_ops = std::min(m_ops + (double)ops, (double)m_opsPerSecond * burst);
+}
+
+void util::RateLimiter::refill(clock::time_point now)
+{
+    const double elapsed = std::chrono::duration<double>(now - m_last).count();
+    m_last = now;
+
+    if (m_bytesPerSecond != unlimited) m_bytes = std::min(m_bytes + (elapsed * (double)m_bytesPerSecond), (double)m_bytesPerSecond * burst);
+    if (m_opsPerSecond != unlimited) m_ops = std::min(m_ops + (elapsed * (double)m_opsPerSecond), (double)m_opsPerSecond * burst);
+}
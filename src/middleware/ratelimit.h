@@ -0,0 +1,91 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_RATELIMIT_H
+#define IG_MDW_RATELIMIT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+
+namespace util
+{
+    // Token bucket limiting the bytes and I/O operations per second of all threads together.
+    //
+    // The threads don't take tokens from the global pool for every chunk. A util::RateLimiter::Bucket takes a share of
+    // about 1/16 s from the pool and consumes it locally, the rest is returned when the bucket is destroyed. The global
+    // pool may go into debt, the thread which took the tokens then sleeps until the debt is paid back, so that chunks
+    // larger than the burst size are possible.
+    class RateLimiter
+    {
+    public:
+        // tokens of one thread, a new bucket per copied file is fine
+        class Bucket
+        {
+        public:
+            Bucket() = delete;
+            explicit Bucket(util::RateLimiter* limiter) : m_limiter(limiter), m_bytes(0), m_ops(0) {}
+            virtual ~Bucket();
+
+            Bucket(const Bucket& other) = delete;
+            Bucket& operator=(const Bucket& other) = delete;
+
+            // Consumes the tokens, blocks if the rate is exceeded. Is a nop if the limiter is nullptr. Called after the
+            // I/O has been done, so the actual number of bytes can be passed.
+            void consume(uint64_t bytes, uint64_t ops);
+
+        private:
+            util::RateLimiter* m_limiter;
+            uint64_t m_bytes;
+            uint64_t m_ops;
+        };
+
+        static constexpr uint64_t unlimited = 0;
+
+    public:
+        RateLimiter() = delete;
+        RateLimiter(uint64_t bytesPerSecond, uint64_t opsPerSecond);
+        virtual ~RateLimiter() {}
+
+        RateLimiter(const RateLimiter& other) = delete;
+        RateLimiter& operator=(const RateLimiter& other) = delete;
+
+        uint64_t bytesPerSecond() const { return m_bytesPerSecond; }
+        uint64_t opsPerSecond() const { return m_opsPerSecond; }
+
+        // totals since construction, can be read while other threads are consuming
+        uint64_t bytes() const { return m_bytesTotal.load(); }
+        uint64_t ops() const { return m_opsTotal.load(); }
+        double throttled() const { return (double)m_throttledNs.load() / 1e9; } // sum of the time the threads have waited, in seconds
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        const uint64_t m_bytesPerSecond;
+        const uint64_t m_opsPerSecond;
+
+        std::mutex m_mtx;
+        clock::time_point m_last;   // last refill, guarded by m_mtx
+        double m_bytes;             // tokens of the pool, negative is debt, guarded by m_mtx
+        double m_ops;               // guarded by m_mtx
+
+        std::atomic<uint64_t> m_bytesTotal;
+        std::atomic<uint64_t> m_opsTotal;
+        std::atomic<uint64_t> m_throttledNs;
+
+        // takes at least the needed tokens from the pool and adds them to the bucket, blocks while the pool is in debt
+        void take(uint64_t needBytes, uint64_t needOps, uint64_t& bytes, uint64_t& ops);
+
+        void giveBack(uint64_t bytes, uint64_t ops);
+        void refill(clock::time_point now);
+    };
+}
+
+
+#endif // IG_MDW_RATELIMIT_H
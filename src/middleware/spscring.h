@@ -0,0 +1,107 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_SPSCRING_H
+#define IG_MDW_SPSCRING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace util
+{
+    // Lock free ring buffer of a fixed capacity between one producer and one consumer thread. tryPush() and tryPop()
+    // don't block, if the ring is full or empty the caller does something else or waits (see util::Backoff). The
+    // capacity limits the memory between two stages of a pipeline.
+    template <typename T>
+    class SpscRing
+    {
+    public:
+        SpscRing() = delete;
+
+        // the capacity is rounded up to a power of 2
+        explicit SpscRing(size_t capacity)
+            : m_slots(roundUp(capacity)), m_mask(m_slots.size() - 1), m_head(0), m_tail(0)
+        {}
+
+        virtual ~SpscRing() {}
+
+        SpscRing(const SpscRing& other) = delete;
+        SpscRing& operator=(const SpscRing& other) = delete;
+
+        // producer only, returns false if the ring is full (value is not moved then)
+        bool tryPush(T&& value)
+        {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if ((tail - m_head.load(std::memory_order_acquire)) == m_slots.size()) return false;
+
+            m_slots[tail & m_mask] = std::move(value);
+            m_tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // consumer only, returns false if the ring is empty
+        bool tryPop(T& value)
+        {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire)) return false;
+
+            value = std::move(m_slots[head & m_mask]);
+            m_head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // exact on the consumer thread
+        bool empty() const { return (m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire)); }
+
+        size_t capacity() const { return m_slots.size(); }
+
+    private:
+        std::vector<T> m_slots;
+        size_t m_mask;
+        alignas(64) std::atomic<size_t> m_head; // written by the consumer
+        alignas(64) std::atomic<size_t> m_tail; // written by the producer
+
+        static size_t roundUp(size_t n)
+        {
+            size_t r = 1;
+            while (r < n) r <<= 1;
+            return r;
+        }
+    };
+
+    // Waiting of a pipeline stage on a full or empty util::SpscRing, yields first and then sleeps up to 1ms, so that a
+    // stage waiting long (e.g. for an answer of the user) doesn't spin.
+    class Backoff
+    {
+    public:
+        Backoff() : m_n(0) {}
+        virtual ~Backoff() {}
+
+        void wait()
+        {
+            if (m_n < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(m_n < 128 ? 50 : 1000));
+
+            if (m_n < 128) ++m_n;
+        }
+
+        // call after the stage had work again
+        void reset() { m_n = 0; }
+
+    private:
+        unsigned m_n;
+    };
+}
+
+
+#endif // IG_MDW_SPSCRING_H
@@ -0,0 +1,200 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "syncer.h"
+
+#include <omw/defs.h>
+
+#ifdef OMW_PLAT_UNIX
+#define SYNCER_POSIX (1)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+#ifdef SYNCER_POSIX
+    std::error_code lastError() { return std::error_code(errno, std::generic_category()); }
+
+    int fdatasync_(int fd)
+    {
+#ifdef __APPLE__
+        return ::fsync(fd);
+#else
+        return ::fdatasync(fd);
+#endif
+    }
+#endif
+}
+
+
+
+util::Syncer::Syncer(size_t batchSize, double interval)
+    : m_batchSize(std::max<size_t>(batchSize, 1)), m_interval(interval), m_nBusy(0), m_count(0), m_flushing(false), m_stop(false)
+{
+    m_thread = std::thread(&Syncer::run, this);
+}
+
+util::Syncer::~Syncer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+    }
+
+    m_cvWork.notify_all();
+    m_thread.join();
+}
+
+bool util::Syncer::add(int fd, std::error_code& ec)
+{
+    ec.clear();
+
+#ifdef SYNCER_POSIX
+#ifdef __linux__
+    // starts writing without waiting, errors are reported by fdatasync
+    sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+#endif
+
+    const int dupFd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+    if (dupFd < 0)
+    {
+        ec = lastError();
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mtx);
+
+    m_cvDone.wait(lock, [this]() { return ((m_queue.size() + m_nBusy) < (4 * m_batchSize)); });
+
+    m_queue.push_back(dupFd);
+
+    if (m_queue.size() >= m_batchSize) m_cvWork.notify_one();
+#else
+    (void)fd;
+#endif
+
+    return true;
+}
+
+bool util::Syncer::flush(std::error_code& ec)
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+
+    // the thread doesn't wait for a full batch while flushing
+    m_flushing = true;
+    m_cvWork.notify_one();
+    m_cvDone.wait(lock, [this]() { return (m_queue.empty() && (m_nBusy == 0)); });
+    m_flushing = false;
+
+    ec = m_ec;
+    m_ec.clear();
+
+    return !ec;
+}
+
+size_t util::Syncer::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_count;
+}
+
+void util::Syncer::run()
+{
+    std::vector<int> batch;
+    std::unique_lock<std::mutex> lock(m_mtx);
+
+    while (!m_stop || !m_queue.empty())
+    {
+        m_cvWork.wait_for(lock, m_interval, [this]() { return (m_stop || (!m_queue.empty() && (m_flushing || (m_queue.size() >= m_batchSize)))); });
+
+        if (m_queue.empty()) continue;
+
+        batch.swap(m_queue);
+        m_nBusy = batch.size();
+
+        lock.unlock();
+
+        std::error_code ec;
+
+#ifdef SYNCER_POSIX
+        for (const int fd : batch)
+        {
+            if ((fdatasync_(fd) != 0) && !ec) ec = lastError();
+            ::close(fd);
+        }
+#endif
+
+        lock.lock();
+
+        m_count += batch.size();
+        m_nBusy = 0;
+        if (ec && !m_ec) m_ec = ec;
+        batch.clear();
+
+        m_cvDone.notify_all();
+    }
+}
+
+
+
+bool util::syncPath(const fs::path& path, std::error_code& ec)
+{
+    ec.clear();
+
+#ifdef SYNCER_POSIX
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) ec = lastError();
+    else
+    {
+        if (::fsync(fd) != 0) ec = lastError();
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+
+    return !ec;
+}
+
+bool util::syncFileSystem(const fs::path& path, std::error_code& ec)
+{
+    ec.clear();
+
+#ifdef SYNCER_POSIX
+#ifdef __linux__
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) ec = lastError();
+    else
+    {
+        if (syncfs(fd) != 0) ec = lastError();
+        ::close(fd);
+    }
+#else
+    (void)path;
+    ::sync();
+#endif
+#else
+    (void)path;
+#endif
+
+    return !ec;
+}
@@ -0,0 +1,81 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_SYNCER_H
+#define IG_MDW_SYNCER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+
+namespace util
+{
+    // Flushes written files to their device on a thread of its own, so that the copying threads don't wait for the
+    // device. add() starts the write back of a file (sync_file_range on Linux) and queues a duplicate of its
+    // descriptor, the thread waits until batchSize files are queued or interval has passed and then flushes them with
+    // fdatasync. The writes of a batch reach the device together, and most of their data is already written when it's
+    // flushed.
+    //
+    // Not supported on platforms other than UNIX, add() does nothing there.
+    class Syncer
+    {
+    public:
+        Syncer() = delete;
+
+        // add() blocks while 4 * batchSize descriptors are held
+        Syncer(size_t batchSize, double interval);
+
+        // flushes the queued files, errors are ignored
+        virtual ~Syncer();
+
+        Syncer(const Syncer& other) = delete;
+        Syncer& operator=(const Syncer& other) = delete;
+
+        // Called before the descriptor is closed. May be called from any thread. Returns false if the descriptor can't
+        // be duplicated, the file is not queued then.
+        bool add(int fd, std::error_code& ec);
+
+        // Flushes the queued files and waits for them. Returns false if flushing one of the files added since the
+        // previous call has failed, ec is the first error then.
+        bool flush(std::error_code& ec);
+
+        // number of flushed files
+        size_t count() const;
+
+    private:
+        size_t m_batchSize;
+        std::chrono::duration<double> m_interval;
+        mutable std::mutex m_mtx;
+        std::condition_variable m_cvWork;   // to the thread: files queued or stop
+        std::condition_variable m_cvDone;   // from the thread: queue shrunk or batch flushed
+        std::vector<int> m_queue;           // guarded by m_mtx, as are the members below
+        size_t m_nBusy;                     // files taken from the queue, not yet flushed
+        size_t m_count;
+        std::error_code m_ec;
+        bool m_flushing;
+        bool m_stop;
+        std::thread m_thread;
+
+        void run();
+    };
+
+    // Flushes a file or directory to its device (fsync), a directory is flushed so that the entries of created files
+    // are persistent. Returns false on error, does nothing on platforms other than UNIX.
+    bool syncPath(const std::filesystem::path& path, std::error_code& ec);
+
+    // Flushes the file system containing path (syncfs on Linux, sync on other UNIX platforms). Returns false on error,
+    // does nothing on platforms other than UNIX.
+    bool syncFileSystem(const std::filesystem::path& path, std::error_code& ec);
+}
+
+
+#endif // IG_MDW_SYNCER_H
@@ -5,14 +5,34 @@ copyright       GNU GPLv3 - Copyright (c) 2023 Oliver Blaser
 */
 
 #include <algorithm>
+#include <cerrno>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <vector>
 
 #include "util.h"
 
 #include <omw/omw.h>
 
+#ifdef OMW_PLAT_UNIX
+#include <sys/stat.h>
+#endif
+
+#if defined(OMW_PLAT_UNIX) && defined(__linux__)
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
 
 namespace
 {
@@ -20,6 +40,162 @@ namespace
 
 
 
+util::FileCounter& util::FileCounter::add(const FileCounter& other)
+{
+    m_total += other.total();
+    m_copied += other.copied();
+    m_skipped += other.skipped();
+    m_deduplicated += other.deduplicated();
+    m_bytesCopied += other.bytesCopied();
+
+    return (*this);
+}
+
+util::StringArena::offset_type util::StringArena::add(const std::string_view& str)
+{
+    if ((m_data.size() + str.size()) > (size_t)(std::numeric_limits<offset_type>::max())) throw std::length_error("string arena overflow");
+
+    const offset_type r = (offset_type)(m_data.size());
+    m_data.insert(m_data.end(), str.begin(), str.end());
+
+    return r;
+}
+
+void util::splitFileName(const std::string_view& path, std::string_view& stem, std::string_view& extension)
+{
+#ifdef OMW_PLAT_WIN
+    const size_t sep = path.find_last_of("/\\");
+#else
+    const size_t sep = path.rfind('/');
+#endif
+    const std::string_view name = ((sep == std::string_view::npos) ? path : path.substr(sep + 1));
+    const size_t dot = name.rfind('.');
+
+    if ((dot == std::string_view::npos) || (dot == 0) || (name == ".."))
+    {
+        stem = name;
+        extension = std::string_view();
+    }
+    else
+    {
+        stem = name.substr(0, dot);
+        extension = name.substr(dot);
+    }
+}
+
+bool util::fileExists(const std::string& path)
+{
+#ifdef OMW_PLAT_UNIX
+    struct stat st;
+
+    if (stat(path.c_str(), &st) == 0) return true;
+    if ((errno == ENOENT) || (errno == ENOTDIR)) return false;
+
+    throw std::filesystem::filesystem_error("exists", std::filesystem::u8path(path), std::error_code(errno, std::generic_category()));
+#else
+    return std::filesystem::exists(std::filesystem::u8path(path));
+#endif
+}
+
+bool util::equalFiles(const std::filesystem::path& a, const std::filesystem::path& b)
+{
+    std::error_code ec;
+    const auto sizeA = std::filesystem::file_size(a, ec);
+    if (ec) return false;
+    const auto sizeB = std::filesystem::file_size(b, ec);
+    if (ec || (sizeA != sizeB)) return false;
+
+    std::ifstream ifsA(a, std::ios::binary);
+    std::ifstream ifsB(b, std::ios::binary);
+    if (!ifsA.good() || !ifsB.good()) return false;
+
+    constexpr size_t bufferSize = 64 * 1024;
+    std::vector<char> bufferA(bufferSize);
+    std::vector<char> bufferB(bufferSize);
+
+    bool r = true;
+
+    while (r && ifsA.good() && ifsB.good())
+    {
+        ifsA.read(bufferA.data(), bufferSize);
+        ifsB.read(bufferB.data(), bufferSize);
+
+        const auto n = ifsA.gcount();
+        if ((n != ifsB.gcount()) || (std::memcmp(bufferA.data(), bufferB.data(), (size_t)n) != 0)) r = false;
+    }
+
+    return (r && ifsA.eof() && ifsB.eof());
+}
+
+uint64_t util::deviceId(const std::filesystem::path& file)
+{
+    uint64_t r = 0;
+
+#ifdef OMW_PLAT_UNIX
+    struct stat st;
+    if (stat(file.c_str(), &st) == 0) r = (uint64_t)st.st_dev;
+#endif
+
+    return r;
+}
+
+bool util::fileIdentity(const std::filesystem::path& file, util::FileIdentity& id)
+{
+    bool r = false;
+
+#ifdef OMW_PLAT_UNIX
+    struct stat st;
+
+    if (stat(file.c_str(), &st) == 0)
+    {
+        id.device = (uint64_t)st.st_dev;
+        id.inode = (uint64_t)st.st_ino;
+#ifdef __APPLE__
+        id.mtime = ((int64_t)st.st_mtimespec.tv_sec * 1000000000) + (int64_t)st.st_mtimespec.tv_nsec;
+#else
+        id.mtime = ((int64_t)st.st_mtim.tv_sec * 1000000000) + (int64_t)st.st_mtim.tv_nsec;
+#endif
+        r = true;
+    }
+#endif
+
+    return r;
+}
+
+bool util::physicalOffset(const std::filesystem::path& file, uint64_t& offset)
+{
+    bool r = false;
+
+#if defined(OMW_PLAT_UNIX) && defined(__linux__)
+    const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0)
+    {
+        // only the first extent is mapped
+        alignas(struct fiemap) uint8_t buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = { 0 };
+        struct fiemap* const fm = (struct fiemap*)buffer;
+
+        fm->fm_start = 0;
+        fm->fm_length = FIEMAP_MAX_OFFSET;
+        fm->fm_extent_count = 1;
+
+        constexpr uint32_t notOwnExtent = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_DATA_INLINE;
+
+        if ((ioctl(fd, FS_IOC_FIEMAP, fm) == 0) && (fm->fm_mapped_extents > 0) && ((fm->fm_extents[0].fe_flags & notOwnExtent) == 0))
+        {
+            offset = (uint64_t)(fm->fm_extents[0].fe_physical);
+            r = true;
+        }
+
+        close(fd);
+    }
+#endif
+
+    return r;
+}
+
+
+
 OMW_CONSTEXPR_ON_STDSTRING std::string omw_::rmLeadingZeros(const std::string& str)
 {
     std::string r = str;
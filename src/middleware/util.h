@@ -7,8 +7,13 @@ copyright       GNU GPLv3 - Copyright (c) 2023 Oliver Blaser
 #ifndef IG_MDW_UTIL_H
 #define IG_MDW_UTIL_H
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
 
 
 namespace util
@@ -17,22 +22,77 @@ namespace util
     {
     public:
         using counter_type = size_t;
+        using byte_counter_type = uint64_t;
 
     public:
-        FileCounter() : m_total(0), m_copied(0) {}
+        FileCounter() : m_total(0), m_copied(0), m_skipped(0), m_deduplicated(0), m_bytesCopied(0) {}
         virtual ~FileCounter() {}
 
         FileCounter& add(counter_type total, counter_type copied) { m_total += total; m_copied += copied; return (*this); }
-        FileCounter& add(const FileCounter& other) { return add(other.total(), other.copied()); }
+        FileCounter& add(const FileCounter& other);
         FileCounter& addTotal(counter_type value = 1) { m_total += value; return (*this); }
         FileCounter& addCopied(counter_type value = 1) { m_copied += value; return (*this); }
+        FileCounter& addSkipped(counter_type value = 1) { m_skipped += value; return (*this); }
+        FileCounter& addDeduplicated(counter_type value = 1) { m_deduplicated += value; return (*this); }
+        FileCounter& addBytesCopied(byte_counter_type value) { m_bytesCopied += value; return (*this); }
 
         const counter_type& total() const { return m_total; }
         const counter_type& copied() const { return m_copied; }
+        const counter_type& skipped() const { return m_skipped; }               // not copied on purpose (scheme mismatch, existing destination, near duplicate)
+        const counter_type& deduplicated() const { return m_deduplicated; }     // destination exists with the same content
+        counter_type failed() const { return (m_total - m_copied - m_skipped - m_deduplicated); }
+        const byte_counter_type& bytesCopied() const { return m_bytesCopied; }
 
     private:
         counter_type m_total;
         counter_type m_copied;
+        counter_type m_skipped;
+        counter_type m_deduplicated;
+        byte_counter_type m_bytesCopied;
+    };
+
+    // durations of the processing phases in seconds
+    class PhaseDurations
+    {
+    public:
+        using value_type = double;
+
+    public:
+        PhaseDurations() : m_scan(0), m_plan(0), m_copy(0) {}
+        virtual ~PhaseDurations() {}
+
+        PhaseDurations& add(const PhaseDurations& other) { m_scan += other.scan(); m_plan += other.plan(); m_copy += other.copy(); return (*this); }
+        PhaseDurations& addScan(value_type value) { m_scan += value; return (*this); }
+        PhaseDurations& addPlan(value_type value) { m_plan += value; return (*this); }
+        PhaseDurations& addCopy(value_type value) { m_copy += value; return (*this); }
+
+        const value_type& scan() const { return m_scan; }
+        const value_type& plan() const { return m_plan; }
+        const value_type& copy() const { return m_copy; }
+        value_type total() const { return (m_scan + m_plan + m_copy); }
+
+    private:
+        value_type m_scan;
+        value_type m_plan;
+        value_type m_copy;
+    };
+
+    class Stopwatch
+    {
+    public:
+        using clock_type = std::chrono::steady_clock;
+
+    public:
+        Stopwatch() : m_start(clock_type::now()) {}
+        virtual ~Stopwatch() {}
+
+        void restart() { m_start = clock_type::now(); }
+
+        // seconds
+        double elapsed() const { return std::chrono::duration<double>(clock_type::now() - m_start).count(); }
+
+    private:
+        clock_type::time_point m_start;
     };
 
     class ResultCounter
@@ -51,10 +111,63 @@ namespace util
         void incErrors() { ++m_e; }
         void incWarnings() { ++m_w; }
 
+        ResultCounter& add(const ResultCounter& other) { m_e += other.errors(); m_w += other.warnings(); return (*this); }
+
     private:
         counter_type m_e;
         counter_type m_w;
     };
+
+    // Stores many short strings back to back in one buffer, they are referenced by offset and length.
+    class StringArena
+    {
+    public:
+        using offset_type = uint32_t;
+
+    public:
+        StringArena() {}
+        virtual ~StringArena() {}
+
+        // returns the offset of the appended string, throws std::length_error if the arena would exceed 4GiB
+        offset_type add(const std::string_view& str);
+
+        std::string_view get(offset_type offset, size_t length) const { return std::string_view(m_data.data() + offset, length); }
+
+        size_t size() const { return m_data.size(); }
+        size_t capacity() const { return m_data.capacity(); }
+        void clear() { m_data.clear(); m_data.shrink_to_fit(); }
+
+    private:
+        std::vector<char> m_data;
+    };
+
+    // Stem and extension of the last element of an UTF-8 path, the same as std::filesystem::path::stem() and
+    // extension(), but as views into the path.
+    void splitFileName(const std::string_view& path, std::string_view& stem, std::string_view& extension);
+
+    // Same as std::filesystem::exists(), of an UTF-8 path. On Unix the path is passed to the system as it is, without
+    // a std::filesystem::path. Throws std::filesystem::filesystem_error if the status can't be determined.
+    bool fileExists(const std::string& path);
+
+    // compares the content of two files, returns false if one of them can't be read
+    bool equalFiles(const std::filesystem::path& a, const std::filesystem::path& b);
+
+    // returns the ID of the device containing the file (st_dev), 0 on error or if not supported by the platform
+    uint64_t deviceId(const std::filesystem::path& file);
+
+    struct FileIdentity
+    {
+        uint64_t device;    // st_dev
+        uint64_t inode;     // st_ino
+        int64_t mtime;      // nanoseconds since the epoch
+    };
+
+    // identity and modification time of a file or directory, returns false on error or if not supported by the platform
+    bool fileIdentity(const std::filesystem::path& file, util::FileIdentity& id);
+
+    // Byte offset of the first extent of the file on its device (FIEMAP). Returns false on error, if not supported by
+    // the platform or the file system, or if the file has no extent of its own (empty, inline or not yet allocated).
+    bool physicalOffset(const std::filesystem::path& file, uint64_t& offset);
 }
 
 
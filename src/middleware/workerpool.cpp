@@ -0,0 +1,116 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "workerpool.h"
+
+
+namespace
+{
+}
+
+
+
+util::WorkerPool::WorkerPool(size_t nWorkers)
+    : m_nBusy(0), m_stop(false)
+{
+    if (nWorkers == 0) nWorkers = 1;
+
+    for (size_t i = 0; i < nWorkers; ++i)
+    {
+        m_workers.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+util::WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+    }
+
+    m_cvJob.notify_all();
+
+    for (auto& w : m_workers) w.join();
+}
+
+void util::WorkerPool::submit(const job_type& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_jobs.push_back(job);
+    }
+
+    m_cvJob.notify_one();
+}
+
+void util::WorkerPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cvDone.wait(lock, [this] { return (m_jobs.empty() && (m_nBusy == 0)); });
+}
+
+void util::WorkerPool::wait(size_t maxPending)
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cvDone.wait(lock, [this, maxPending] { return ((m_jobs.size() + m_nBusy) <= maxPending); });
+}
+
+size_t util::WorkerPool::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return (m_jobs.size() + m_nBusy);
+}
+
+void util::WorkerPool::work()
+{
+    while (true)
+    {
+        job_type job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cvJob.wait(lock, [this] { return (m_stop || !m_jobs.empty()); });
+
+            if (m_jobs.empty()) break; // m_stop is set
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_nBusy;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            --m_nBusy;
+        }
+
+        m_cvDone.notify_all();
+    }
+}
+
+
+
+void util::Semaphore::acquire()
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cv.wait(lock, [this] { return (m_count > 0); });
+    --m_count;
+}
+
+void util::Semaphore::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        ++m_count;
+    }
+
+    m_cv.notify_one();
+}
@@ -0,0 +1,83 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_WORKERPOOL_H
+#define IG_MDW_WORKERPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace util
+{
+    class WorkerPool
+    {
+    public:
+        using job_type = std::function<void()>;
+
+    public:
+        WorkerPool() = delete;
+        explicit WorkerPool(size_t nWorkers);
+        virtual ~WorkerPool();
+
+        WorkerPool(const WorkerPool& other) = delete;
+        WorkerPool& operator=(const WorkerPool& other) = delete;
+
+        void submit(const job_type& job);
+
+        // blocks until all submitted jobs are done
+        void wait();
+
+        // blocks until at most maxPending jobs are not done
+        void wait(size_t maxPending);
+
+        // number of submitted jobs which are not done yet
+        size_t pending() const;
+
+        size_t size() const { return m_workers.size(); }
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::deque<job_type> m_jobs;
+        size_t m_nBusy;
+        bool m_stop;
+        mutable std::mutex m_mtx;
+        std::condition_variable m_cvJob;
+        std::condition_variable m_cvDone;
+
+        void work();
+    };
+
+    // counting semaphore, limits the number of threads in a section
+    class Semaphore
+    {
+    public:
+        Semaphore() = delete;
+        explicit Semaphore(size_t count) : m_count(count) {}
+        virtual ~Semaphore() {}
+
+        Semaphore(const Semaphore& other) = delete;
+        Semaphore& operator=(const Semaphore& other) = delete;
+
+        // blocks until the count is greater than 0, then decrements it
+        void acquire();
+
+        void release();
+
+    private:
+        size_t m_count;
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+    };
+}
+
+
+#endif // IG_MDW_WORKERPOOL_H
@@ -0,0 +1,165 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#include <cstring>
+#include <string>
+
+#include "xxhash.h"
+
+
+namespace
+{
+    constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t rotl(uint64_t x, int r) { return ((x << r) | (x >> (64 - r))); }
+
+    inline uint64_t read64(const uint8_t* p)
+    {
+        uint64_t r = 0;
+        for (int i = 7; i >= 0; --i) r = (r << 8) | p[i];
+        return r;
+    }
+
+    inline uint32_t read32(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+    }
+
+    inline uint64_t round(uint64_t acc, uint64_t input)
+    {
+        acc += input * prime2;
+        acc = rotl(acc, 31);
+        return (acc * prime1);
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= round(0, value);
+        return ((acc * prime1) + prime4);
+    }
+}
+
+
+
+void util::XXH64::reset(uint64_t seed)
+{
+    m_seed = seed;
+    m_v[0] = seed + prime1 + prime2;
+    m_v[1] = seed + prime2;
+    m_v[2] = seed;
+    m_v[3] = seed - prime1;
+    m_totalSize = 0;
+    m_bufferSize = 0;
+}
+
+void util::XXH64::update(const void* data, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* const end = p + size;
+
+    m_totalSize += size;
+
+    if ((m_bufferSize + size) < sizeof(m_buffer))
+    {
+        if (size > 0) std::memcpy(m_buffer + m_bufferSize, p, size);
+        m_bufferSize += size;
+        return;
+    }
+
+    if (m_bufferSize > 0)
+    {
+        const size_t n = sizeof(m_buffer) - m_bufferSize;
+        std::memcpy(m_buffer + m_bufferSize, p, n);
+        p += n;
+
+        for (size_t i = 0; i < 4; ++i) m_v[i] = round(m_v[i], read64(m_buffer + (i * 8)));
+
+        m_bufferSize = 0;
+    }
+
+    while ((end - p) >= 32)
+    {
+        m_v[0] = round(m_v[0], read64(p));
+        m_v[1] = round(m_v[1], read64(p + 8));
+        m_v[2] = round(m_v[2], read64(p + 16));
+        m_v[3] = round(m_v[3], read64(p + 24));
+        p += 32;
+    }
+
+    m_bufferSize = (size_t)(end - p);
+    if (m_bufferSize > 0) std::memcpy(m_buffer, p, m_bufferSize);
+}
+
+uint64_t util::XXH64::digest() const
+{
+    uint64_t h;
+
+    if (m_totalSize >= 32)
+    {
+        h = rotl(m_v[0], 1) + rotl(m_v[1], 7) + rotl(m_v[2], 12) + rotl(m_v[3], 18);
+        for (size_t i = 0; i < 4; ++i) h = mergeRound(h, m_v[i]);
+    }
+    else h = m_seed + prime5;
+
+    h += m_totalSize;
+
+    const uint8_t* p = m_buffer;
+    const uint8_t* const end = m_buffer + m_bufferSize;
+
+    while ((end - p) >= 8)
+    {
+        h ^= round(0, read64(p));
+        h = (rotl(h, 27) * prime1) + prime4;
+        p += 8;
+    }
+
+    if ((end - p) >= 4)
+    {
+        h ^= (uint64_t)read32(p) * prime1;
+        h = (rotl(h, 23) * prime2) + prime3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        h ^= (uint64_t)(*p) * prime5;
+        h = rotl(h, 11) * prime1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+uint64_t util::XXH64::hash(const void* data, size_t size, uint64_t seed)
+{
+    XXH64 h(seed);
+    h.update(data, size);
+    return h.digest();
+}
+
+std::string util::XXH64::toString(uint64_t hash)
+{
+    const char* const digits = "0123456789abcdef";
+    std::string r(16, '0');
+
+    for (size_t i = 0; i < 16; ++i)
+    {
+        r[15 - i] = digits[hash & 0x0F];
+        hash >>= 4;
+    }
+
+    return r;
+}
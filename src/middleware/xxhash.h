@@ -0,0 +1,43 @@
+/*
+author          Oliver Blaser
+date            18.10.2026
+copyright       GNU GPLv3 - Copyright (c) 2026 Oliver Blaser
+*/
+
+#ifndef IG_MDW_XXHASH_H
+#define IG_MDW_XXHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace util
+{
+    // streaming XXH64, compatible with `xxhsum -H1`
+    class XXH64
+    {
+    public:
+        explicit XXH64(uint64_t seed = 0) { reset(seed); }
+        virtual ~XXH64() {}
+
+        void reset(uint64_t seed = 0);
+        void update(const void* data, size_t size);
+        uint64_t digest() const;
+
+        static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+
+        // 16 lower case hex digits
+        static std::string toString(uint64_t hash);
+
+    private:
+        uint64_t m_v[4];
+        uint64_t m_seed;
+        uint64_t m_totalSize;
+        uint8_t m_buffer[32];
+        size_t m_bufferSize;
+    };
+}
+
+
+#endif // IG_MDW_XXHASH_H